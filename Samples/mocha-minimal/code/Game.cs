@@ -15,6 +15,23 @@ public class Game : BaseGame
 		var map = new ModelEntity( "models/dev/dev_map.mmdl" );
 		map.SetMeshPhysics( "models/dev/dev_map.mmdl" );
 
+		// Light it
+		var lightPositions = new[]
+		{
+			new Vector3( 0, 4, 2 ),
+			new Vector3( 4, 4, 2 ),
+			new Vector3( 0, -4, 2 ),
+			new Vector3( -4, 4, 2 )
+		};
+
+		foreach ( var position in lightPositions )
+		{
+			var light = new PointLight();
+			light.Position = position;
+			light.Intensity = 50.0f;
+			light.Radius = 30.0f;
+		}
+
 		// Spawn a player
 		var player = new Player();
 		player.Position = new Vector3( 0, 5, 10 );
@@ -5,4 +5,11 @@ public struct ShaderInfo
 	public int[] VertexShaderData { get; set; }
 	public int[] FragmentShaderData { get; set; }
 	public int[] ComputeShaderData { get; set; }
+
+	/// <summary>
+	/// The vertex and fragment stages compiled with <c>BINDLESS</c> defined, for bindless mode
+	/// (<c>render.bindless</c>). Only set for shaders that have a bindless variant.
+	/// </summary>
+	public int[]? BindlessVertexShaderData { get; set; }
+	public int[]? BindlessFragmentShaderData { get; set; }
 }
@@ -0,0 +1,24 @@
+﻿using System.Runtime.InteropServices;
+
+namespace Mocha.Common;
+
+[StructLayout( LayoutKind.Sequential )]
+public struct RenderStats
+{
+	public int drawCalls;
+	public int instances;
+
+	public int visibleMeshes;
+	public int culledMeshes;
+
+	public int pipelineBinds;
+	public int descriptorBinds;
+	public int vertexBufferBinds;
+	public int indexBufferBinds;
+
+	public int skippedBinds;
+
+	public int lights;
+
+	public int StateChanges => pipelineBinds + descriptorBinds + vertexBufferBinds + indexBufferBinds;
+}
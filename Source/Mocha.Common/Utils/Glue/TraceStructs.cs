@@ -5,15 +5,17 @@ namespace Mocha.Common;
 [StructLayout( LayoutKind.Sequential )]
 public struct TraceResult
 {
-	public bool hit;
+	// Bools are one byte natively; keep them that way so that this matches the native layout both
+	// when marshalled and when native code writes straight into a pinned array (see Cast.RunBatch)
+	[MarshalAs( UnmanagedType.U1 )] public bool hit;
 	public Vector3 startPosition;
 	public Vector3 endPosition;
 	public float fraction;
 	public Vector3 normal;
-	public bool startedSolid;
-	public bool endedSolid;
-	public uint entityHandle;
+	[MarshalAs( UnmanagedType.U1 )] public bool startedSolid;
+	[MarshalAs( UnmanagedType.U1 )] public bool endedSolid;
 	public uint pad0;
+	public uint entityHandle;
 }
 
 [StructLayout( LayoutKind.Sequential )]
@@ -21,9 +23,10 @@ public struct TraceInfo
 {
 	public Vector3 startPosition;
 	public Vector3 endPosition;
-	public bool isBox;
+	[MarshalAs( UnmanagedType.U1 )] public bool isBox;
 	public Vector3 extents;
 	public int ignoredEntityCount;
 	public IntPtr ignoredEntityHandles;
+	public uint layerMask;
 }
 
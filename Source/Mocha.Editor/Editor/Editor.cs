@@ -154,6 +154,17 @@ public class Editor
 
 			ImGuiX.Separator( new Vector4( 1, 1, 1, 0.05f ) );
 
+			var renderStats = ImGuiX.GetRenderStats();
+			DrawProperty( $"Draw calls", $"{renderStats.drawCalls}" );
+			DrawProperty( $"Instances", $"{renderStats.instances}" );
+			DrawProperty( $"Visible", $"{renderStats.visibleMeshes}" );
+			DrawProperty( $"Culled", $"{renderStats.culledMeshes}" );
+			DrawProperty( $"State changes", $"{renderStats.StateChanges}" );
+			DrawProperty( $"Binds saved", $"{renderStats.skippedBinds}" );
+			DrawProperty( $"Lights", $"{renderStats.lights}" );
+
+			ImGuiX.Separator( new Vector4( 1, 1, 1, 0.05f ) );
+
 			DrawProperty( $"Ping", $"{0}ms" );
 			DrawProperty( $"Jitter", $"{0}ms" );
 			DrawProperty( $"Loss", $"{0}" );
@@ -106,6 +106,11 @@ public static class ImGuiX
 		return NativeEditor.GetGPUName();
 	}
 
+	public static RenderStats GetRenderStats()
+	{
+		return NativeEditor.GetRenderStats();
+	}
+
 	public static void RenderViewDropdown()
 	{
 		NativeEditor.RenderViewDropdown();
@@ -70,6 +70,8 @@ public class Material : Asset
 				SamplerType.Point,
 				false
 			);
+
+			SetBindlessShaderData( shaderFormat.Data );
 		}
 
 		//
@@ -87,6 +89,8 @@ public class Material : Asset
 				shaderFormat.Data.FragmentShaderData.ToInterop()
 			);
 
+			SetBindlessShaderData( shaderFormat.Data );
+
 			NativeMaterial.Reload();
 		} );
 	}
@@ -128,6 +132,20 @@ public class Material : Asset
 			ignoreDepth
 		);
 
+		SetBindlessShaderData( shaderFormat.Data );
+
 		// TODO: File watcher here!
 	}
+
+	/// <summary>
+	/// Hands the shader's bindless variant to the native material, which uses it in bindless mode.
+	/// Shaders without one pass empty arrays, and their materials keep using descriptors.
+	/// </summary>
+	private void SetBindlessShaderData( ShaderInfo shaderInfo )
+	{
+		NativeMaterial.SetBindlessShaderData(
+			( shaderInfo.BindlessVertexShaderData ?? Array.Empty<int>() ).ToInterop(),
+			( shaderInfo.BindlessFragmentShaderData ?? Array.Empty<int>() ).ToInterop()
+		);
+	}
 }
@@ -0,0 +1,38 @@
+﻿namespace Mocha;
+
+[Category( "World" ), Icon( FontAwesome.Lightbulb ), Title( "Point Light" )]
+public class PointLight : BaseEntity
+{
+	[HideInInspector]
+	private Glue.LightEntity NativeLightEntity => NativeEngine.GetEntityManager().GetLightEntity( NativeHandle );
+
+	[Category( "Light" )]
+	public Vector3 Color
+	{
+		get => NativeLightEntity.GetColor();
+		set => NativeLightEntity.SetColor( value );
+	}
+
+	[Category( "Light" )]
+	public float Intensity
+	{
+		get => NativeLightEntity.GetIntensity();
+		set => NativeLightEntity.SetIntensity( value );
+	}
+
+	[Category( "Light" )]
+	public float Radius
+	{
+		get => NativeLightEntity.GetRadius();
+		set => NativeLightEntity.SetRadius( value );
+	}
+
+	public PointLight()
+	{
+	}
+
+	protected override void CreateNativeEntity()
+	{
+		NativeHandle = NativeEngine.CreateLightEntity();
+	}
+}
@@ -39,6 +39,7 @@ public class Cast
 	public Cast()
 	{
 		_info = new();
+		_info.layerMask = uint.MaxValue;
 	}
 
 	public Cast WithHalfExtents( Vector3 extents )
@@ -49,6 +50,13 @@ public class Cast
 		return this;
 	}
 
+	public Cast WithLayerMask( uint layerMask )
+	{
+		_info.layerMask = layerMask;
+
+		return this;
+	}
+
 	public Cast Ignore( ModelEntity entityToIgnore )
 	{
 		_ignoredEntities.Add( entityToIgnore );
@@ -72,4 +80,59 @@ public class Cast
 			}
 		}
 	}
+
+	/// <summary>
+	/// Runs all of these casts at once, spread across the engine's worker threads, with a
+	/// single call into native code. Use this instead of calling <see cref="Run"/> in a loop
+	/// when there are lots of casts to do.
+	/// </summary>
+	public static TraceResult[] RunBatch( IReadOnlyList<Cast> casts )
+	{
+		var count = casts.Count;
+		var traceInfos = new Common.TraceInfo[count];
+		var traceResults = new Common.TraceResult[count];
+
+		// Every cast's ignore list goes into one array, so that there's only one thing to pin
+		var ignoredHandles = casts.SelectMany( x => x._ignoredEntities ).Select( x => x.NativeHandle ).ToArray();
+
+		unsafe
+		{
+			fixed ( uint* ignoredData = ignoredHandles )
+			fixed ( Common.TraceInfo* traceInfoData = traceInfos )
+			fixed ( Common.TraceResult* traceResultData = traceResults )
+			{
+				var ignoredOffset = 0;
+
+				for ( int i = 0; i < count; i++ )
+				{
+					var cast = casts[i];
+
+					traceInfos[i] = cast._info;
+					traceInfos[i].ignoredEntityCount = cast._ignoredEntities.Count;
+					traceInfos[i].ignoredEntityHandles = (IntPtr)(ignoredData + ignoredOffset);
+
+					ignoredOffset += cast._ignoredEntities.Count;
+				}
+
+				var nativeTraceInfos = new Glue.UtilArray()
+				{
+					count = count,
+					size = count * sizeof( Common.TraceInfo ),
+					data = (IntPtr)traceInfoData
+				};
+
+				var nativeTraceResults = new Glue.UtilArray()
+				{
+					count = count,
+					size = count * sizeof( Common.TraceResult ),
+					data = (IntPtr)traceResultData
+				};
+
+				var physicsManager = NativeEngine.GetPhysicsManager();
+				physicsManager.TraceBatch( nativeTraceInfos, nativeTraceResults );
+			}
+		}
+
+		return traceResults.Select( TraceResult.From ).ToArray();
+	}
 }
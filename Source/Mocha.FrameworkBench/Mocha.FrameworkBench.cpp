@@ -1,13 +1,43 @@
 //
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <vector>
 //
 #include <Framework/array.h>
 #include <Framework/handlemap.h>
+//
+#include <Jolt/Jolt.h>
+//
+#include <Jolt/Core/Factory.h>
+#include <Jolt/Physics/Body/BodyCreationSettings.h>
+#include <Jolt/Physics/Collision/CastResult.h>
+#include <Jolt/Physics/Collision/CollisionCollectorImpl.h>
+#include <Jolt/Physics/Collision/RayCast.h>
+#include <Jolt/Physics/Collision/Shape/BoxShape.h>
+#include <Jolt/Physics/PhysicsSystem.h>
+#include <Jolt/RegisterTypes.h>
+#include <Physics/tracefilters.h>
+//
+#include <Entities/entitymanager.h>
+#include <Entities/modelentity.h>
+#include <Misc/globalvars.h>
+#include <Misc/jobmanager.h>
+#include <Rendering/Assets/material.h>
+#include <Rendering/Assets/model.h>
+#include <Rendering/Assets/texture.h>
+#include <Rendering/Platform/Recording/recordingrendercontext.h>
+#include <Rendering/rendermanager.h>
 
 const double CheckHandleMapSpeed_Single();
 const double CheckArraySpeed_SystemAlloc_Single();
 const double CheckArraySpeed_LinearAlloc_Single();
 const double CheckVectorSpeed_Single();
+const double CheckTraceSpeed_AllHit();
+const double CheckTraceSpeed_ClosestHit();
+const double CheckRenderSpeed_DrawGame();
+const bool CheckRenderCounts();
 const void CheckSpeed( const std::function<double()> func );
 
 const int g_benchmarkCount = 1000;
@@ -32,7 +62,23 @@ int main()
 	CheckSpeed( CheckVectorSpeed_Single );
 
 	std::cout << "--------------------" << std::endl;
-	return 0;
+	std::cout << "[Trace - AllHitCollisionCollector + Sort]" << std::endl;
+	CheckSpeed( CheckTraceSpeed_AllHit );
+
+	std::cout << "--------------------" << std::endl;
+	std::cout << "[Trace - ClosestHitCollisionCollector + filters]" << std::endl;
+	CheckSpeed( CheckTraceSpeed_ClosestHit );
+
+	std::cout << "--------------------" << std::endl;
+	std::cout << "[Render - RecordingRenderContext counts]" << std::endl;
+	const bool renderCountsPassed = CheckRenderCounts();
+
+	std::cout << "--------------------" << std::endl;
+	std::cout << "[Render - DrawGame]" << std::endl;
+	CheckSpeed( CheckRenderSpeed_DrawGame );
+
+	std::cout << "--------------------" << std::endl;
+	return renderCountsPassed ? 0 : 1;
 }
 
 #define SPEED_TEST_BEGIN()
@@ -172,4 +218,320 @@ const double CheckHandleMapSpeed_Single()
 	}
 
 	return CalculateDurationSeconds( start, count );
-}
\ No newline at end of file
+}
+
+//
+// Traces
+//
+// A row of heavily overlapping boxes, so that a ray down the row hits every one of them. The first
+// body is ignored, like a player tracing out from inside their own collider.
+//
+struct TraceBenchScene
+{
+	static constexpr int BODY_COUNT = 512;
+	static constexpr JPH::ObjectLayer LAYER = 0;
+
+	class BroadPhaseLayers final : public JPH::BroadPhaseLayerInterface
+	{
+	public:
+		JPH::uint GetNumBroadPhaseLayers() const override { return 1; }
+		JPH::BroadPhaseLayer GetBroadPhaseLayer( JPH::ObjectLayer layer ) const override { return JPH::BroadPhaseLayer( 0 ); }
+
+#if defined( JPH_EXTERNAL_PROFILE ) || defined( JPH_PROFILE_ENABLED )
+		const char* GetBroadPhaseLayerName( JPH::BroadPhaseLayer layer ) const override { return "DEFAULT"; }
+#endif
+	};
+
+	BroadPhaseLayers broadPhaseLayers;
+	JPH::PhysicsSystem physicsSystem;
+
+	// Entity handle per body index, as PhysicsManager keeps it
+	std::vector<uint32_t> bodyEntityHandles;
+	uint32_t ignoredEntityHandle;
+
+	TraceBenchScene()
+	{
+		JPH::RegisterDefaultAllocator();
+		JPH::Factory::sInstance = new JPH::Factory();
+		JPH::RegisterTypes();
+
+		physicsSystem.Init(
+		    BODY_COUNT, 0, BODY_COUNT, BODY_COUNT, broadPhaseLayers,
+		    []( JPH::ObjectLayer, JPH::BroadPhaseLayer ) { return true; },
+		    []( JPH::ObjectLayer, JPH::ObjectLayer ) { return true; } );
+
+		bodyEntityHandles.assign( BODY_COUNT, UINT32_MAX );
+
+		auto& bodyInterface = physicsSystem.GetBodyInterface();
+		JPH::ShapeRefC shape = JPH::BoxShapeSettings( JPH::Vec3( 1.0f, 1.0f, 1.0f ) ).Create().Get();
+
+		for ( int i = 0; i < BODY_COUNT; ++i )
+		{
+			JPH::BodyCreationSettings settings(
+			    shape, JPH::Vec3( i * 0.05f, 0.0f, 0.0f ), JPH::Quat::sIdentity(), JPH::EMotionType::Static, LAYER );
+			JPH::BodyID bodyId = bodyInterface.CreateAndAddBody( settings, JPH::EActivation::DontActivate );
+
+			bodyEntityHandles[bodyId.GetIndex()] = static_cast<uint32_t>( i );
+		}
+
+		ignoredEntityHandle = 0;
+		physicsSystem.OptimizeBroadPhase();
+	}
+
+	static TraceBenchScene& Get()
+	{
+		static TraceBenchScene scene;
+		return scene;
+	}
+};
+
+const double CheckTraceSpeed_AllHit()
+{
+	const int count = 64;
+
+	auto& scene = TraceBenchScene::Get();
+	const JPH::NarrowPhaseQuery& sceneQuery = scene.physicsSystem.GetNarrowPhaseQuery();
+
+	JPH::RayCast ray = {};
+	ray.mOrigin = JPH::Vec3( -10.0f, 0.0f, 0.0f );
+	ray.mDirection = JPH::Vec3( 100.0f, 0.0f, 0.0f );
+
+	const auto start = StartClock();
+
+	for ( int i = 0; i < count; i++ )
+	{
+		JPH::AllHitCollisionCollector<JPH::CastRayCollector> collector;
+		sceneQuery.CastRay( ray, JPH::RayCastSettings(), collector );
+
+		collector.Sort();
+		std::vector<JPH::RayCastResult> results( collector.mHits.begin(), collector.mHits.end() );
+
+		// Walk the hits for the first one that isn't ignored
+		for ( const auto& result : results )
+		{
+			if ( scene.bodyEntityHandles[result.mBodyID.GetIndex()] == scene.ignoredEntityHandle )
+				continue;
+
+			break;
+		}
+	}
+
+	return CalculateDurationSeconds( start, count );
+}
+
+const double CheckTraceSpeed_ClosestHit()
+{
+	const int count = 64;
+
+	auto& scene = TraceBenchScene::Get();
+	const JPH::NarrowPhaseQuery& sceneQuery = scene.physicsSystem.GetNarrowPhaseQuery();
+
+	JPH::RayCast ray = {};
+	ray.mOrigin = JPH::Vec3( -10.0f, 0.0f, 0.0f );
+	ray.mDirection = JPH::Vec3( 100.0f, 0.0f, 0.0f );
+
+	const auto start = StartClock();
+
+	for ( int i = 0; i < count; i++ )
+	{
+		TraceBroadPhaseLayerFilter broadPhaseLayerFilter( UINT32_MAX, scene.broadPhaseLayers, 1 );
+		TraceObjectLayerFilter objectLayerFilter( UINT32_MAX );
+		TraceBodyFilter bodyFilter(
+		    scene.bodyEntityHandles.data(), scene.bodyEntityHandles.size(), &scene.ignoredEntityHandle, 1 );
+
+		JPH::ClosestHitCollisionCollector<JPH::CastRayCollector> collector;
+		sceneQuery.CastRay( ray, JPH::RayCastSettings(), collector, broadPhaseLayerFilter, objectLayerFilter, bodyFilter );
+	}
+
+	return CalculateDurationSeconds( start, count );
+}
+
+//
+// Rendering
+//
+// Frames go through the real RenderManager, but into a RecordingRenderContext, so this runs without
+// a window or a GPU. Every material is shared by a row of entities in front of the camera, so each
+// material should come out as a single instanced draw.
+//
+template <typename T>
+UtilArray MakeUtilArray( std::vector<T>& vec )
+{
+	// Not UtilArray::FromVector, which would point at a copy of the vector that's gone once it returns
+	UtilArray array = {};
+	array.count = static_cast<int>( vec.size() );
+	array.size = static_cast<int>( vec.size() * sizeof( T ) );
+	array.data = vec.data();
+
+	return array;
+}
+
+struct RenderBenchScene
+{
+	static constexpr int MATERIAL_COUNT = 4;
+	static constexpr int ENTITIES_PER_MATERIAL = 16;
+
+	// VK_FORMAT_R8G8B8A8_UNORM; the recording context never looks at it
+	static constexpr int TEXTURE_FORMAT = 37;
+
+	struct Vertex
+	{
+		float x;
+		float y;
+		float z;
+	};
+
+	// Meshes and materials point at these rather than copying them, so they live as long as the scene
+	std::vector<Vertex> vertices = { { 0.0f, -0.5f, -0.5f }, { 0.0f, 0.5f, -0.5f }, { 0.0f, 0.0f, 0.5f } };
+	std::vector<uint32_t> indices = { 0, 1, 2 };
+	std::vector<uint32_t> shaderData = { 0x07230203 };
+	std::vector<InteropVertexAttributeInfo> vertexAttributes = { { "position", VERTEX_ATTRIBUTE_FORMAT_FLOAT3 } };
+	std::vector<uint8_t> texels = std::vector<uint8_t>( 4 * 4 * 4, 0xFF );
+
+	std::vector<std::unique_ptr<Texture>> textures;
+	std::vector<std::unique_ptr<Material>> materials;
+	std::vector<std::unique_ptr<Model>> models;
+
+	RecordingRenderContext* renderContext;
+
+	RenderBenchScene()
+	{
+		// Read once, when the render context starts up
+		EngineProperties::Recording.SetValue( true );
+		EngineProperties::Bindless.SetValue( false );
+		EngineProperties::GpuDriven.SetValue( false );
+
+		// Looking down +X
+		Globals::m_cameraPos = { 0.0f, 0.0f, 0.0f };
+		Globals::m_cameraRot = { 0.0f, 0.0f, 0.0f, 1.0f };
+		Globals::m_cameraFov = 90.0f;
+		Globals::m_cameraZNear = 0.1f;
+		Globals::m_cameraZFar = 1000.0f;
+
+		// Just the subsystems that DrawGame relies on
+		Globals::m_jobManager = new JobManager();
+		Globals::m_jobManager->Startup();
+
+		Globals::m_entityManager = new EntityManager();
+		Globals::m_entityManager->Startup();
+
+		Globals::m_renderManager = new RenderManager();
+		Globals::m_renderManager->Startup();
+
+		renderContext = static_cast<RecordingRenderContext*>( Globals::m_renderContext );
+
+		for ( int i = 0; i < MATERIAL_COUNT; ++i )
+		{
+			auto texture = std::make_unique<Texture>( "Bench texture", 4, 4 );
+			texture->SetData( 4, 4, 1, MakeUtilArray( texels ), TEXTURE_FORMAT );
+
+			std::vector<Texture*> materialTextures = { texture.get() };
+
+			auto material = std::make_unique<Material>( "Bench material", MakeUtilArray( shaderData ),
+			    MakeUtilArray( shaderData ), MakeUtilArray( vertexAttributes ), MakeUtilArray( materialTextures ),
+			    SAMPLER_TYPE_POINT, false );
+
+			auto model = std::make_unique<Model>();
+			model->AddMesh( "Bench mesh", MakeUtilArray( vertices ), MakeUtilArray( indices ), material.get() );
+
+			for ( int j = 0; j < ENTITIES_PER_MATERIAL; ++j )
+			{
+				ModelEntity modelEntity = {};
+				modelEntity.AddFlag( ENTITY_RENDERABLE );
+				modelEntity.m_type = "ModelEntity";
+
+				Handle handle = Globals::m_entityManager->AddEntity<ModelEntity>( modelEntity );
+				ModelEntity* entity = Globals::m_entityManager->GetModelEntity( handle );
+
+				entity->SetModel( model.get() );
+				entity->SetPosition( { 10.0f, ( j - ENTITIES_PER_MATERIAL / 2 ) * 0.5f, i - MATERIAL_COUNT / 2.0f } );
+			}
+
+			textures.push_back( std::move( texture ) );
+			materials.push_back( std::move( material ) );
+			models.push_back( std::move( model ) );
+		}
+	}
+
+	// Draws one frame, and returns what it took
+	RecordingCounts DrawFrame()
+	{
+		renderContext->ResetCounts();
+		Globals::m_renderManager->DrawGame();
+
+		return renderContext->GetCounts();
+	}
+
+	static RenderBenchScene& Get()
+	{
+		static RenderBenchScene scene;
+		return scene;
+	}
+};
+
+const bool CheckRenderCounts()
+{
+	auto& scene = RenderBenchScene::Get();
+	bool passed = true;
+
+	auto expect = [&]( const char* frame, const char* name, uint64_t actual, uint64_t expected ) {
+		if ( actual == expected )
+			return;
+
+		std::cout << "\tFAILED: " << frame << ": " << name << " was " << actual << ", expected " << expected << std::endl;
+		passed = false;
+	};
+
+	auto expectFrame = [&]( const char* frame, const RecordingCounts& counts, uint32_t descriptorUpdates ) {
+		const RenderStats& stats = Globals::m_renderManager->GetRenderStats();
+		const uint32_t materialCount = RenderBenchScene::MATERIAL_COUNT;
+
+		expect( frame, "frames", counts.frames, 1 );
+		expect( frame, "draws", counts.draws, materialCount );
+		expect( frame, "instances", counts.instances, materialCount * RenderBenchScene::ENTITIES_PER_MATERIAL );
+		expect( frame, "pipeline binds", counts.pipelineBinds, materialCount );
+		expect( frame, "descriptor binds", counts.descriptorBinds, materialCount );
+
+		// Every mesh lives in the same geometry pool page
+		expect( frame, "vertex buffer binds", counts.vertexBufferBinds, 1 );
+		expect( frame, "index buffer binds", counts.indexBufferBinds, 1 );
+
+		expect( frame, "descriptor updates", counts.descriptorUpdates, descriptorUpdates );
+
+		// What RenderManager thinks it did should match what the context saw
+		expect( frame, "RenderStats draw calls", stats.drawCalls, counts.draws );
+		expect( frame, "RenderStats instances", stats.instances, counts.instances );
+		expect( frame, "RenderStats pipeline binds", stats.pipelineBinds, counts.pipelineBinds );
+		expect( frame, "RenderStats descriptor binds", stats.descriptorBinds, counts.descriptorBinds );
+	};
+
+	// Each material's texture binding is written once, when the material's resources are created
+	expectFrame( "First frame", scene.DrawFrame(), RenderBenchScene::MATERIAL_COUNT );
+
+	// Nothing has changed, so nothing should be written again
+	expectFrame( "Second frame", scene.DrawFrame(), 0 );
+
+	// Only the material whose texture was replaced needs its binding written again
+	scene.textures[0]->SetData( 4, 4, 1, MakeUtilArray( scene.texels ), RenderBenchScene::TEXTURE_FORMAT );
+	expectFrame( "After replacing a texture", scene.DrawFrame(), 1 );
+
+	if ( passed )
+		std::cout << "\tOK" << std::endl;
+
+	return passed;
+}
+
+const double CheckRenderSpeed_DrawGame()
+{
+	const int count = 16;
+
+	auto& scene = RenderBenchScene::Get();
+
+	const auto start = StartClock();
+
+	for ( int i = 0; i < count; i++ )
+	{
+		scene.DrawFrame();
+	}
+
+	return CalculateDurationSeconds( start, count );
+}
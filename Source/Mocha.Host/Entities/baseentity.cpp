@@ -0,0 +1,65 @@
+#include "baseentity.h"
+
+#include <Entities/entitymanager.h>
+#include <Misc/globalvars.h>
+
+void BaseEntity::AddFlag( EntityFlags flags )
+{
+	m_flags = m_flags | flags;
+
+	// Keep the entity manager's buckets in sync, once we're in there
+	if ( m_handle != HANDLE_INVALID )
+		Globals::m_entityManager->OnEntityFlagsChanged( m_handle );
+}
+
+void BaseEntity::RemoveFlag( EntityFlags flags )
+{
+	m_flags = m_flags & ~flags;
+
+	if ( m_handle != HANDLE_INVALID )
+		Globals::m_entityManager->OnEntityFlagsChanged( m_handle );
+}
+
+Transform BaseEntity::GetTransform()
+{
+	return Globals::m_entityManager->GetTransforms().Get( m_transformIndex );
+}
+
+void BaseEntity::SetTransform( const Transform& transform )
+{
+	Globals::m_entityManager->GetTransforms().Set( m_transformIndex, transform );
+	OnTransformChanged( TRANSFORM_CHANGED_ALL );
+}
+
+void BaseEntity::SetPosition( const Vector3& pos )
+{
+	Globals::m_entityManager->GetTransforms().SetPosition( m_transformIndex, pos );
+	OnTransformChanged( TRANSFORM_CHANGED_POSITION );
+}
+
+Vector3 BaseEntity::GetPosition()
+{
+	return Globals::m_entityManager->GetTransforms().GetPosition( m_transformIndex );
+}
+
+void BaseEntity::SetRotation( const Quaternion& rot )
+{
+	Globals::m_entityManager->GetTransforms().SetRotation( m_transformIndex, rot );
+	OnTransformChanged( TRANSFORM_CHANGED_ROTATION );
+}
+
+Quaternion BaseEntity::GetRotation()
+{
+	return Globals::m_entityManager->GetTransforms().GetRotation( m_transformIndex );
+}
+
+void BaseEntity::SetScale( const Vector3& scale )
+{
+	Globals::m_entityManager->GetTransforms().SetScale( m_transformIndex, scale );
+	OnTransformChanged( TRANSFORM_CHANGED_SCALE );
+}
+
+Vector3 BaseEntity::GetScale()
+{
+	return Globals::m_entityManager->GetTransforms().GetScale( m_transformIndex );
+}
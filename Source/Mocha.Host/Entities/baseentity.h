@@ -1,4 +1,5 @@
 #pragma once
+#include <Entities/transformstorage.h>
 #include <Misc/defs.h>
 #include <Misc/mathtypes.h>
 #include <Root/clientroot.h>
@@ -16,6 +17,17 @@ enum EntityFlags : int
 
 DEFINE_FLAG_OPERATORS( EntityFlags );
 
+enum TransformChangeFlags : int
+{
+	TRANSFORM_CHANGED_NONE = 0,
+	TRANSFORM_CHANGED_POSITION = 1 << 0,
+	TRANSFORM_CHANGED_ROTATION = 1 << 1,
+	TRANSFORM_CHANGED_SCALE = 1 << 2,
+	TRANSFORM_CHANGED_ALL = TRANSFORM_CHANGED_POSITION | TRANSFORM_CHANGED_ROTATION | TRANSFORM_CHANGED_SCALE,
+};
+
+DEFINE_FLAG_OPERATORS( TransformChangeFlags );
+
 class Camera;
 
 class BaseEntity
@@ -33,15 +45,22 @@ public:
 	std::string m_type = "No type";
 	std::string m_name = "Unnamed";
 
-	Transform m_transformLastFrame = {};
-	Transform m_transformCurrentFrame = {};
+	// This entity's handle in the entity manager; HANDLE_INVALID until the entity is added
+	Handle m_handle = HANDLE_INVALID;
 
-	Transform m_transform = {};
+	// Index into the entity manager's transform storage; assigned when the entity is added
+	uint32_t m_transformIndex = TRANSFORM_INDEX_INVALID;
 
-	inline void AddFlag( EntityFlags flags ) { m_flags = m_flags | flags; }
-	inline void RemoveFlag( EntityFlags flags ) { m_flags = m_flags & ~flags; }
+	void AddFlag( EntityFlags flags );
+	void RemoveFlag( EntityFlags flags );
 	inline bool HasFlag( EntityFlags flag ) { return ( m_flags & flag ) != 0; }
 
+	Transform GetTransform();
+	void SetTransform( const Transform& transform );
+
+	// Called after the transform has been changed through one of the setters on this class
+	virtual void OnTransformChanged( TransformChangeFlags changes ) {}
+
 	//
 	// Managed bindings
 	//
@@ -51,14 +70,14 @@ public:
 	GENERATE_BINDINGS inline void SetType( const char* type ) { m_type = type; }
 	GENERATE_BINDINGS inline const char* GetType() { return m_type.c_str(); }
 
-	GENERATE_BINDINGS inline void SetPosition( const Vector3& pos ) { m_transform.position = pos; }
-	GENERATE_BINDINGS inline Vector3 GetPosition() { return m_transform.position; }
+	GENERATE_BINDINGS void SetPosition( const Vector3& pos );
+	GENERATE_BINDINGS Vector3 GetPosition();
 
-	GENERATE_BINDINGS inline void SetRotation( const Quaternion& rot ) { m_transform.rotation = rot; }
-	GENERATE_BINDINGS inline Quaternion GetRotation() { return m_transform.rotation; }
+	GENERATE_BINDINGS void SetRotation( const Quaternion& rot );
+	GENERATE_BINDINGS Quaternion GetRotation();
 
-	GENERATE_BINDINGS inline void SetScale( const Vector3& scale ) { m_transform.scale = scale; }
-	GENERATE_BINDINGS inline Vector3 GetScale() { return m_transform.scale; }
+	GENERATE_BINDINGS void SetScale( const Vector3& scale );
+	GENERATE_BINDINGS Vector3 GetScale();
 
 	GENERATE_BINDINGS inline void SetViewmodel( bool isViewmodel )
 	{
@@ -1,17 +1,102 @@
 #pragma once
 
 #include <Entities/baseentity.h>
+#include <Entities/lightentity.h>
 #include <Entities/modelentity.h>
+#include <Entities/transformstorage.h>
 #include <Misc/handlemap.h>
 #include <Misc/mathtypes.h>
 #include <Misc/subsystem.h>
 #include <Util/util.h>
 #include <functional>
 #include <memory>
+#include <shared_mutex>
+#include <typeindex>
 #include <unordered_map>
+#include <vector>
+
+//
+// A cached list of entities that are of a given type and have a given set of flags.
+// Membership is worked out when entities are added or have their flags changed, so
+// iterating over a bucket only touches entities that match and never needs RTTI.
+//
+struct EntityBucket
+{
+	std::type_index type;
+	bool ( *isType )( BaseEntity* entity );
+
+	EntityFlags requiredFlags;
+	EntityFlags excludedFlags;
+
+	std::vector<Handle> handles;
+
+	// Handle -> index into handles
+	std::unordered_map<Handle, uint32_t> indices;
+
+	inline bool Matches( BaseEntity* entity ) const
+	{
+		return ( entity->m_flags & requiredFlags ) == requiredFlags && ( entity->m_flags & excludedFlags ) == 0 &&
+		       isType( entity );
+	}
+
+	// Does nothing if the entity is already in the bucket.
+	void Insert( Handle handle );
+	void Erase( Handle handle );
+};
+
+inline void EntityBucket::Insert( Handle handle )
+{
+	// A bucket created while an entity is being added picks it up from the map, and then AddEntity
+	// offers it again
+	if ( indices.find( handle ) != indices.end() )
+		return;
+
+	indices[handle] = static_cast<uint32_t>( handles.size() );
+	handles.push_back( handle );
+}
+
+inline void EntityBucket::Erase( Handle handle )
+{
+	auto it = indices.find( handle );
+
+	if ( it == indices.end() )
+		return;
+
+	uint32_t index = it->second;
+	uint32_t lastIndex = static_cast<uint32_t>( handles.size() - 1 );
+
+	// Move the last entity into the hole
+	if ( index != lastIndex )
+	{
+		handles[index] = handles[lastIndex];
+		indices[handles[index]] = index;
+	}
+
+	handles.pop_back();
+	indices.erase( it );
+}
 
 class EntityManager : HandleMap<BaseEntity>, ISubSystem
 {
+private:
+	TransformStorage m_transforms;
+
+	std::vector<std::unique_ptr<EntityBucket>> m_buckets;
+	std::shared_mutex m_bucketMutex;
+
+	template <typename T>
+	static bool IsOfType( BaseEntity* entity )
+	{
+		return dynamic_cast<T*>( entity ) != nullptr;
+	}
+
+	// Finds the bucket for this query, creating and filling it if nobody has asked for it before.
+	template <typename T>
+	EntityBucket* GetBucket( EntityFlags requiredFlags, EntityFlags excludedFlags );
+
+	// The caller must hold m_bucketMutex.
+	EntityBucket* FindBucket( std::type_index type, EntityFlags requiredFlags, EntityFlags excludedFlags );
+
 public:
 	template <typename T>
 	Handle AddEntity( T entity );
@@ -19,12 +104,26 @@ public:
 	template <typename T>
 	std::shared_ptr<T> GetEntity( Handle entityHandle );
 
-	void ForEach( std::function<void( std::shared_ptr<BaseEntity> entity )> func );
+	void ForEach( std::function<void( const std::shared_ptr<BaseEntity>& entity )> func );
+
+	// Calls func for every entity of type T that has all of requiredFlags and none of excludedFlags.
+	// func is free to add entities or change flags; those changes show up from the next call.
+	template <typename T>
+	void ForEachSpecific( std::function<void( T* entity )> func, EntityFlags requiredFlags = ( EntityFlags )0,
+	    EntityFlags excludedFlags = ( EntityFlags )0 );
 
+	// Same as ForEachSpecific, but also passes the entity's handle.
 	template <typename T>
-	void ForEachSpecific( std::function<void( std::shared_ptr<T> entity )> func );
+	void ForSpecific( std::function<void( Handle handle, T* entity )> func, EntityFlags requiredFlags = ( EntityFlags )0,
+	    EntityFlags excludedFlags = ( EntityFlags )0 );
 
-	void For( std::function<void( Handle handle, std::shared_ptr<BaseEntity> entity )> func );
+	void For( std::function<void( Handle handle, const std::shared_ptr<BaseEntity>& entity )> func );
+
+	// Re-evaluates which buckets an entity belongs to. Called by BaseEntity when its flags change.
+	void OnEntityFlagsChanged( Handle entityHandle );
+
+	// Transforms for every entity, indexed by BaseEntity::m_transformIndex
+	TransformStorage& GetTransforms() { return m_transforms; }
 
 	void Startup() override{};
 
@@ -35,12 +134,38 @@ public:
 	{
 		return GetEntity<ModelEntity>( entityHandle ).get();
 	}
+	GENERATE_BINDINGS LightEntity* GetLightEntity( uint32_t entityHandle )
+	{
+		return GetEntity<LightEntity>( entityHandle ).get();
+	}
 };
 
 template <typename T>
 inline Handle EntityManager::AddEntity( T entity )
 {
-	return AddSpecific<T>( entity );
+	entity.m_transformIndex = m_transforms.Add( {}, entity.m_spawnTime );
+
+	Handle handle = AddSpecific<T>( entity );
+
+	// Out of handles; HandleMap has already logged why
+	if ( handle == HANDLE_INVALID )
+	{
+		m_transforms.Remove( entity.m_transformIndex );
+		return HANDLE_INVALID;
+	}
+
+	BaseEntity* addedEntity = Get( handle ).get();
+	addedEntity->m_handle = handle;
+
+	std::unique_lock lock( m_bucketMutex );
+
+	for ( auto& bucket : m_buckets )
+	{
+		if ( bucket->Matches( addedEntity ) )
+			bucket->Insert( handle );
+	}
+
+	return handle;
 }
 
 template <typename T>
@@ -49,26 +174,115 @@ inline std::shared_ptr<T> EntityManager::GetEntity( Handle entityHandle )
 	return GetSpecific<T>( entityHandle );
 }
 
-inline void EntityManager::ForEach( std::function<void( std::shared_ptr<BaseEntity> entity )> func )
+inline void EntityManager::ForEach( std::function<void( const std::shared_ptr<BaseEntity>& entity )> func )
 {
 	HandleMap<BaseEntity>::ForEach( func );
 }
 
-inline void EntityManager::For( std::function<void( Handle handle, std::shared_ptr<BaseEntity> entity )> func )
+inline void EntityManager::For( std::function<void( Handle handle, const std::shared_ptr<BaseEntity>& entity )> func )
 {
 	HandleMap<BaseEntity>::For( func );
 }
 
 template <typename T>
-inline void EntityManager::ForEachSpecific( std::function<void( std::shared_ptr<T> entity )> func )
+inline EntityBucket* EntityManager::GetBucket( EntityFlags requiredFlags, EntityFlags excludedFlags )
 {
-	ForEach( [&]( std::shared_ptr<BaseEntity> entity ) {
-		// Can we cast to this?
-		auto derivedEntity = std::dynamic_pointer_cast<T>( entity );
+	static_assert( std::is_base_of<BaseEntity, T>::value, "T must be derived from BaseEntity" );
 
-		if ( derivedEntity == nullptr )
-			return;
+	const std::type_index type = typeid( T );
 
-		func( derivedEntity );
+	{
+		std::shared_lock lock( m_bucketMutex );
+
+		if ( EntityBucket* bucket = FindBucket( type, requiredFlags, excludedFlags ) )
+			return bucket;
+	}
+
+	std::unique_lock lock( m_bucketMutex );
+
+	// Someone else might have created it while we didn't hold the lock
+	if ( EntityBucket* bucket = FindBucket( type, requiredFlags, excludedFlags ) )
+		return bucket;
+
+	auto bucket = std::make_unique<EntityBucket>( EntityBucket{ type, &IsOfType<T>, requiredFlags, excludedFlags } );
+
+	// This is the only time we need to look at every entity for this query
+	HandleMap<BaseEntity>::For( [&]( Handle handle, const std::shared_ptr<BaseEntity>& entity ) {
+		if ( bucket->Matches( entity.get() ) )
+			bucket->Insert( handle );
 	} );
-}
\ No newline at end of file
+
+	m_buckets.push_back( std::move( bucket ) );
+	return m_buckets.back().get();
+}
+
+inline EntityBucket* EntityManager::FindBucket(
+    std::type_index type, EntityFlags requiredFlags, EntityFlags excludedFlags )
+{
+	for ( auto& bucket : m_buckets )
+	{
+		if ( bucket->type == type && bucket->requiredFlags == requiredFlags && bucket->excludedFlags == excludedFlags )
+			return bucket.get();
+	}
+
+	return nullptr;
+}
+
+template <typename T>
+inline void EntityManager::ForEachSpecific(
+    std::function<void( T* entity )> func, EntityFlags requiredFlags, EntityFlags excludedFlags )
+{
+	ForSpecific<T>( [&]( Handle handle, T* entity ) { func( entity ); }, requiredFlags, excludedFlags );
+}
+
+template <typename T>
+inline void EntityManager::ForSpecific(
+    std::function<void( Handle handle, T* entity )> func, EntityFlags requiredFlags, EntityFlags excludedFlags )
+{
+	EntityBucket* bucket = GetBucket<T>( requiredFlags, excludedFlags );
+
+	//
+	// Look the whole bucket up in one go, taking each lock once rather than once per entity. func might
+	// add entities or change flags, which needs both locks, so neither is held while func runs; holding
+	// on to the entities keeps them alive even if func removes them.
+	//
+	std::vector<Handle> handles;
+	std::vector<std::shared_ptr<BaseEntity>> entities;
+
+	{
+		std::shared_lock lock( m_bucketMutex );
+
+		handles = bucket->handles;
+		GetMany( handles, entities );
+	}
+
+	for ( size_t i = 0; i < handles.size(); ++i )
+	{
+		if ( entities[i] == nullptr )
+			continue;
+
+		// Everything in this bucket passed IsOfType<T> when it was added
+		func( handles[i], static_cast<T*>( entities[i].get() ) );
+	}
+}
+
+inline void EntityManager::OnEntityFlagsChanged( Handle entityHandle )
+{
+	BaseEntity* entity = Get( entityHandle ).get();
+
+	if ( entity == nullptr )
+		return;
+
+	std::unique_lock lock( m_bucketMutex );
+
+	for ( auto& bucket : m_buckets )
+	{
+		bool isInBucket = bucket->indices.find( entityHandle ) != bucket->indices.end();
+		bool shouldBeInBucket = bucket->Matches( entity );
+
+		if ( shouldBeInBucket && !isInBucket )
+			bucket->Insert( entityHandle );
+		else if ( !shouldBeInBucket && isInBucket )
+			bucket->Erase( entityHandle );
+	}
+}
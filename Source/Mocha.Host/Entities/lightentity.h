@@ -0,0 +1,26 @@
+#pragma once
+#include <Entities/baseentity.h>
+#include <Misc/mathtypes.h>
+
+//
+// A point light. Every light in the world is gathered up by LightManager each frame, and only lights the
+// pixels within m_radius of its position.
+//
+class LightEntity : public BaseEntity
+{
+private:
+	Vector3 m_color = { 1.0f, 1.0f, 1.0f };
+	float m_intensity = 50.0f;
+	float m_radius = 30.0f;
+
+public:
+	GENERATE_BINDINGS Vector3 GetColor() { return m_color; }
+	GENERATE_BINDINGS void SetColor( Vector3 color ) { m_color = color; }
+
+	GENERATE_BINDINGS float GetIntensity() { return m_intensity; }
+	GENERATE_BINDINGS void SetIntensity( float intensity ) { m_intensity = intensity; }
+
+	// Past this distance the light contributes nothing, and isn't considered at all
+	GENERATE_BINDINGS float GetRadius() { return m_radius; }
+	GENERATE_BINDINGS void SetRadius( float radius ) { m_radius = radius; }
+};
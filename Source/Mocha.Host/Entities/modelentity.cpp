@@ -1,8 +1,41 @@
 #include "modelentity.h"
 
+#include <Entities/entitymanager.h>
 #include <Physics/physicsmanager.h>
 #include <Root/clientroot.h>
 
+void ModelEntity::OnTransformChanged( TransformChangeFlags changes )
+{
+	PhysicsDirtyFlags dirtyFlags = PHYSICS_DIRTY_NONE;
+
+	if ( changes & TRANSFORM_CHANGED_POSITION )
+		dirtyFlags |= PHYSICS_DIRTY_POSITION;
+
+	if ( changes & TRANSFORM_CHANGED_ROTATION )
+		dirtyFlags |= PHYSICS_DIRTY_ROTATION;
+
+	if ( dirtyFlags != PHYSICS_DIRTY_NONE )
+		MarkPhysicsDirty( dirtyFlags );
+}
+
+void ModelEntity::MarkPhysicsDirty( PhysicsDirtyFlags flags )
+{
+	// Bodies are created from the entity's current state, so there's nothing to sync until there is one
+	if ( m_physicsHandle == UINT32_MAX )
+		return;
+
+	// Only queue ourselves up once per sync
+	if ( m_physicsDirtyFlags == PHYSICS_DIRTY_NONE )
+		Globals::m_physicsManager->OnBodyDirty( m_handle );
+
+	m_physicsDirtyFlags |= flags;
+}
+
+void ModelEntity::SetSimulatedTransform( const Transform& transform )
+{
+	Globals::m_entityManager->GetTransforms().Set( m_transformIndex, transform );
+}
+
 void ModelEntity::SetSpherePhysics( float radius, bool isStatic )
 {
 	PhysicsBody body = {};
@@ -10,7 +43,7 @@ void ModelEntity::SetSpherePhysics( float radius, bool isStatic )
 	body.friction = 1.0f;
 	body.restitution = 1.0f;
 
-	body.transform = m_transform;
+	body.transform = GetTransform();
 	body.type = isStatic ? PhysicsType::PHYSICS_MODE_STATIC : PhysicsType::PHYSICS_MODE_DYNAMIC;
 
 	body.shape = {};
@@ -28,7 +61,7 @@ void ModelEntity::SetCubePhysics( Vector3 bounds, bool isStatic )
 	body.friction = 1.0f;
 	body.restitution = 1.0f;
 
-	body.transform = m_transform;
+	body.transform = GetTransform();
 	body.type = isStatic ? PhysicsType::PHYSICS_MODE_STATIC : PhysicsType::PHYSICS_MODE_DYNAMIC;
 
 	body.shape = {};
@@ -48,7 +81,7 @@ void ModelEntity::SetMeshPhysics( UtilArray interopVertices )
 	body.friction = 1.0f;
 	body.restitution = 1.0f;
 
-	body.transform = m_transform;
+	body.transform = GetTransform();
 	body.type = PhysicsType::PHYSICS_MODE_STATIC;
 
 	body.shape = {};
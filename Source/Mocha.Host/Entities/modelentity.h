@@ -6,6 +6,17 @@
 
 struct PhysicsBody;
 
+// What game code has changed on an entity since its physics body was last synced
+enum PhysicsDirtyFlags : int
+{
+	PHYSICS_DIRTY_NONE = 0,
+	PHYSICS_DIRTY_POSITION = 1 << 0,
+	PHYSICS_DIRTY_ROTATION = 1 << 1,
+	PHYSICS_DIRTY_VELOCITY = 1 << 2,
+};
+
+DEFINE_FLAG_OPERATORS( PhysicsDirtyFlags );
+
 class ModelEntity : public BaseEntity
 {
 private:
@@ -24,10 +35,24 @@ private:
 	bool m_ignoreRigidbodyRotation;
 	bool m_ignoreRigidbodyPosition;
 
+	PhysicsDirtyFlags m_physicsDirtyFlags = PHYSICS_DIRTY_NONE;
+
 public:
 	// If this model has no physics, this function will return UINT32_MAX.
 	uint32_t GetPhysicsHandle() { return m_physicsHandle; };
 
+	void OnTransformChanged( TransformChangeFlags changes ) override;
+
+	// Flags this entity's body as needing to be updated from the entity before the next physics step.
+	void MarkPhysicsDirty( PhysicsDirtyFlags flags );
+	inline PhysicsDirtyFlags GetPhysicsDirtyFlags() { return m_physicsDirtyFlags; }
+	inline void ClearPhysicsDirtyFlags() { m_physicsDirtyFlags = PHYSICS_DIRTY_NONE; }
+
+	// Used by the physics system to hand simulation results back. Unlike SetTransform / SetVelocity,
+	// these don't mark anything as dirty.
+	void SetSimulatedTransform( const Transform& transform );
+	inline void SetSimulatedVelocity( Vector3 velocity ) { m_velocity = velocity; }
+
 	GENERATE_BINDINGS void SetModel( Model* model ) { m_model = *model; }
 	GENERATE_BINDINGS Model* GetModel() { return &m_model; }
 
@@ -39,7 +64,11 @@ public:
 	GENERATE_BINDINGS void SetMeshPhysics( UtilArray vertices );
 
 	GENERATE_BINDINGS Vector3 GetVelocity() { return m_velocity; }
-	GENERATE_BINDINGS void SetVelocity( Vector3 velocity ) { m_velocity = velocity; }
+	GENERATE_BINDINGS void SetVelocity( Vector3 velocity )
+	{
+		m_velocity = velocity;
+		MarkPhysicsDirty( PHYSICS_DIRTY_VELOCITY );
+	}
 
 	GENERATE_BINDINGS float GetFriction() { return m_friction; }
 	GENERATE_BINDINGS void SetFriction( float friction ) { m_friction = friction; }
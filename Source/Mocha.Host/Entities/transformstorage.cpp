@@ -0,0 +1,293 @@
+#include "transformstorage.h"
+
+#include <Misc/globalvars.h>
+#include <Misc/jobmanager.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+void TransformStorage::TransformArrays::Grow( size_t oldCapacity, size_t newCapacity )
+{
+	std::vector<float> data( newCapacity * COMPONENT_COUNT );
+
+	// Each component array starts at a multiple of the capacity, so move them one by one
+	for ( size_t i = 0; i < COMPONENT_COUNT; ++i )
+	{
+		if ( oldCapacity > 0 )
+			std::memcpy( data.data() + i * newCapacity, m_data.data() + i * oldCapacity, oldCapacity * sizeof( float ) );
+	}
+
+	m_data = std::move( data );
+}
+
+void TransformStorage::TransformArrays::Read( uint32_t index, size_t capacity, Transform& transform ) const
+{
+	transform.position.x = Get( POSITION_X, capacity )[index];
+	transform.position.y = Get( POSITION_Y, capacity )[index];
+	transform.position.z = Get( POSITION_Z, capacity )[index];
+
+	transform.rotation.x = Get( ROTATION_X, capacity )[index];
+	transform.rotation.y = Get( ROTATION_Y, capacity )[index];
+	transform.rotation.z = Get( ROTATION_Z, capacity )[index];
+	transform.rotation.w = Get( ROTATION_W, capacity )[index];
+
+	transform.scale.x = Get( SCALE_X, capacity )[index];
+	transform.scale.y = Get( SCALE_Y, capacity )[index];
+	transform.scale.z = Get( SCALE_Z, capacity )[index];
+}
+
+void TransformStorage::TransformArrays::Write( uint32_t index, size_t capacity, const Transform& transform )
+{
+	Get( POSITION_X, capacity )[index] = transform.position.x;
+	Get( POSITION_Y, capacity )[index] = transform.position.y;
+	Get( POSITION_Z, capacity )[index] = transform.position.z;
+
+	Get( ROTATION_X, capacity )[index] = transform.rotation.x;
+	Get( ROTATION_Y, capacity )[index] = transform.rotation.y;
+	Get( ROTATION_Z, capacity )[index] = transform.rotation.z;
+	Get( ROTATION_W, capacity )[index] = transform.rotation.w;
+
+	Get( SCALE_X, capacity )[index] = transform.scale.x;
+	Get( SCALE_Y, capacity )[index] = transform.scale.y;
+	Get( SCALE_Z, capacity )[index] = transform.scale.z;
+}
+
+uint32_t TransformStorage::Add( const Transform& transform, int spawnTick )
+{
+	if ( !m_freeIndices.empty() )
+	{
+		uint32_t index = m_freeIndices.back();
+		m_freeIndices.pop_back();
+
+		m_live.Write( index, m_capacity, transform );
+		m_lastTick.Write( index, m_capacity, transform );
+		m_currentTick.Write( index, m_capacity, transform );
+		m_spawnTicks[index] = spawnTick;
+
+		return index;
+	}
+
+	if ( m_count == m_capacity )
+	{
+		// All three sets share a capacity, so the history copies stay a single memcpy
+		size_t newCapacity = std::max<size_t>( 64, m_capacity * 2 );
+
+		m_live.Grow( m_capacity, newCapacity );
+		m_lastTick.Grow( m_capacity, newCapacity );
+		m_currentTick.Grow( m_capacity, newCapacity );
+
+		m_capacity = newCapacity;
+	}
+
+	uint32_t index = static_cast<uint32_t>( m_count++ );
+
+	m_live.Write( index, m_capacity, transform );
+	m_lastTick.Write( index, m_capacity, transform );
+	m_currentTick.Write( index, m_capacity, transform );
+	m_spawnTicks.push_back( spawnTick );
+
+	return index;
+}
+
+void TransformStorage::Remove( uint32_t index )
+{
+	if ( index == TRANSFORM_INDEX_INVALID )
+		return;
+
+	// Removed slots stay in the arrays; interpolating them is cheaper than compacting
+	m_freeIndices.push_back( index );
+}
+
+Transform TransformStorage::Get( uint32_t index ) const
+{
+	Transform transform = {};
+	m_live.Read( index, m_capacity, transform );
+	return transform;
+}
+
+void TransformStorage::Set( uint32_t index, const Transform& transform )
+{
+	m_live.Write( index, m_capacity, transform );
+}
+
+Vector3 TransformStorage::GetPosition( uint32_t index ) const
+{
+	return { m_live.Get( POSITION_X, m_capacity )[index], m_live.Get( POSITION_Y, m_capacity )[index],
+	    m_live.Get( POSITION_Z, m_capacity )[index] };
+}
+
+void TransformStorage::SetPosition( uint32_t index, const Vector3& position )
+{
+	m_live.Get( POSITION_X, m_capacity )[index] = position.x;
+	m_live.Get( POSITION_Y, m_capacity )[index] = position.y;
+	m_live.Get( POSITION_Z, m_capacity )[index] = position.z;
+}
+
+Quaternion TransformStorage::GetRotation( uint32_t index ) const
+{
+	return { m_live.Get( ROTATION_X, m_capacity )[index], m_live.Get( ROTATION_Y, m_capacity )[index],
+	    m_live.Get( ROTATION_Z, m_capacity )[index], m_live.Get( ROTATION_W, m_capacity )[index] };
+}
+
+void TransformStorage::SetRotation( uint32_t index, const Quaternion& rotation )
+{
+	m_live.Get( ROTATION_X, m_capacity )[index] = rotation.x;
+	m_live.Get( ROTATION_Y, m_capacity )[index] = rotation.y;
+	m_live.Get( ROTATION_Z, m_capacity )[index] = rotation.z;
+	m_live.Get( ROTATION_W, m_capacity )[index] = rotation.w;
+}
+
+Vector3 TransformStorage::GetScale( uint32_t index ) const
+{
+	return { m_live.Get( SCALE_X, m_capacity )[index], m_live.Get( SCALE_Y, m_capacity )[index],
+	    m_live.Get( SCALE_Z, m_capacity )[index] };
+}
+
+void TransformStorage::SetScale( uint32_t index, const Vector3& scale )
+{
+	m_live.Get( SCALE_X, m_capacity )[index] = scale.x;
+	m_live.Get( SCALE_Y, m_capacity )[index] = scale.y;
+	m_live.Get( SCALE_Z, m_capacity )[index] = scale.z;
+}
+
+void TransformStorage::StoreLastTick()
+{
+	if ( m_capacity == 0 )
+		return;
+
+	std::memcpy( m_lastTick.m_data.data(), m_currentTick.m_data.data(), m_capacity * COMPONENT_COUNT * sizeof( float ) );
+}
+
+void TransformStorage::StoreCurrentTick()
+{
+	if ( m_capacity == 0 )
+		return;
+
+	std::memcpy( m_currentTick.m_data.data(), m_live.m_data.data(), m_capacity * COMPONENT_COUNT * sizeof( float ) );
+}
+
+void TransformStorage::Interpolate( float alpha, int curTick )
+{
+	// Batches are a multiple of four so that only the very last one has a scalar tail
+	Globals::m_jobManager->ParallelFor( m_count, INTERPOLATE_BATCH_SIZE,
+	    [&]( size_t start, size_t end ) { InterpolateRange( alpha, curTick, start, end ); } );
+}
+
+void TransformStorage::InterpolateRange( float alpha, int curTick, size_t start, size_t end )
+{
+	const size_t capacity = m_capacity;
+
+	const float* a[COMPONENT_COUNT];
+	const float* b[COMPONENT_COUNT];
+	float* out[COMPONENT_COUNT];
+
+	for ( size_t c = 0; c < COMPONENT_COUNT; ++c )
+	{
+		a[c] = m_lastTick.Get( ( Component )c, capacity );
+		b[c] = m_currentTick.Get( ( Component )c, capacity );
+		out[c] = m_live.Get( ( Component )c, capacity );
+	}
+
+	const int* spawnTicks = m_spawnTicks.data();
+
+	//
+	// Four entities at a time
+	//
+	const __m128 t = _mm_set1_ps( alpha );
+	const __m128 signMask = _mm_set1_ps( -0.0f );
+	const __m128 epsilon = _mm_set1_ps( 1e-12f );
+	const __m128i curTickVec = _mm_set1_epi32( curTick );
+
+	size_t i = start;
+	for ( ; i + 4 <= end; i += 4 )
+	{
+		// Lanes for entities spawned this tick keep their live transform
+		const __m128 keep = _mm_castsi128_ps(
+		    _mm_cmpeq_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( spawnTicks + i ) ), curTickVec ) );
+
+		// Positions and scales: a + ( b - a ) * t
+		for ( int c : { POSITION_X, POSITION_Y, POSITION_Z, SCALE_X, SCALE_Y, SCALE_Z } )
+		{
+			__m128 va = _mm_loadu_ps( a[c] + i );
+			__m128 vb = _mm_loadu_ps( b[c] + i );
+			__m128 lerped = _mm_add_ps( va, _mm_mul_ps( _mm_sub_ps( vb, va ), t ) );
+			__m128 live = _mm_loadu_ps( out[c] + i );
+
+			_mm_storeu_ps( out[c] + i, _mm_or_ps( _mm_and_ps( keep, live ), _mm_andnot_ps( keep, lerped ) ) );
+		}
+
+		// Rotations: nlerp, flipping b onto the same hemisphere as a
+		__m128 ax = _mm_loadu_ps( a[ROTATION_X] + i );
+		__m128 ay = _mm_loadu_ps( a[ROTATION_Y] + i );
+		__m128 az = _mm_loadu_ps( a[ROTATION_Z] + i );
+		__m128 aw = _mm_loadu_ps( a[ROTATION_W] + i );
+
+		__m128 bx = _mm_loadu_ps( b[ROTATION_X] + i );
+		__m128 by = _mm_loadu_ps( b[ROTATION_Y] + i );
+		__m128 bz = _mm_loadu_ps( b[ROTATION_Z] + i );
+		__m128 bw = _mm_loadu_ps( b[ROTATION_W] + i );
+
+		__m128 dot = _mm_add_ps( _mm_add_ps( _mm_mul_ps( ax, bx ), _mm_mul_ps( ay, by ) ),
+		    _mm_add_ps( _mm_mul_ps( az, bz ), _mm_mul_ps( aw, bw ) ) );
+		__m128 flip = _mm_and_ps( dot, signMask );
+
+		bx = _mm_xor_ps( bx, flip );
+		by = _mm_xor_ps( by, flip );
+		bz = _mm_xor_ps( bz, flip );
+		bw = _mm_xor_ps( bw, flip );
+
+		__m128 qx = _mm_add_ps( ax, _mm_mul_ps( _mm_sub_ps( bx, ax ), t ) );
+		__m128 qy = _mm_add_ps( ay, _mm_mul_ps( _mm_sub_ps( by, ay ), t ) );
+		__m128 qz = _mm_add_ps( az, _mm_mul_ps( _mm_sub_ps( bz, az ), t ) );
+		__m128 qw = _mm_add_ps( aw, _mm_mul_ps( _mm_sub_ps( bw, aw ), t ) );
+
+		__m128 lengthSqr = _mm_add_ps( _mm_add_ps( _mm_mul_ps( qx, qx ), _mm_mul_ps( qy, qy ) ),
+		    _mm_add_ps( _mm_mul_ps( qz, qz ), _mm_mul_ps( qw, qw ) ) );
+		__m128 length = _mm_sqrt_ps( _mm_max_ps( lengthSqr, epsilon ) );
+
+		__m128 rotation[4] = { _mm_div_ps( qx, length ), _mm_div_ps( qy, length ), _mm_div_ps( qz, length ),
+		    _mm_div_ps( qw, length ) };
+
+		for ( int c = 0; c < 4; ++c )
+		{
+			float* dst = out[ROTATION_X + c] + i;
+			__m128 live = _mm_loadu_ps( dst );
+
+			_mm_storeu_ps( dst, _mm_or_ps( _mm_and_ps( keep, live ), _mm_andnot_ps( keep, rotation[c] ) ) );
+		}
+	}
+
+	//
+	// Whatever is left over
+	//
+	for ( ; i < end; ++i )
+	{
+		if ( spawnTicks[i] == curTick )
+			continue;
+
+		for ( int c : { POSITION_X, POSITION_Y, POSITION_Z, SCALE_X, SCALE_Y, SCALE_Z } )
+			out[c][i] = a[c][i] + ( b[c][i] - a[c][i] ) * alpha;
+
+		float dot = a[ROTATION_X][i] * b[ROTATION_X][i] + a[ROTATION_Y][i] * b[ROTATION_Y][i] +
+		            a[ROTATION_Z][i] * b[ROTATION_Z][i] + a[ROTATION_W][i] * b[ROTATION_W][i];
+		float sign = dot < 0.0f ? -1.0f : 1.0f;
+
+		float q[4];
+		float lengthSqr = 0.0f;
+
+		for ( int c = 0; c < 4; ++c )
+		{
+			float qa = a[ROTATION_X + c][i];
+			float qb = b[ROTATION_X + c][i] * sign;
+
+			q[c] = qa + ( qb - qa ) * alpha;
+			lengthSqr += q[c] * q[c];
+		}
+
+		float length = std::sqrt( std::max( lengthSqr, 1e-12f ) );
+
+		for ( int c = 0; c < 4; ++c )
+			out[ROTATION_X + c][i] = q[c] / length;
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <Misc/mathtypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define TRANSFORM_INDEX_INVALID UINT32_MAX
+
+//
+// Entity transforms, stored as a structure of arrays.
+//
+// Each entity owns one index into these arrays. There are three sets of transforms:
+// - the live transform that game code and physics read and write,
+// - the transform at the end of the previous tick,
+// - the transform at the end of the current tick.
+//
+// Keeping every component in its own packed array means that the per-tick history copies are a
+// single memcpy each, and that render interpolation can run over four entities at a time.
+//
+class TransformStorage
+{
+public:
+	enum Component
+	{
+		POSITION_X,
+		POSITION_Y,
+		POSITION_Z,
+		ROTATION_X,
+		ROTATION_Y,
+		ROTATION_Z,
+		ROTATION_W,
+		SCALE_X,
+		SCALE_Y,
+		SCALE_Z,
+
+		COMPONENT_COUNT
+	};
+
+private:
+	// One set of transforms. Component arrays are laid out back to back in a single allocation,
+	// each m_capacity floats long.
+	struct TransformArrays
+	{
+		std::vector<float> m_data;
+
+		inline float* Get( Component component, size_t capacity ) { return m_data.data() + component * capacity; }
+		inline const float* Get( Component component, size_t capacity ) const
+		{
+			return m_data.data() + component * capacity;
+		}
+
+		void Grow( size_t oldCapacity, size_t newCapacity );
+		void Read( uint32_t index, size_t capacity, Transform& transform ) const;
+		void Write( uint32_t index, size_t capacity, const Transform& transform );
+	};
+
+	TransformArrays m_live;
+	TransformArrays m_lastTick;
+	TransformArrays m_currentTick;
+
+	// The tick each entity was spawned on; entities spawned this tick aren't interpolated
+	std::vector<int> m_spawnTicks;
+
+	// Indices that were removed and can be handed out again
+	std::vector<uint32_t> m_freeIndices;
+
+	size_t m_count = 0;
+	size_t m_capacity = 0;
+
+	static constexpr size_t INTERPOLATE_BATCH_SIZE = 4096;
+
+	void InterpolateRange( float alpha, int curTick, size_t start, size_t end );
+
+public:
+	// Reserves a new index, with all three transforms set to the specified transform.
+	uint32_t Add( const Transform& transform, int spawnTick );
+
+	// Releases an index so that it can be re-used by the next Add.
+	void Remove( uint32_t index );
+
+	size_t Count() const { return m_count; }
+
+	Transform Get( uint32_t index ) const;
+	void Set( uint32_t index, const Transform& transform );
+
+	Vector3 GetPosition( uint32_t index ) const;
+	void SetPosition( uint32_t index, const Vector3& position );
+
+	Quaternion GetRotation( uint32_t index ) const;
+	void SetRotation( uint32_t index, const Quaternion& rotation );
+
+	Vector3 GetScale( uint32_t index ) const;
+	void SetScale( uint32_t index, const Vector3& scale );
+
+	// Copies the current tick's transforms into the previous tick's transforms.
+	// Call this at the start of a tick.
+	void StoreLastTick();
+
+	// Copies the live transforms into the current tick's transforms.
+	// Call this at the end of a tick.
+	void StoreCurrentTick();
+
+	// Writes a blend between the previous and current tick's transforms into the live transforms,
+	// for every entity that wasn't spawned on curTick. Positions and scales are linearly
+	// interpolated, rotations are normalized-lerped along the shortest path. Large entity counts are
+	// split across the job manager.
+	void Interpolate( float alpha, int curTick );
+};
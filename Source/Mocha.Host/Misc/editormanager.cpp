@@ -56,6 +56,11 @@ const char* EditorManager::GetGPUName()
 	return Globals::m_renderManager->GetGPUName();
 }
 
+RenderStats EditorManager::GetRenderStats()
+{
+	return Globals::m_renderManager->GetRenderStats();
+}
+
 char* EditorManager::InputText( const char* name, char* inputBuf, int inputLength )
 {
 	ImGui::InputText( name, inputBuf, inputLength, ImGuiInputTextFlags_EnterReturnsTrue );
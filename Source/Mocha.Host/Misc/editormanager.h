@@ -3,6 +3,7 @@
 #include <Misc/globalvars.h>
 #include <Misc/subsystem.h>
 #include <Rendering/Assets/texture.h>
+#include <Rendering/rendermanager.h>
 #include <Root/root.h>
 #include <Util/util.h>
 
@@ -24,6 +25,7 @@ public:
 	GENERATE_BINDINGS void TextMonospace( const char* text );
 	GENERATE_BINDINGS void TextLight( const char* text );
 	GENERATE_BINDINGS const char* GetGPUName();
+	GENERATE_BINDINGS RenderStats GetRenderStats();
 	GENERATE_BINDINGS char* InputText( const char* name, char* inputBuf, int inputLength );
 	GENERATE_BINDINGS void RenderViewDropdown();
 	GENERATE_BINDINGS void Image( Texture* texture, uint32_t textureWidth, uint32_t textureHeight, int x, int y );
@@ -14,6 +14,12 @@ namespace EngineProperties
 	    "project.current", "Samples\\mocha-minimal\\project.json", CVarFlags::Archive, "Which project should we load?" );
 	BoolCVar Raytracing( "render.raytracing", true, CVarFlags::Archive, "Enable raytracing" );
 	BoolCVar Renderdoc( "render.renderdoc", false, CVarFlags::Archive, "Enable renderdoc" );
+	BoolCVar Bindless( "render.bindless", false, CVarFlags::Archive,
+	    "Give shaders every texture through one bindless array instead of per-material descriptors (needs a restart)" );
+	BoolCVar GpuDriven( "render.gpu_driven", false, CVarFlags::Archive,
+	    "Cull on the GPU and draw with multi-draw indirect instead of a draw call per batch (needs a restart)" );
+	BoolCVar Recording( "render.recording", false, CVarFlags::None,
+	    "Record render calls in memory instead of drawing anything, for profiling without a GPU (needs a restart)" );
 
 	StringCVar ServerName( "server.name", "Mocha Dedicated Server", CVarFlags::None, "Server name" );
 	StringCVar ServerPassword( "server.password", "", CVarFlags::None, "Server password" );
@@ -36,6 +42,7 @@ namespace Globals
 	CVarManager* m_cvarManager;
 	ProjectManager* m_projectManager;
 	NetworkingManager* m_networkingManager;
+	JobManager* m_jobManager;
 
 	float m_curTime;
 	float m_frameDeltaTime;
@@ -14,6 +14,9 @@ namespace EngineProperties
 	extern StringCVar LoadedProject;
 	extern BoolCVar Raytracing;
 	extern BoolCVar Renderdoc;
+	extern BoolCVar Bindless;
+	extern BoolCVar GpuDriven;
+	extern BoolCVar Recording;
 
 	extern StringCVar ServerHostname;
 	extern StringCVar ServerPassword;
@@ -36,6 +39,7 @@ class BaseRenderContext;
 class CVarManager;
 class ProjectManager;
 class NetworkingManager;
+class JobManager;
 
 struct Vector3;
 struct Quaternion;
@@ -56,6 +60,7 @@ namespace Globals
 	extern CVarManager* m_cvarManager;
 	extern ProjectManager* m_projectManager;
 	extern NetworkingManager* m_networkingManager;
+	extern JobManager* m_jobManager;
 
 	extern float m_curTime;
 	extern float m_frameDeltaTime;
@@ -1,44 +1,92 @@
 #pragma once
 
 #include <Misc/defs.h>
-#include <algorithm>
-#include <atomic>
-#include <execution>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
-#include <unordered_map>
+#include <spdlog/spdlog.h>
+#include <vector>
 
 // A class that manages a collection of objects of type T, indexed by a handle.
+//
+// This is a slot map: objects live in a dense array so that iteration is contiguous, and each
+// handle refers to a slot that stores the object's current position in that array. Slots carry a
+// generation which is bumped whenever their object is removed, so a stale handle will never resolve
+// to an object that was added after it. A slot whose generation runs out is retired rather than
+// wrapping around, for the same reason.
 template <typename T>
 class HandleMap
 {
 private:
-	// A map of objects, indexed by their handle index.
-	std::unordered_map<Handle, std::shared_ptr<T>> m_objects;
+	// The lower bits of a handle are the slot index, the upper bits are the slot's generation.
+	static constexpr uint32_t INDEX_BITS = 20;
+	static constexpr uint32_t INDEX_MASK = ( 1u << INDEX_BITS ) - 1;
+	static constexpr uint32_t GENERATION_MASK = UINT32_MAX >> INDEX_BITS;
+
+	// The last slot index is reserved so that a valid handle can never equal HANDLE_INVALID.
+	static constexpr uint32_t MAX_SLOTS = INDEX_MASK;
+
+	struct Slot
+	{
+		uint32_t denseIndex;
+		uint32_t generation;
+	};
+
+	// Densely packed objects. Removing an object moves the last one into its place.
+	std::vector<std::shared_ptr<T>> m_objects;
+
+	// Which slot each dense object belongs to, so that we can patch slots up after a move.
+	std::vector<uint32_t> m_denseToSlot;
+
+	// Sparse slots, indexed by the lower bits of a handle.
+	std::vector<Slot> m_slots;
+
+	// Slots that can be re-used by the next Add.
+	std::vector<uint32_t> m_freeSlots;
 
 	// Thread-safe synchronisation
 	std::shared_mutex m_mutex;
 
-	// The current index to use when inserting a new object into the map.
-	std::atomic<Handle> m_nextIndex;
+	static inline Handle MakeHandle( uint32_t slotIndex, uint32_t generation )
+	{
+		return slotIndex | ( generation << INDEX_BITS );
+	}
+
+	// Returns the dense index for a handle, or UINT32_MAX if the handle is stale or invalid.
+	// The caller must hold m_mutex.
+	uint32_t Resolve( Handle handle ) const;
+
+	// Returns HANDLE_INVALID if there are no slots left. The caller must hold m_mutex.
+	Handle Insert( std::shared_ptr<T> objectPtr );
 
 public:
-	// Adds the specified object to the map and returns a handle to it.
+	// Adds the specified object to the map and returns a handle to it, or HANDLE_INVALID (and drops the
+	// object) if the map is full.
 	Handle Add( T object );
 
 	// Removes the specified object from the map, based on a handle.
+	// Any copies of the handle will no longer resolve to anything.
 	void RemoveAt( Handle handle );
 
-	// Removes the first instance of the specified object from the map.
-	void Remove( T object );
+	// Returns true if the handle refers to an object that is still in the map.
+	bool IsValid( Handle handle );
 
-	// Finds the first instance of the specified object from the map.
-	Handle Find( T object );
+	// Returns the number of objects in the map.
+	size_t Count();
 
-	// Returns a pointer to the object associated with the specified handle.
+	// Returns the slot a handle refers to. No two live objects share a slot, and slots are re-used
+	// once their object is removed, so this stays small and can be used to index other arrays.
+	static inline uint32_t GetSlotIndex( Handle handle ) { return handle & INDEX_MASK; }
+
+	// Returns a pointer to the object associated with the specified handle, or nullptr if the handle
+	// is stale or invalid.
 	std::shared_ptr<T> Get( Handle handle );
 
+	// Same as calling Get for each handle, but only takes the lock once. outObjects ends up with one
+	// entry per handle, in the same order, and nullptr for any that are stale or invalid.
+	void GetMany( const std::vector<Handle>& handles, std::vector<std::shared_ptr<T>>& outObjects );
+
 	// Use this if you want to get a derived type.
 	template <typename T1>
 	std::shared_ptr<T1> GetSpecific( Handle handle );
@@ -48,67 +96,125 @@ public:
 	Handle AddSpecific( T1 object );
 
 	// Calls the specified function for each object managed by this HandleMap.
-	// The function should take a std::unique_ptr<T> as its argument.
-	void ForEach( std::function<void( std::shared_ptr<T> object )> func );
+	// Objects are visited in storage order, which is not necessarily insertion order.
+	void ForEach( std::function<void( const std::shared_ptr<T>& object )> func );
 
 	// Calls the specified function for each object managed by this HandleMap.
-	// The function should take a Handle and a std::unique_ptr<T> as its arguments.
-	void For( std::function<void( Handle handle, std::shared_ptr<T> object )> func );
+	// The function should take a Handle and a std::shared_ptr<T> as its arguments.
+	void For( std::function<void( Handle handle, const std::shared_ptr<T>& object )> func );
 };
 
 template <typename T>
-inline Handle HandleMap<T>::Add( T object )
+inline uint32_t HandleMap<T>::Resolve( Handle handle ) const
 {
-	std::unique_lock lock( m_mutex );
+	uint32_t slotIndex = handle & INDEX_MASK;
+	uint32_t generation = handle >> INDEX_BITS;
+
+	if ( slotIndex >= m_slots.size() )
+		return UINT32_MAX;
+
+	const Slot& slot = m_slots[slotIndex];
 
-	Handle handle = m_nextIndex;
+	if ( slot.generation != generation )
+		return UINT32_MAX;
 
-	// Create a shared pointer to the object.
-	auto objectPtr = std::make_shared<T>( object );
+	return slot.denseIndex;
+}
 
-	// Add the object to the map.
-	m_objects[handle] = objectPtr;
+template <typename T>
+inline Handle HandleMap<T>::Insert( std::shared_ptr<T> objectPtr )
+{
+	uint32_t slotIndex;
 
-	// Increment index for next object
-	m_nextIndex++;
+	if ( !m_freeSlots.empty() )
+	{
+		slotIndex = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		if ( m_slots.size() >= MAX_SLOTS )
+		{
+			spdlog::error( "HandleMap is full ({} slots), can't add another object", MAX_SLOTS );
+			return HANDLE_INVALID;
+		}
 
-	return handle;
+		slotIndex = static_cast<uint32_t>( m_slots.size() );
+		m_slots.push_back( { UINT32_MAX, 0 } );
+	}
+
+	Slot& slot = m_slots[slotIndex];
+	slot.denseIndex = static_cast<uint32_t>( m_objects.size() );
+
+	m_objects.push_back( std::move( objectPtr ) );
+	m_denseToSlot.push_back( slotIndex );
+
+	return MakeHandle( slotIndex, slot.generation );
 }
 
 template <typename T>
-inline void HandleMap<T>::RemoveAt( Handle handle )
+inline Handle HandleMap<T>::Add( T object )
 {
 	std::unique_lock lock( m_mutex );
 
-	m_objects.erase( handle );
+	return Insert( std::make_shared<T>( object ) );
 }
 
 template <typename T>
-inline void HandleMap<T>::Remove( T object )
+inline void HandleMap<T>::RemoveAt( Handle handle )
 {
 	std::unique_lock lock( m_mutex );
 
-	Handle targetHandle = Find( object );
-	if ( targetHandle != HANDLE_INVALID )
+	uint32_t denseIndex = Resolve( handle );
+
+	if ( denseIndex == UINT32_MAX )
+		return;
+
+	uint32_t slotIndex = handle & INDEX_MASK;
+	uint32_t lastIndex = static_cast<uint32_t>( m_objects.size() - 1 );
+
+	// Move the last object into the hole so that the array stays dense
+	if ( denseIndex != lastIndex )
 	{
-		RemoveAt( targetHandle );
+		m_objects[denseIndex] = std::move( m_objects[lastIndex] );
+		m_denseToSlot[denseIndex] = m_denseToSlot[lastIndex];
+		m_slots[m_denseToSlot[denseIndex]].denseIndex = denseIndex;
 	}
+
+	m_objects.pop_back();
+	m_denseToSlot.pop_back();
+
+	// Invalidate any outstanding handles to this slot
+	Slot& slot = m_slots[slotIndex];
+	slot.denseIndex = UINT32_MAX;
+
+	// Wrapping back to generation 0 would bring old handles back to life, so a slot that has used up
+	// every generation is never handed out again
+	if ( slot.generation == GENERATION_MASK )
+	{
+		spdlog::warn( "HandleMap slot {} has run out of generations and is retired", slotIndex );
+		return;
+	}
+
+	slot.generation++;
+
+	m_freeSlots.push_back( slotIndex );
 }
 
 template <typename T>
-inline Handle HandleMap<T>::Find( T object )
+inline bool HandleMap<T>::IsValid( Handle handle )
 {
-	std::unique_lock lock( m_mutex );
+	std::shared_lock lock( m_mutex );
 
-	for ( const auto& [handle, object] : m_objects )
-	{
-		if ( typeid( *object ) == typeid( T ) )
-		{
-			return handle;
-		}
-	}
+	return Resolve( handle ) != UINT32_MAX;
+}
+
+template <typename T>
+inline size_t HandleMap<T>::Count()
+{
+	std::shared_lock lock( m_mutex );
 
-	return HANDLE_INVALID;
+	return m_objects.size();
 }
 
 // Returns a pointer to the object associated with the specified handle.
@@ -117,9 +223,26 @@ inline std::shared_ptr<T> HandleMap<T>::Get( Handle handle )
 {
 	std::shared_lock lock( m_mutex );
 
-	std::shared_ptr<T> object = m_objects[handle];
+	uint32_t denseIndex = Resolve( handle );
+
+	if ( denseIndex == UINT32_MAX )
+		return nullptr;
 
-	return object;
+	return m_objects[denseIndex];
+}
+
+template <typename T>
+inline void HandleMap<T>::GetMany( const std::vector<Handle>& handles, std::vector<std::shared_ptr<T>>& outObjects )
+{
+	std::shared_lock lock( m_mutex );
+
+	outObjects.resize( handles.size() );
+
+	for ( size_t i = 0; i < handles.size(); ++i )
+	{
+		uint32_t denseIndex = Resolve( handles[i] );
+		outObjects[i] = denseIndex == UINT32_MAX ? nullptr : m_objects[denseIndex];
+	}
 }
 
 // Use this if you want to get a derived type.
@@ -142,28 +265,16 @@ inline Handle HandleMap<T>::AddSpecific( T1 object )
 	static_assert( std::is_base_of<T, T1>::value, "T1 must be derived from T" );
 	std::unique_lock lock( m_mutex );
 
-	Handle handle = m_nextIndex;
-
-	// Create a shared pointer to the object.
-	auto objectPtr = std::make_shared<T1>( object );
-
-	// Add the object to the map.
-	m_objects[handle] = objectPtr;
-
-	// Increment index for next object
-	m_nextIndex++;
-
-	return handle;
+	return Insert( std::make_shared<T1>( object ) );
 }
 
 // Calls the specified function for each object managed by this HandleMap.
-// The function should take a std::shared_ptr<T> as its argument.
 template <typename T>
-inline void HandleMap<T>::ForEach( std::function<void( std::shared_ptr<T> object )> func )
+inline void HandleMap<T>::ForEach( std::function<void( const std::shared_ptr<T>& object )> func )
 {
 	std::shared_lock lock( m_mutex );
 
-	for ( const auto& [handle, object] : m_objects )
+	for ( const auto& object : m_objects )
 	{
 		func( object );
 	}
@@ -172,12 +283,13 @@ inline void HandleMap<T>::ForEach( std::function<void( std::shared_ptr<T> object
 // Calls the specified function for each object managed by this HandleMap.
 // The function should take a Handle as its argument.
 template <typename T>
-inline void HandleMap<T>::For( std::function<void( Handle handle, std::shared_ptr<T> object )> func )
+inline void HandleMap<T>::For( std::function<void( Handle handle, const std::shared_ptr<T>& object )> func )
 {
 	std::shared_lock lock( m_mutex );
 
-	for ( const auto& [handle, object] : m_objects )
+	for ( size_t i = 0; i < m_objects.size(); ++i )
 	{
-		func( handle, object );
+		uint32_t slotIndex = m_denseToSlot[i];
+		func( MakeHandle( slotIndex, m_slots[slotIndex].generation ), m_objects[i] );
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,351 @@
+#include "jobmanager.h"
+
+#include <Misc/cvarmanager.h>
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+IntCVar jobThreads(
+    "job.threads", 0, CVarFlags::Archive, "Number of job worker threads. 0 uses one per core, minus the main thread" );
+
+// Which deque belongs to this thread; -1 for threads that aren't part of the pool
+static thread_local int t_workerIndex = -1;
+
+//
+// JobDeque
+//
+bool JobDeque::Push( Job* job )
+{
+	int64_t bottom = m_bottom.load( std::memory_order_relaxed );
+	int64_t top = m_top.load( std::memory_order_acquire );
+
+	if ( bottom - top >= CAPACITY )
+		return false;
+
+	m_buffer[bottom & MASK].store( job, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+	m_bottom.store( bottom + 1, std::memory_order_relaxed );
+
+	return true;
+}
+
+Job* JobDeque::Pop()
+{
+	int64_t bottom = m_bottom.load( std::memory_order_relaxed ) - 1;
+	m_bottom.store( bottom, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	int64_t top = m_top.load( std::memory_order_relaxed );
+
+	if ( top > bottom )
+	{
+		// Empty
+		m_bottom.store( bottom + 1, std::memory_order_relaxed );
+		return nullptr;
+	}
+
+	Job* job = m_buffer[bottom & MASK].load( std::memory_order_relaxed );
+
+	if ( top == bottom )
+	{
+		// Last job - race any thieves for it
+		if ( !m_top.compare_exchange_strong( top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+			job = nullptr;
+
+		m_bottom.store( bottom + 1, std::memory_order_relaxed );
+	}
+
+	return job;
+}
+
+Job* JobDeque::Steal()
+{
+	int64_t top = m_top.load( std::memory_order_acquire );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	int64_t bottom = m_bottom.load( std::memory_order_acquire );
+
+	if ( top >= bottom )
+		return nullptr;
+
+	Job* job = m_buffer[top & MASK].load( std::memory_order_relaxed );
+
+	if ( !m_top.compare_exchange_strong( top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+		return nullptr;
+
+	return job;
+}
+
+//
+// JobManager
+//
+void JobManager::Startup()
+{
+	int workerCount = jobThreads.GetValue();
+
+	if ( workerCount <= 0 )
+		workerCount = std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) - 1 );
+
+	// Deque 0 belongs to the main thread
+	for ( int i = 0; i < workerCount + 1; ++i )
+		m_deques.push_back( std::make_unique<JobDeque>() );
+
+	t_workerIndex = 0;
+
+	for ( int i = 1; i < workerCount + 1; ++i )
+		m_threads.emplace_back( &JobManager::WorkerMain, this, i );
+
+	spdlog::info( "Job manager started with {} worker threads", workerCount );
+}
+
+void JobManager::Shutdown()
+{
+	{
+		std::lock_guard lock( m_sleepMutex );
+		m_isShuttingDown = true;
+	}
+
+	m_sleepCondition.notify_all();
+
+	for ( auto& thread : m_threads )
+		thread.join();
+
+	m_threads.clear();
+
+	// Anything left over never got a chance to run
+	while ( Job* job = FindJob() )
+		delete job;
+
+	for ( Job* job : m_mainThreadJobs )
+		delete job;
+
+	m_mainThreadJobs.clear();
+}
+
+void JobManager::WorkerMain( int workerIndex )
+{
+	t_workerIndex = workerIndex;
+
+	while ( !m_isShuttingDown.load( std::memory_order_acquire ) )
+	{
+		if ( Job* job = FindJob() )
+		{
+			Execute( job );
+			continue;
+		}
+
+		std::unique_lock lock( m_sleepMutex );
+		m_sleepCondition.wait(
+		    lock, [&]() { return m_queuedJobCount.load( std::memory_order_acquire ) > 0 || m_isShuttingDown.load(); } );
+	}
+}
+
+void JobManager::Enqueue( Job* job )
+{
+	bool isQueued = false;
+
+	if ( t_workerIndex >= 0 )
+		isQueued = m_deques[t_workerIndex]->Push( job );
+
+	if ( !isQueued )
+	{
+		std::lock_guard lock( m_sharedMutex );
+		m_sharedJobs.push_back( job );
+	}
+
+	m_queuedJobCount.fetch_add( 1, std::memory_order_release );
+	WakeWorkers( 1 );
+}
+
+void JobManager::WakeWorkers( int count )
+{
+	// Take the lock so that a worker can't miss this between checking for work and going to sleep
+	{
+		std::lock_guard lock( m_sleepMutex );
+	}
+
+	if ( count == 1 )
+		m_sleepCondition.notify_one();
+	else
+		m_sleepCondition.notify_all();
+}
+
+Job* JobManager::FindJob()
+{
+	const int self = t_workerIndex;
+	Job* job = nullptr;
+
+	// Our own work first, newest first
+	if ( self >= 0 )
+		job = m_deques[self]->Pop();
+
+	if ( job == nullptr )
+	{
+		std::lock_guard lock( m_sharedMutex );
+
+		if ( !m_sharedJobs.empty() )
+		{
+			job = m_sharedJobs.front();
+			m_sharedJobs.pop_front();
+		}
+	}
+
+	// Steal from everyone else, starting somewhere different each time so that we don't all pile
+	// onto the same victim
+	if ( job == nullptr )
+	{
+		static thread_local uint32_t stealSeed = static_cast<uint32_t>( self + 1 ) * 2654435761u;
+		stealSeed = stealSeed * 1664525u + 1013904223u;
+
+		const size_t dequeCount = m_deques.size();
+		const size_t start = stealSeed % dequeCount;
+
+		for ( size_t i = 0; i < dequeCount && job == nullptr; ++i )
+		{
+			size_t victim = ( start + i ) % dequeCount;
+
+			if ( static_cast<int>( victim ) == self )
+				continue;
+
+			job = m_deques[victim]->Steal();
+		}
+	}
+
+	if ( job != nullptr )
+		m_queuedJobCount.fetch_sub( 1, std::memory_order_acq_rel );
+
+	return job;
+}
+
+void JobManager::Execute( Job* job )
+{
+	job->func();
+
+	if ( job->counter != nullptr )
+		Release( job->counter, 1 );
+
+	delete job;
+}
+
+void JobManager::Release( JobCounter* counter, int count )
+{
+	// Anything other than the final release is lock-free. The final one happens under the counter's
+	// lock, so that Wait can be sure we're done touching the counter before it returns.
+	int32_t current = counter->m_count.load( std::memory_order_relaxed );
+
+	while ( current > count )
+	{
+		if ( counter->m_count.compare_exchange_weak( current, current - count, std::memory_order_acq_rel ) )
+			return;
+	}
+
+	std::vector<Job*> waitingJobs;
+
+	{
+		std::lock_guard lock( counter->m_mutex );
+
+		if ( counter->m_count.fetch_sub( count, std::memory_order_acq_rel ) - count != 0 )
+			return;
+
+		std::swap( waitingJobs, counter->m_waitingJobs );
+	}
+
+	for ( Job* job : waitingJobs )
+		Enqueue( job );
+}
+
+void JobManager::Schedule( std::function<void()> func, JobCounter* counter, JobCounter* dependency )
+{
+	Job* job = new Job{ std::move( func ), counter };
+
+	if ( counter != nullptr )
+		counter->m_count.fetch_add( 1, std::memory_order_acq_rel );
+
+	if ( dependency != nullptr )
+	{
+		std::lock_guard lock( dependency->m_mutex );
+
+		if ( !dependency->IsDone() )
+		{
+			dependency->m_waitingJobs.push_back( job );
+			return;
+		}
+	}
+
+	Enqueue( job );
+}
+
+void JobManager::ScheduleOnMainThread( std::function<void()> func, JobCounter* counter )
+{
+	Job* job = new Job{ std::move( func ), counter };
+
+	if ( counter != nullptr )
+		counter->m_count.fetch_add( 1, std::memory_order_acq_rel );
+
+	std::lock_guard lock( m_mainThreadMutex );
+	m_mainThreadJobs.push_back( job );
+}
+
+void JobManager::Wait( JobCounter* counter )
+{
+	while ( !counter->IsDone() )
+	{
+		// Main-thread jobs might be what we're waiting on
+		if ( t_workerIndex == 0 )
+			RunMainThreadJobs();
+
+		if ( !RunPendingJob() )
+			std::this_thread::yield();
+	}
+
+	// Whoever released the counter does so under its lock; wait for them to let go
+	std::lock_guard lock( counter->m_mutex );
+}
+
+bool JobManager::RunPendingJob()
+{
+	Job* job = FindJob();
+
+	if ( job == nullptr )
+		return false;
+
+	Execute( job );
+	return true;
+}
+
+void JobManager::RunMainThreadJobs()
+{
+	std::vector<Job*> jobs;
+
+	{
+		std::lock_guard lock( m_mainThreadMutex );
+		std::swap( jobs, m_mainThreadJobs );
+	}
+
+	for ( Job* job : jobs )
+		Execute( job );
+}
+
+void JobManager::ParallelFor( size_t count, size_t batchSize, std::function<void( size_t start, size_t end )> func )
+{
+	if ( count == 0 )
+		return;
+
+	batchSize = std::max<size_t>( batchSize, 1 );
+
+	if ( count <= batchSize || GetThreadCount() <= 1 )
+	{
+		func( 0, count );
+		return;
+	}
+
+	JobCounter counter;
+
+	for ( size_t start = batchSize; start < count; start += batchSize )
+	{
+		size_t end = std::min( start + batchSize, count );
+		Schedule( [&func, start, end]() { func( start, end ); }, &counter );
+	}
+
+	// Do the first batch ourselves rather than sitting idle
+	func( 0, std::min( batchSize, count ) );
+
+	Wait( &counter );
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <Misc/subsystem.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+struct Job
+{
+	std::function<void()> func;
+
+	// Decremented once this job has finished running; can be nullptr
+	JobCounter* counter;
+};
+
+//
+// Counts outstanding jobs. A counter is "done" when it reaches zero; jobs can be made to wait on a
+// counter, in which case they are only queued once it hits zero.
+//
+class JobCounter
+{
+	friend class JobManager;
+
+private:
+	std::atomic<int32_t> m_count = 0;
+
+	// Jobs that are waiting for this counter to hit zero
+	std::mutex m_mutex;
+	std::vector<Job*> m_waitingJobs;
+
+public:
+	inline bool IsDone() const { return m_count.load( std::memory_order_acquire ) == 0; }
+};
+
+//
+// Fixed-size Chase-Lev work-stealing deque. Only the owning thread may Push / Pop (from the bottom);
+// any thread may Steal (from the top).
+//
+class JobDeque
+{
+private:
+	static constexpr int64_t CAPACITY = 4096;
+	static constexpr int64_t MASK = CAPACITY - 1;
+
+	alignas( 64 ) std::atomic<int64_t> m_top = 0;
+	alignas( 64 ) std::atomic<int64_t> m_bottom = 0;
+	std::unique_ptr<std::atomic<Job*>[]> m_buffer = std::make_unique<std::atomic<Job*>[]>( CAPACITY );
+
+public:
+	// Returns false if the deque is full.
+	bool Push( Job* job );
+	Job* Pop();
+	Job* Steal();
+};
+
+//
+// Engine-wide work-stealing job scheduler.
+//
+// Every worker thread owns a deque; the main thread owns deque 0. Threads push to and pop from
+// their own deque and steal from others' when they run dry. Jobs scheduled from threads that aren't
+// part of the pool go through a shared queue instead.
+//
+// Main-thread jobs are kept separately and only ever run from RunMainThreadJobs (or while the main
+// thread is inside Wait).
+//
+class JobManager : ISubSystem
+{
+private:
+	std::vector<std::thread> m_threads;
+	std::vector<std::unique_ptr<JobDeque>> m_deques;
+
+	// Jobs scheduled from outside the pool, or that didn't fit in a deque
+	std::mutex m_sharedMutex;
+	std::deque<Job*> m_sharedJobs;
+
+	std::mutex m_mainThreadMutex;
+	std::vector<Job*> m_mainThreadJobs;
+
+	// Sleeping workers wait on this until there's something to do
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCondition;
+	std::atomic<int32_t> m_queuedJobCount = 0;
+
+	std::atomic<bool> m_isShuttingDown = false;
+
+	void WorkerMain( int workerIndex );
+
+	void Enqueue( Job* job );
+	void WakeWorkers( int count );
+
+	Job* FindJob();
+	void Execute( Job* job );
+
+	void Release( JobCounter* counter, int count );
+
+public:
+	void Startup() override;
+	void Shutdown() override;
+
+	// Number of threads that run jobs, including the main thread.
+	inline int GetThreadCount() const { return static_cast<int>( m_deques.size() ); }
+
+	// Queues func to run on any thread. If counter is set, it is incremented now and decremented once
+	// func has run. If dependency is set, func won't start until dependency is done.
+	void Schedule( std::function<void()> func, JobCounter* counter = nullptr, JobCounter* dependency = nullptr );
+
+	// Queues func to run on the main thread, the next time it calls RunMainThreadJobs or Wait.
+	void ScheduleOnMainThread( std::function<void()> func, JobCounter* counter = nullptr );
+
+	// Runs jobs on the calling thread until counter is done.
+	void Wait( JobCounter* counter );
+
+	// Runs one queued job on the calling thread, if there is one. Returns false if there was nothing
+	// to do.
+	bool RunPendingJob();
+
+	// Runs any jobs that were queued with ScheduleOnMainThread. Must be called from the main thread.
+	void RunMainThreadJobs();
+
+	// Splits [0, count) into batches of batchSize and runs func( start, end ) on each of them across
+	// the pool, returning once they have all finished.
+	void ParallelFor( size_t count, size_t batchSize, std::function<void( size_t start, size_t end )> func );
+};
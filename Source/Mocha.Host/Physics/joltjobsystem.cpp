@@ -0,0 +1,122 @@
+#include "joltjobsystem.h"
+
+#include <Misc/jobmanager.h>
+#include <thread>
+
+//
+// BarrierImpl
+//
+void JoltJobSystem::BarrierImpl::AddJob( const JobHandle& job )
+{
+	// SetBarrier fails if the job has already finished, in which case there's nothing to wait for
+	if ( !job.GetPtr()->SetBarrier( this ) )
+		return;
+
+	m_pendingCount.fetch_add( 1, std::memory_order_acq_rel );
+
+	std::lock_guard lock( m_mutex );
+	m_jobs.push_back( job );
+}
+
+void JoltJobSystem::BarrierImpl::AddJobs( const JobHandle* jobs, JPH::uint numJobs )
+{
+	for ( JPH::uint i = 0; i < numJobs; ++i )
+		AddJob( jobs[i] );
+}
+
+void JoltJobSystem::BarrierImpl::OnJobFinished( Job* job )
+{
+	m_pendingCount.fetch_sub( 1, std::memory_order_acq_rel );
+}
+
+void JoltJobSystem::BarrierImpl::Wait()
+{
+	// Help out instead of blocking; the jobs we're waiting on might be sat in our own queue
+	while ( m_pendingCount.load( std::memory_order_acquire ) > 0 )
+	{
+		if ( !m_jobSystem->m_jobManager->RunPendingJob() )
+			std::this_thread::yield();
+	}
+
+	std::lock_guard lock( m_mutex );
+	m_jobs.clear();
+}
+
+//
+// JoltJobSystem
+//
+JoltJobSystem::JoltJobSystem( JobManager* jobManager, JPH::uint maxJobs )
+    : m_jobManager( jobManager )
+{
+	m_jobs.Init( maxJobs, maxJobs );
+}
+
+int JoltJobSystem::GetMaxConcurrency() const
+{
+	return m_jobManager->GetThreadCount();
+}
+
+JPH::JobSystem::JobHandle JoltJobSystem::CreateJob(
+    const char* name, JPH::ColorArg color, const JobFunction& jobFunction, JPH::uint32 numDependencies )
+{
+	JPH::uint32 index;
+
+	for ( ;; )
+	{
+		index = m_jobs.ConstructObject( name, color, this, jobFunction, numDependencies );
+
+		if ( index != AvailableJobs::cInvalidObjectIndex )
+			break;
+
+		// Out of jobs, which is normal under load; help run queued work until some are freed up
+		if ( !m_jobManager->RunPendingJob() )
+			std::this_thread::yield();
+	}
+
+	Job* job = &m_jobs.Get( index );
+
+	// Grab a handle before queueing so that the job can't be freed from under us
+	JobHandle handle( job );
+
+	if ( numDependencies == 0 )
+		QueueJob( job );
+
+	return handle;
+}
+
+void JoltJobSystem::QueueJob( Job* job )
+{
+	// The reference is dropped once the job has run
+	job->AddRef();
+
+	m_jobManager->Schedule( [job]() {
+		job->Execute();
+		job->Release();
+	} );
+}
+
+void JoltJobSystem::QueueJobs( Job** jobs, JPH::uint numJobs )
+{
+	for ( JPH::uint i = 0; i < numJobs; ++i )
+		QueueJob( jobs[i] );
+}
+
+void JoltJobSystem::FreeJob( Job* job )
+{
+	m_jobs.DestructObject( job );
+}
+
+JPH::JobSystem::Barrier* JoltJobSystem::CreateBarrier()
+{
+	return new BarrierImpl( this );
+}
+
+void JoltJobSystem::DestroyBarrier( Barrier* barrier )
+{
+	delete barrier;
+}
+
+void JoltJobSystem::WaitForJobs( Barrier* barrier )
+{
+	static_cast<BarrierImpl*>( barrier )->Wait();
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Core/FixedSizeFreeList.h>
+#include <Jolt/Core/JobSystem.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+class JobManager;
+
+//
+// Runs Jolt's jobs on the engine's JobManager, rather than on a thread pool of Jolt's own.
+//
+class JoltJobSystem : public JPH::JobSystem
+{
+private:
+	class BarrierImpl : public Barrier
+	{
+	private:
+		JoltJobSystem* m_jobSystem;
+
+		// Jobs added to this barrier that haven't finished yet
+		std::atomic<int32_t> m_pendingCount = 0;
+
+		// Keep the jobs alive until we've waited on them
+		std::mutex m_mutex;
+		std::vector<JobHandle> m_jobs;
+
+	protected:
+		void OnJobFinished( Job* job ) override;
+
+	public:
+		BarrierImpl( JoltJobSystem* jobSystem )
+		    : m_jobSystem( jobSystem )
+		{
+		}
+
+		void AddJob( const JobHandle& job ) override;
+		void AddJobs( const JobHandle* jobs, JPH::uint numJobs ) override;
+
+		void Wait();
+	};
+
+	JobManager* m_jobManager;
+
+	using AvailableJobs = JPH::FixedSizeFreeList<Job>;
+	AvailableJobs m_jobs;
+
+protected:
+	void QueueJob( Job* job ) override;
+	void QueueJobs( Job** jobs, JPH::uint numJobs ) override;
+	void FreeJob( Job* job ) override;
+
+public:
+	JoltJobSystem( JobManager* jobManager, JPH::uint maxJobs );
+
+	int GetMaxConcurrency() const override;
+
+	JobHandle CreateJob( const char* name, JPH::ColorArg color, const JobFunction& jobFunction,
+	    JPH::uint32 numDependencies = 0 ) override;
+
+	Barrier* CreateBarrier() override;
+	void DestroyBarrier( Barrier* barrier ) override;
+	void WaitForJobs( Barrier* barrier ) override;
+};
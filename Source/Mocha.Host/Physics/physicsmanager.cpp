@@ -1,12 +1,22 @@
 #include "physicsmanager.h"
 
 #include <Entities/entitymanager.h>
+#include <Misc/cvarmanager.h>
 #include <Misc/globalvars.h>
+#include <Misc/jobmanager.h>
+#include <Physics/joltjobsystem.h>
 #include <Root/clientroot.h>
+#include <algorithm>
 #include <cstdarg>
 #include <iostream>
 #include <thread>
 
+BoolCVar physicsAsync( "physics.async", false, CVarFlags::Archive,
+    "Step physics on worker threads while the game updates, applying the results a tick later" );
+
+BoolCVar physicsTraceWait( "physics.trace_wait", false, CVarFlags::Archive,
+    "Make traces wait for a running async step and query the live world, instead of last tick's snapshot" );
+
 // Callback for traces
 static void TraceImpl( const char* inFMT, ... )
 {
@@ -35,9 +45,8 @@ PhysicsManager::PhysicsManager()
 
 	m_physicsInstance->m_tempAllocator = new JPH::TempAllocatorImpl( 10 * 1024 * 1024 );
 
-	// JobSystemThreadPool is an example implementation.
-	m_physicsInstance->m_jobSystem =
-	    new JPH::JobSystemThreadPool( JPH::cMaxPhysicsJobs, JPH::cMaxPhysicsBarriers, JPH::thread::hardware_concurrency() - 1 );
+	// Run on the engine's job manager so that physics shares its threads with everything else
+	m_physicsInstance->m_jobSystem = new JoltJobSystem( Globals::m_jobManager, JPH::cMaxPhysicsJobs );
 }
 
 void PhysicsManager::Startup()
@@ -45,7 +54,9 @@ void PhysicsManager::Startup()
 	const JPH::uint numBodyMutexes = 0;
 	const JPH::uint maxBodyPairs = 65536;
 	const JPH::uint maxContactConstraints = 10240;
-	const JPH::uint maxBodies = 65536;
+	const JPH::uint maxBodies = MAX_BODIES;
+
+	m_bodyEntityHandles.assign( maxBodies, UINT32_MAX );
 
 	// Create the actual physics system.
 	m_physicsInstance->m_physicsSystem.Init( maxBodies, numBodyMutexes, maxBodyPairs, maxContactConstraints,
@@ -56,6 +67,14 @@ void PhysicsManager::Startup()
 
 void PhysicsManager::Shutdown()
 {
+	WaitForStep();
+
+	m_querySnapshots[0].Clear();
+	m_querySnapshots[1].Clear();
+	m_hasQuerySnapshot = false;
+
+	m_shapeCache.Clear();
+
 	// TODO: Destroy and remove all bodies
 	// body_interface.RemoveBody( sphere_id );
 	// body_interface.DestroyBody( sphere_id );
@@ -68,86 +87,278 @@ void PhysicsManager::Shutdown()
 
 void PhysicsManager::Update()
 {
-	auto& bodyInterface = m_physicsInstance->m_physicsSystem.GetBodyInterface();
+	// Sync point: pick up the results of the step we started last tick, if there was one
+	EndAsyncStep();
 
-	// We will default to 4 but this should be 1 collision step per 1 / 60th of a second (round up).
-	const int collisionSteps = 4;
-	const int integrationSubSteps = 1;
+	if ( physicsAsync.GetValue() )
+	{
+		// Step the next tick on the job pool while game code runs for this one
+		BeginAsyncStep();
+		return;
+	}
+
+	// Traces go straight to the live world now, so don't leave a stale snapshot around for the next
+	// time async stepping gets turned on
+	m_hasQuerySnapshot = false;
+
+	PushDirtyBodies();
+	StepWorld( Globals::m_tickDeltaTime );
+	PullSimulatedBodies();
+}
+
+void PhysicsManager::PushDirtyBodies()
+{
+	// Nothing else can be touching Jolt right now, so skip taking a lock per call
+	auto& bodyInterface = m_physicsInstance->m_physicsSystem.GetBodyInterfaceNoLock();
+
+	// Before game code's changes, so that they win if both touched the same body
+	PushPinnedBodies( bodyInterface );
+
+	if ( m_dirtyEntities.empty() )
+		return;
 
-	// Retrieve properties that were saved off last frame
-	Globals::m_entityManager->ForEach( [&]( std::shared_ptr<BaseEntity> entity ) {
-		// Is this a valid entity to do physics stuff on?
-		auto modelEntity = std::dynamic_pointer_cast<ModelEntity>( entity );
+	m_bodiesToActivate.clear();
+
+	for ( Handle entityHandle : m_dirtyEntities )
+	{
+		// Bodies are only ever added for model entities, so we can skip the dynamic cast
+		auto* modelEntity = static_cast<ModelEntity*>( Globals::m_entityManager->GetBaseEntity( entityHandle ) );
 
+		// Removed since it was marked dirty
 		if ( modelEntity == nullptr )
-			return;
+			continue;
+
+		PhysicsDirtyFlags dirtyFlags = modelEntity->GetPhysicsDirtyFlags();
+		modelEntity->ClearPhysicsDirtyFlags();
 
 		auto physicsHandle = modelEntity->GetPhysicsHandle();
 
 		if ( physicsHandle == UINT32_MAX )
-			return;
+			continue;
 
 		auto body = Get( physicsHandle );
-		auto savedVelocity = modelEntity->GetVelocity();
-		auto savedTransform = modelEntity->m_transform;
+		JPH::BodyID bodyId = body->bodyId;
 
-		JPH::Vec3 velocity = JoltConversions::MochaToJoltVec3( savedVelocity );
-		bodyInterface.SetLinearVelocity( body->bodyId, velocity );
+		Transform tx = modelEntity->GetTransform();
+		JPH::Vec3 position = JoltConversions::MochaToJoltVec3( tx.position );
+		JPH::Quat rotation = JoltConversions::MochaToJoltQuat( tx.rotation );
 
-		bodyInterface.SetPosition(
-		    body->bodyId, JoltConversions::MochaToJoltVec3( savedTransform.position ), JPH::EActivation::DontActivate );
+		// One broadphase update rather than two if both changed
+		if ( ( dirtyFlags & PHYSICS_DIRTY_POSITION ) && ( dirtyFlags & PHYSICS_DIRTY_ROTATION ) )
+			bodyInterface.SetPositionAndRotation( bodyId, position, rotation, JPH::EActivation::DontActivate );
+		else if ( dirtyFlags & PHYSICS_DIRTY_POSITION )
+			bodyInterface.SetPosition( bodyId, position, JPH::EActivation::DontActivate );
+		else if ( dirtyFlags & PHYSICS_DIRTY_ROTATION )
+			bodyInterface.SetRotation( bodyId, rotation, JPH::EActivation::DontActivate );
 
-		bodyInterface.SetRotation(
-		    body->bodyId, JoltConversions::MochaToJoltQuat( savedTransform.rotation ), JPH::EActivation::DontActivate );
-	} );
+		if ( dirtyFlags & PHYSICS_DIRTY_VELOCITY )
+			bodyInterface.SetLinearVelocity( bodyId, JoltConversions::MochaToJoltVec3( modelEntity->GetVelocity() ) );
 
-	// Step the world
-	m_physicsInstance->m_physicsSystem.Update( Globals::m_tickDeltaTime, collisionSteps, integrationSubSteps,
-	    m_physicsInstance->m_tempAllocator, m_physicsInstance->m_jobSystem );
+		// Game code moved it, so it needs simulating again even if it had gone to sleep
+		if ( body->type == PhysicsType::PHYSICS_MODE_DYNAMIC )
+			m_bodiesToActivate.push_back( bodyId );
+	}
 
-	Globals::m_entityManager->ForEach( [&]( std::shared_ptr<BaseEntity> entity ) {
-		// Is this a valid entity to do physics stuff on?
-		auto modelEntity = std::dynamic_pointer_cast<ModelEntity>( entity );
+	m_dirtyEntities.clear();
 
+	if ( !m_bodiesToActivate.empty() )
+		bodyInterface.ActivateBodies( m_bodiesToActivate.data(), static_cast<int>( m_bodiesToActivate.size() ) );
+}
+
+void PhysicsManager::PushPinnedBodies( JPH::BodyInterface& bodyInterface )
+{
+	for ( const PinnedBody& pinned : m_pinnedBodies )
+	{
+		auto* modelEntity = static_cast<ModelEntity*>( Globals::m_entityManager->GetBaseEntity( pinned.entityHandle ) );
+
+		// Removed since it was pinned
 		if ( modelEntity == nullptr )
-			return;
+			continue;
 
 		auto physicsHandle = modelEntity->GetPhysicsHandle();
 
 		if ( physicsHandle == UINT32_MAX )
-			return;
+			continue;
 
-		auto body = Get( physicsHandle );
+		JPH::BodyID bodyId = Get( physicsHandle )->bodyId;
 
-		// Get properties & assign them to the model entity's transform.
-		JPH::Vec3 position = bodyInterface.GetCenterOfMassPosition( body->bodyId );
-		JPH::Quat rotation = bodyInterface.GetRotation( body->bodyId );
-		JPH::Vec3 velocity = bodyInterface.GetLinearVelocity( body->bodyId );
+		Transform tx = modelEntity->GetTransform();
+		JPH::Vec3 position = JoltConversions::MochaToJoltVec3( tx.position );
+		JPH::Quat rotation = JoltConversions::MochaToJoltQuat( tx.rotation );
 
-		Transform tx = modelEntity->m_transform;
+		// The entity didn't change, so leave the body's activation alone
+		if ( ( pinned.axes & PHYSICS_DIRTY_POSITION ) && ( pinned.axes & PHYSICS_DIRTY_ROTATION ) )
+			bodyInterface.SetPositionAndRotation( bodyId, position, rotation, JPH::EActivation::DontActivate );
+		else if ( pinned.axes & PHYSICS_DIRTY_POSITION )
+			bodyInterface.SetPosition( bodyId, position, JPH::EActivation::DontActivate );
+		else if ( pinned.axes & PHYSICS_DIRTY_ROTATION )
+			bodyInterface.SetRotation( bodyId, rotation, JPH::EActivation::DontActivate );
+	}
 
+	m_pinnedBodies.clear();
+}
+
+void PhysicsManager::PinIgnoredAxes( ModelEntity* modelEntity )
+{
+	PhysicsDirtyFlags axes = PHYSICS_DIRTY_NONE;
+
+	if ( modelEntity->GetIgnoreRigidbodyPosition() )
+		axes |= PHYSICS_DIRTY_POSITION;
+
+	if ( modelEntity->GetIgnoreRigidbodyRotation() )
+		axes |= PHYSICS_DIRTY_ROTATION;
+
+	if ( axes != PHYSICS_DIRTY_NONE )
+		m_pinnedBodies.push_back( { modelEntity->m_handle, axes } );
+}
+
+void PhysicsManager::StepWorld( float deltaTime )
+{
+	// We will default to 4 but this should be 1 collision step per 1 / 60th of a second (round up).
+	const int collisionSteps = 4;
+	const int integrationSubSteps = 1;
+
+	// Anything that's active going in or coming out can have moved; sleeping and static bodies can't.
+	// Bodies that fall asleep during the step are only in the first list, bodies that get woken up are
+	// only in the second.
+	m_physicsInstance->m_physicsSystem.GetActiveBodies( m_simulatedBodies );
+
+	// Step the world
+	m_physicsInstance->m_physicsSystem.Update( deltaTime, collisionSteps, integrationSubSteps,
+	    m_physicsInstance->m_tempAllocator, m_physicsInstance->m_jobSystem );
+
+	m_physicsInstance->m_physicsSystem.GetActiveBodies( m_activeBodiesScratch );
+	m_simulatedBodies.insert( m_simulatedBodies.end(), m_activeBodiesScratch.begin(), m_activeBodiesScratch.end() );
+
+	std::sort( m_simulatedBodies.begin(), m_simulatedBodies.end() );
+	m_simulatedBodies.erase( std::unique( m_simulatedBodies.begin(), m_simulatedBodies.end() ), m_simulatedBodies.end() );
+}
+
+void PhysicsManager::PullSimulatedBodies()
+{
+	auto& bodyInterface = m_physicsInstance->m_physicsSystem.GetBodyInterfaceNoLock();
+
+	for ( JPH::BodyID bodyId : m_simulatedBodies )
+	{
+		auto* modelEntity = static_cast<ModelEntity*>(
+		    Globals::m_entityManager->GetBaseEntity( FindEntityHandleForBodyId( bodyId ) ) );
+
+		if ( modelEntity == nullptr )
+			continue;
+
+		// Get properties & assign them to the model entity's transform.
+		Transform tx = modelEntity->GetTransform();
+
+		// Bodies that ignore the simulation get put back where the entity says they are before the
+		// next step
 		if ( !modelEntity->GetIgnoreRigidbodyPosition() )
-			tx.position = JoltConversions::JoltToMochaVec3( position );
-		else
-			bodyInterface.SetPosition(
-			    body->bodyId, JoltConversions::MochaToJoltVec3( tx.position ), JPH::EActivation::DontActivate );
+			tx.position = JoltConversions::JoltToMochaVec3( bodyInterface.GetCenterOfMassPosition( bodyId ) );
 
 		if ( !modelEntity->GetIgnoreRigidbodyRotation() )
-			tx.rotation = JoltConversions::JoltToMochaQuat( rotation );
-		else
-			bodyInterface.SetRotation(
-			    body->bodyId, JoltConversions::MochaToJoltQuat( tx.rotation ), JPH::EActivation::DontActivate );
+			tx.rotation = JoltConversions::JoltToMochaQuat( bodyInterface.GetRotation( bodyId ) );
 
-		modelEntity->m_transform = tx;
+		PinIgnoredAxes( modelEntity );
+
+		modelEntity->SetSimulatedTransform( tx );
 
 		// Save off velocity so that we can make changes to it if we need to
-		if ( body->type == PhysicsType::PHYSICS_MODE_DYNAMIC )
-			modelEntity->SetVelocity( JoltConversions::JoltToMochaVec3( velocity ) );
-	} );
+		modelEntity->SetSimulatedVelocity( JoltConversions::JoltToMochaVec3( bodyInterface.GetLinearVelocity( bodyId ) ) );
+	}
+}
+
+void PhysicsManager::BeginAsyncStep()
+{
+	PushDirtyBodies();
+
+	m_isStepRunning = true;
+	m_hasStepResults = true;
+
+	// Grab these now; the main thread will be writing to them again while the step runs
+	const float deltaTime = Globals::m_tickDeltaTime;
+	PhysicsSnapshot* backSnapshot = &m_querySnapshots[1 - m_frontSnapshot];
+
+	Globals::m_jobManager->Schedule(
+	    [this, deltaTime, backSnapshot]() {
+		    StepWorld( deltaTime );
+
+		    // What traces will see while the step after this one runs
+		    backSnapshot->Capture( m_physicsInstance->m_physicsSystem );
+
+		    // Read everything back while we're still off the main thread
+		    auto& bodyInterface = m_physicsInstance->m_physicsSystem.GetBodyInterfaceNoLock();
+
+		    m_steppedStates.resize( m_simulatedBodies.size() );
+
+		    for ( size_t i = 0; i < m_simulatedBodies.size(); ++i )
+		    {
+			    JPH::BodyID bodyId = m_simulatedBodies[i];
+			    BodyState& state = m_steppedStates[i];
+
+			    state.entityHandle = FindEntityHandleForBodyId( bodyId );
+			    state.bodyId = bodyId;
+			    state.position = JoltConversions::JoltToMochaVec3( bodyInterface.GetCenterOfMassPosition( bodyId ) );
+			    state.rotation = JoltConversions::JoltToMochaQuat( bodyInterface.GetRotation( bodyId ) );
+			    state.velocity = JoltConversions::JoltToMochaVec3( bodyInterface.GetLinearVelocity( bodyId ) );
+		    }
+	    },
+	    &m_stepCounter );
+}
+
+void PhysicsManager::EndAsyncStep()
+{
+	WaitForStep();
+
+	if ( !m_hasStepResults )
+		return;
+
+	m_hasStepResults = false;
+
+	// Traces see the world as it came out of this step until the next one is picked up
+	m_frontSnapshot = 1 - m_frontSnapshot;
+	m_hasQuerySnapshot = true;
+
+	for ( const BodyState& stepped : m_steppedStates )
+	{
+		auto* modelEntity = static_cast<ModelEntity*>( Globals::m_entityManager->GetBaseEntity( stepped.entityHandle ) );
+
+		// Removed while the step was running
+		if ( modelEntity == nullptr )
+			continue;
+
+		// If game code changed something while the step was running, its change wins over the
+		// simulation's; it's already queued up to be pushed into the next step
+		PhysicsDirtyFlags dirtyFlags = modelEntity->GetPhysicsDirtyFlags();
+
+		Transform tx = modelEntity->GetTransform();
+
+		if ( !modelEntity->GetIgnoreRigidbodyPosition() && !( dirtyFlags & PHYSICS_DIRTY_POSITION ) )
+			tx.position = stepped.position;
+
+		if ( !modelEntity->GetIgnoreRigidbodyRotation() && !( dirtyFlags & PHYSICS_DIRTY_ROTATION ) )
+			tx.rotation = stepped.rotation;
+
+		PinIgnoredAxes( modelEntity );
+
+		modelEntity->SetSimulatedTransform( tx );
+
+		if ( !( dirtyFlags & PHYSICS_DIRTY_VELOCITY ) )
+			modelEntity->SetSimulatedVelocity( stepped.velocity );
+	}
+}
+
+void PhysicsManager::WaitForStep()
+{
+	if ( !m_isStepRunning )
+		return;
+
+	Globals::m_jobManager->Wait( &m_stepCounter );
+	m_isStepRunning = false;
 }
 
 uint32_t PhysicsManager::AddBody( ModelEntity* entity, PhysicsBody body )
 {
+	WaitForStep();
+
 	// Add the body to the physics world
 	auto& bodyInterface = m_physicsInstance->m_physicsSystem.GetBodyInterface();
 
@@ -158,40 +369,35 @@ uint32_t PhysicsManager::AddBody( ModelEntity* entity, PhysicsBody body )
 	JPH::EMotionType motionType = isStatic ? JPH::EMotionType::Static : JPH::EMotionType::Dynamic;
 	JPH::uint8 layer = isStatic ? Layers::NON_MOVING : Layers::MOVING;
 
-	auto transform = entity->m_transform;
+	auto transform = entity->GetTransform();
 	auto position = JoltConversions::MochaToJoltVec3( transform.position );
 	auto rotation = JoltConversions::MochaToJoltQuat( transform.rotation );
 
-	JPH::ShapeSettings* shapeSettings = nullptr;
+	JPH::ShapeRefC shape;
 
 	// Shape-specific setup
 	switch ( body.shape.shapeType )
 	{
 	case PhysicsShapeType::PHYSICS_SHAPE_SPHERE: {
-		shapeSettings = new JPH::SphereShapeSettings( body.shape.shapeData.radius );
+		JPH::SphereShapeSettings shapeSettings( body.shape.shapeData.radius );
+		shape = shapeSettings.Create().Get();
 		break;
 	}
 
 	case PhysicsShapeType::PHYSICS_SHAPE_BOX: {
 		auto extents = JoltConversions::MochaToJoltVec3( body.shape.shapeData.extents );
-		shapeSettings = new JPH::BoxShapeSettings( extents );
+		JPH::BoxShapeSettings shapeSettings( extents );
+		shape = shapeSettings.Create().Get();
 		break;
 	}
 
 	case PhysicsShapeType::PHYSICS_SHAPE_MESH: {
-		JPH::TriangleList triangleList;
-
-		for ( size_t i = 0; i < body.shape.shapeData.vertices.size(); i += 3 )
-		{
-			auto index1 = JoltConversions::MochaToJoltFloat3( body.shape.shapeData.vertices[i] );
-			auto index2 = JoltConversions::MochaToJoltFloat3( body.shape.shapeData.vertices[i + 1] );
-			auto index3 = JoltConversions::MochaToJoltFloat3( body.shape.shapeData.vertices[i + 2] );
+		// Cooked once per unique mesh, and cached on disk between runs
+		shape = m_shapeCache.GetMeshShape( body.shape.shapeData.vertices );
 
-			JPH::Triangle triangle( index1, index2, index3, 0 );
-			triangleList.push_back( triangle );
-		}
-
-		shapeSettings = new JPH::MeshShapeSettings( triangleList );
+		// The body doesn't need its own copy of the triangles now that the shape has them
+		body.shape.shapeData.vertices.clear();
+		body.shape.shapeData.vertices.shrink_to_fit();
 		break;
 	}
 	default: {
@@ -202,10 +408,13 @@ uint32_t PhysicsManager::AddBody( ModelEntity* entity, PhysicsBody body )
 	}
 	}
 
-	// Make a shape, then set up a body
-	JPH::ShapeSettings::ShapeResult shapeResult = shapeSettings->Create();
-	JPH::ShapeRefC shape = shapeResult.Get();
+	if ( shape == nullptr )
+	{
+		spdlog::error( "Couldn't create physics shape" );
+		return UINT32_MAX;
+	}
 
+	// Set up a body
 	JPH::BodyCreationSettings bodyCreationSettings( shape, position, rotation, motionType, layer );
 
 	// Assign values from the entity
@@ -221,78 +430,77 @@ uint32_t PhysicsManager::AddBody( ModelEntity* entity, PhysicsBody body )
 	// Create the actual rigid body, add it to the world
 	body.bodyId = bodyInterface.CreateAndAddBody( bodyCreationSettings, activation );
 
+	if ( body.bodyId.IsInvalid() )
+	{
+		spdlog::error( "Ran out of physics bodies" );
+		return UINT32_MAX;
+	}
+
+	// Remember who owns this body so that traces can map hits straight back to an entity
+	m_bodyEntityHandles[body.bodyId.GetIndex()] = entity->m_handle;
+
 	return Add( body );
 }
 
+const PhysicsSnapshot* PhysicsManager::GetTraceSnapshot()
+{
+	// A step is in flight (or has finished but not been picked up yet), so Jolt is ahead of what game
+	// code sees
+	if ( m_hasStepResults && m_hasQuerySnapshot && !physicsTraceWait.GetValue() )
+		return &m_querySnapshots[m_frontSnapshot];
+
+	// Either nothing is running, or the caller asked for the live world (or there's nothing published
+	// yet, on the first async tick)
+	WaitForStep();
+	return nullptr;
+}
+
 TraceResult PhysicsManager::Trace( TraceInfo traceInfo )
+{
+	return RunTrace( traceInfo, GetTraceSnapshot() );
+}
+
+TraceResult PhysicsManager::RunTrace( const TraceInfo& traceInfo, const PhysicsSnapshot* snapshot )
 {
 	if ( traceInfo.isBox )
-		return TraceBox( traceInfo );
+		return TraceBox( traceInfo, snapshot );
 
-	return TraceRay( traceInfo );
+	return TraceRay( traceInfo, snapshot );
 }
 
-bool PhysicsManager::IsBodyIgnored( TraceInfo& traceInfo, JPH::BodyID bodyId )
+void PhysicsManager::TraceBatch( UtilArray traceInfos, UtilArray results )
 {
-	Handle entityHandle = FindEntityHandleForBodyId( bodyId );
-
-	//
-	// Check if physics handle is part of the ignored list
-	//
-	for ( size_t i = 0; i < traceInfo.ignoredEntityCount; i++ )
+	if ( traceInfos.count != results.count )
 	{
-		// Is this an ignored entity?
-		if ( traceInfo.ignoredEntityHandles[i] == entityHandle )
-			return true;
+		spdlog::error( "TraceBatch: got {} traces but space for {} results", traceInfos.count, results.count );
+		return;
 	}
 
-	// This body is NOT ignored, we can use it for this trace.
-	return false;
-}
-
-uint32_t PhysicsManager::FindEntityHandleForBodyId( JPH::BodyID bodyId )
-{
-	//
-	// We need to do the following steps:
-	// 1: JPH body -> physicsmanager handle
-	// 2: physicsmanager handle -> entity handle
-	//
-
-	//
-	// Step 1: find physmanager handle
-	//
-	uint32_t physicsHandle = UINT32_MAX;
-	For( [&]( Handle handle, std::shared_ptr<PhysicsBody> object ) {
-		if ( object->bodyId == bodyId )
-			physicsHandle = handle;
-	} );
+	if ( traceInfos.count <= 0 )
+		return;
 
-	// Did we find one?
-	if ( physicsHandle == UINT32_MAX )
-		return UINT32_MAX;
+	if ( traceInfos.size != traceInfos.count * static_cast<int>( sizeof( TraceInfo ) ) ||
+	     results.size != results.count * static_cast<int>( sizeof( TraceResult ) ) )
+	{
+		spdlog::error( "TraceBatch: TraceInfo / TraceResult layout doesn't match native code" );
+		return;
+	}
 
-	//
-	// Step 2: find entity handle
-	//
-	uint32_t entityHandle = UINT32_MAX;
-	Globals::m_entityManager->For( [&]( Handle handle, std::shared_ptr<BaseEntity> entity ) {
-		auto modelEntity = std::dynamic_pointer_cast<ModelEntity>( entity );
+	const PhysicsSnapshot* snapshot = GetTraceSnapshot();
 
-		if ( modelEntity == nullptr )
-			return;
+	const TraceInfo* infos = static_cast<const TraceInfo*>( traceInfos.data );
+	TraceResult* outResults = static_cast<TraceResult*>( results.data );
 
-		if ( modelEntity->GetPhysicsHandle() == physicsHandle )
-			entityHandle = handle;
+	// Queries are safe to run from any thread, as long as nothing is modifying what they run against
+	// at the same time. Nothing touches a published snapshot, and the live world is only queried when
+	// no step is running, while we're blocking the main thread here.
+	Globals::m_jobManager->ParallelFor( traceInfos.count, TRACE_BATCH_SIZE, [&]( size_t start, size_t end ) {
+		for ( size_t i = start; i < end; ++i )
+			outResults[i] = RunTrace( infos[i], snapshot );
 	} );
-
-	// Did we find one?
-	if ( entityHandle == UINT32_MAX )
-		return UINT32_MAX;
-
-	return entityHandle;
 }
 
-TraceResult PhysicsManager::TraceRay( TraceInfo traceInfo )
+TraceResult PhysicsManager::TraceRay( const TraceInfo& traceInfo, const PhysicsSnapshot* snapshot )
 {
 	const JPH::NarrowPhaseQuery& sceneQuery = m_physicsInstance->m_physicsSystem.GetNarrowPhaseQuery();
 
@@ -306,10 +514,19 @@ TraceResult PhysicsManager::TraceRay( TraceInfo traceInfo )
 
 	JPH::RayCastSettings rayCastSettings;
 
-	JPH::AllHitCollisionCollector<JPH::CastRayCollector> collector;
-	sceneQuery.CastRay( ray, rayCastSettings, collector );
+	// Filter inside the query, and only keep the closest hit
+	TraceBroadPhaseLayerFilter broadPhaseLayerFilter(
+	    traceInfo.layerMask, m_physicsInstance->m_broadPhaseLayerInterface, Layers::NUM_LAYERS );
+	TraceObjectLayerFilter objectLayerFilter( traceInfo.layerMask );
+	TraceBodyFilter bodyFilter( m_bodyEntityHandles.data(), m_bodyEntityHandles.size(), traceInfo.ignoredEntityHandles,
+	    traceInfo.ignoredEntityCount );
 
-	auto& bodyInterface = m_physicsInstance->m_physicsSystem.GetBodyInterface();
+	JPH::ClosestHitCollisionCollector<JPH::CastRayCollector> collector;
+
+	if ( snapshot != nullptr )
+		snapshot->CastRay( ray, rayCastSettings, collector, objectLayerFilter, bodyFilter );
+	else
+		sceneQuery.CastRay( ray, rayCastSettings, collector, broadPhaseLayerFilter, objectLayerFilter, bodyFilter );
 
 	// Did we hit anything at all? If not, bail now
 	if ( !collector.HadHit() )
@@ -317,59 +534,50 @@ TraceResult PhysicsManager::TraceRay( TraceInfo traceInfo )
 		return TraceResult::Empty( traceInfo.startPosition, traceInfo.endPosition );
 	}
 
-	// We might have hit something, let's do some filtering
-	collector.Sort();
-
-	std::vector<JPH::RayCastResult> raycastResults( collector.mHits.begin(), collector.mHits.end() );
+	const JPH::RayCastResult& result = collector.mHit;
 
-	// Find the first raycast result that matches our parameters
-	for ( size_t i = 0; i < raycastResults.size(); i++ )
-	{
-		const JPH::RayCastResult& result = raycastResults[i];
-
-		auto bodyID = result.mBodyID.GetIndexAndSequenceNumber();
-		JPH::BodyLockRead bodyLock( m_physicsInstance->m_physicsSystem.GetBodyLockInterface(), result.mBodyID );
-		const JPH::Body& hitBody = bodyLock.GetBody();
-
-		// Is this body ignored in the trace filter?
-		if ( IsBodyIgnored( traceInfo, result.mBodyID ) )
-			continue;
+	TraceResult traceResult = {};
+	traceResult.startPosition = traceInfo.startPosition;
+	traceResult.hit = true;
 
-		//
-		// We got this far - that means that the entity we've hit is valid and
-		// not part of the ignored list. Let's return some relevant values.
-		//
-		TraceResult traceResult = {};
-		traceResult.startPosition = traceInfo.startPosition;
-		traceResult.hit = true;
+	// Calculate end position
+	traceResult.endPosition = JoltConversions::JoltToMochaVec3( ray.mOrigin + result.mFraction * ray.mDirection );
 
-		// Calculate end position
-		traceResult.endPosition = JoltConversions::JoltToMochaVec3( ray.mOrigin + result.mFraction * ray.mDirection );
+	// Hit fraction
+	traceResult.fraction = result.mFraction;
 
-		// Hit fraction
-		traceResult.fraction = result.mFraction;
-
-		// Calculate hit normal
-		traceResult.normal = JoltConversions::JoltToMochaVec3( hitBody.GetWorldSpaceSurfaceNormal(
-		    result.mSubShapeID2, JoltConversions::MochaToJoltVec3( traceResult.endPosition ) ) );
+	// Calculate hit normal
+	if ( snapshot != nullptr )
+	{
+		traceResult.normal = JoltConversions::JoltToMochaVec3( snapshot->GetWorldSpaceSurfaceNormal(
+		    result.mBodyID, result.mSubShapeID2, JoltConversions::MochaToJoltVec3( traceResult.endPosition ) ) );
+	}
+	else
+	{
+		JPH::BodyLockRead bodyLock( m_physicsInstance->m_physicsSystem.GetBodyLockInterface(), result.mBodyID );
 
-		// Hit entity
-		traceResult.entityHandle = FindEntityHandleForBodyId( result.mBodyID );
+		if ( bodyLock.Succeeded() )
+		{
+			const JPH::Body& hitBody = bodyLock.GetBody();
+			traceResult.normal = JoltConversions::JoltToMochaVec3( hitBody.GetWorldSpaceSurfaceNormal(
+			    result.mSubShapeID2, JoltConversions::MochaToJoltVec3( traceResult.endPosition ) ) );
+		}
+	}
 
-		// Started solid
-		traceResult.startedSolid = traceResult.fraction == 0.0f;
+	// Hit entity
+	traceResult.entityHandle = FindEntityHandleForBodyId( result.mBodyID );
 
-		// Ended solid
-		// TODO: Replace with allSolid
-		traceResult.endedSolid = false;
+	// Started solid
+	traceResult.startedSolid = traceResult.fraction == 0.0f;
 
-		return traceResult;
-	}
+	// Ended solid
+	// TODO: Replace with allSolid
+	traceResult.endedSolid = false;
 
-	return TraceResult::Empty( traceInfo.startPosition, traceInfo.endPosition );
+	return traceResult;
 }
 
-TraceResult PhysicsManager::TraceBox( TraceInfo traceInfo )
+TraceResult PhysicsManager::TraceBox( const TraceInfo& traceInfo, const PhysicsSnapshot* snapshot )
 {
 	const JPH::NarrowPhaseQuery& sceneQuery = m_physicsInstance->m_physicsSystem.GetNarrowPhaseQuery();
 
@@ -382,10 +590,19 @@ TraceResult PhysicsManager::TraceBox( TraceInfo traceInfo )
 
 	JPH::ShapeCastSettings shapeCastSettings;
 
-	JPH::AllHitCollisionCollector<JPH::CastShapeCollector> collector;
-	sceneQuery.CastShape( shapeCast, shapeCastSettings, collector );
+	// Filter inside the query, and only keep the closest hit
+	TraceBroadPhaseLayerFilter broadPhaseLayerFilter(
+	    traceInfo.layerMask, m_physicsInstance->m_broadPhaseLayerInterface, Layers::NUM_LAYERS );
+	TraceObjectLayerFilter objectLayerFilter( traceInfo.layerMask );
+	TraceBodyFilter bodyFilter( m_bodyEntityHandles.data(), m_bodyEntityHandles.size(), traceInfo.ignoredEntityHandles,
+	    traceInfo.ignoredEntityCount );
 
-	auto& bodyInterface = m_physicsInstance->m_physicsSystem.GetBodyInterface();
+	JPH::ClosestHitCollisionCollector<JPH::CastShapeCollector> collector;
+
+	if ( snapshot != nullptr )
+		snapshot->CastShape( shapeCast, shapeCastSettings, collector, objectLayerFilter, bodyFilter );
+	else
+		sceneQuery.CastShape( shapeCast, shapeCastSettings, collector, broadPhaseLayerFilter, objectLayerFilter, bodyFilter );
 
 	// Did we hit anything at all? If not, bail now
 	if ( !collector.HadHit() )
@@ -393,54 +610,31 @@ TraceResult PhysicsManager::TraceBox( TraceInfo traceInfo )
 		return TraceResult::Empty( traceInfo.startPosition, traceInfo.endPosition );
 	}
 
-	// We might have hit something, let's do some filtering
-	collector.Sort();
-
-	std::vector<JPH::ShapeCastResult> shapeCastResults( collector.mHits.begin(), collector.mHits.end() );
-
-	// Find the first raycast result that matches our parameters
-	for ( size_t i = 0; i < shapeCastResults.size(); i++ )
-	{
-		const JPH::ShapeCastResult& result = shapeCastResults[i];
-
-		auto bodyID = result.mBodyID2.GetIndexAndSequenceNumber();
-		JPH::BodyLockRead bodyLock( m_physicsInstance->m_physicsSystem.GetBodyLockInterface(), result.mBodyID2 );
-		const JPH::Body& hitBody = bodyLock.GetBody();
+	const JPH::ShapeCastResult& result = collector.mHit;
 
-		// Is this body ignored in the trace filter?
-		if ( IsBodyIgnored( traceInfo, result.mBodyID2 ) )
-			continue;
-
-		//
-		// We got this far - that means that the entity we've hit is valid and
-		// not part of the ignored list. Let's return some relevant values.
-		//
-		TraceResult traceResult = {};
-		traceResult.startPosition = traceInfo.startPosition;
-		traceResult.hit = true;
+	TraceResult traceResult = {};
+	traceResult.startPosition = traceInfo.startPosition;
+	traceResult.hit = true;
 
-		// Calculate end position
-		traceResult.endPosition = JoltConversions::JoltToMochaVec3(
-		    shapeCast.mCenterOfMassStart.GetTranslation() + result.mFraction * shapeCast.mDirection );
+	// Calculate end position
+	traceResult.endPosition = JoltConversions::JoltToMochaVec3(
+	    shapeCast.mCenterOfMassStart.GetTranslation() + result.mFraction * shapeCast.mDirection );
 
-		// Hit fraction
-		traceResult.fraction = result.mFraction;
+	// Hit fraction
+	traceResult.fraction = result.mFraction;
 
-		// Calculate hit normal
-		traceResult.normal = JoltConversions::JoltToMochaVec3( -result.mPenetrationAxis.Normalized() );
+	// Calculate hit normal
+	traceResult.normal = JoltConversions::JoltToMochaVec3( -result.mPenetrationAxis.Normalized() );
 
-		// Hit entity
-		traceResult.entityHandle = FindEntityHandleForBodyId( result.mBodyID2 );
+	// Hit entity
+	traceResult.entityHandle = FindEntityHandleForBodyId( result.mBodyID2 );
 
-		// Started solid
-		traceResult.startedSolid = result.mPenetrationDepth > 0.025f && traceResult.fraction == 0.0f;
+	// Started solid
+	traceResult.startedSolid = result.mPenetrationDepth > 0.025f && traceResult.fraction == 0.0f;
 
-		// Ended solid
-		// TODO: Replace with allSolid
-		traceResult.endedSolid = false;
+	// Ended solid
+	// TODO: Replace with allSolid
+	traceResult.endedSolid = false;
 
-		return traceResult;
-	}
-
-	return TraceResult::Empty( traceInfo.startPosition, traceInfo.endPosition );
-}
\ No newline at end of file
+	return traceResult;
+}
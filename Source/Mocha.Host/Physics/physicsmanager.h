@@ -2,8 +2,10 @@
 #include <Entities/modelentity.h>
 #include <Jolt/Jolt.h>
 #include <Misc/handlemap.h>
+#include <Misc/jobmanager.h>
 #include <Misc/mathtypes.h>
 #include <Misc/subsystem.h>
+#include <Util/utilarray.h>
 #include <atomic>
 #include <memory>
 #include <spdlog/spdlog.h>
@@ -11,10 +13,11 @@
 
 // Jolt includes
 #include <Jolt/Core/Factory.h>
-#include <Jolt/Core/JobSystemThreadPool.h>
+#include <Jolt/Core/JobSystem.h>
 #include <Jolt/Core/TempAllocator.h>
 #include <Jolt/Physics/Body/BodyActivationListener.h>
 #include <Jolt/Physics/Body/BodyCreationSettings.h>
+#include <Jolt/Physics/Body/BodyFilter.h>
 #include <Jolt/Physics/Collision/BroadPhase/BroadPhaseLayer.h>
 #include <Jolt/Physics/Collision/CastResult.h>
 #include <Jolt/Physics/Collision/CollisionCollector.h>
@@ -29,6 +32,9 @@
 #include <Jolt/Physics/PhysicsSettings.h>
 #include <Jolt/Physics/PhysicsSystem.h>
 #include <Jolt/RegisterTypes.h>
+#include <Physics/physicssnapshot.h>
+#include <Physics/shapecache.h>
+#include <Physics/tracefilters.h>
 
 enum PhysicsType
 {
@@ -104,6 +110,9 @@ struct TraceInfo
 
 	int ignoredEntityCount;
 	uint32_t* ignoredEntityHandles;
+
+	// One bit per object layer (see Layers); only bodies in a set layer can be hit
+	uint32_t layerMask;
 };
 
 // Layer that objects can be in, determines which other objects it can collide with
@@ -248,11 +257,92 @@ private:
 
 	std::shared_ptr<PhysicsInstance> m_physicsInstance;
 
-	uint32_t FindEntityHandleForBodyId( JPH::BodyID bodyId );
+	static constexpr JPH::uint MAX_BODIES = 65536;
+
+	// How many traces each job in a TraceBatch handles
+	static constexpr size_t TRACE_BATCH_SIZE = 16;
+
+	// Entity handle for each body, indexed by JPH::BodyID::GetIndex(). Sized up-front to MAX_BODIES
+	// so that traces on other threads can read it without locking; only written in AddBody.
+	std::vector<Handle> m_bodyEntityHandles;
+
+	// Mesh shapes, shared between every body that uses the same mesh
+	ShapeCache m_shapeCache{ ".cache/shapes" };
+
+	// A body's state as it came out of a step
+	struct BodyState
+	{
+		Handle entityHandle;
+		JPH::BodyID bodyId;
+
+		Vector3 position;
+		Quaternion rotation;
+		Vector3 velocity;
+	};
 
-	TraceResult TraceRay( TraceInfo traceInfo );
-	TraceResult TraceBox( TraceInfo traceInfo );
-	bool IsBodyIgnored( TraceInfo& traceInfo, JPH::BodyID bodyId );
+	// A body that ignores the simulation on some axes, and got moved on them by the last step
+	struct PinnedBody
+	{
+		Handle entityHandle;
+		PhysicsDirtyFlags axes;
+	};
+
+	// Entities whose bodies game code has changed since the last sync (see ModelEntity::MarkPhysicsDirty)
+	std::vector<Handle> m_dirtyEntities;
+
+	// Bodies to put back where their entity says they are before the next step. Unlike dirty entities,
+	// these don't get woken up, so they can still go to sleep.
+	std::vector<PinnedBody> m_pinnedBodies;
+
+	// Bodies that were active at some point during the last step - the only ones that can have moved
+	JPH::BodyIDVector m_simulatedBodies;
+	JPH::BodyIDVector m_activeBodiesScratch;
+	std::vector<JPH::BodyID> m_bodiesToActivate;
+
+	//
+	// Asynchronous stepping (physics.async). While a step is running, game code works against the
+	// entities' own transforms / velocities, and Jolt belongs to the step job, which writes what
+	// came out of the step into m_steppedStates.
+	//
+	// Traces meanwhile run against m_querySnapshots[m_frontSnapshot], published along with the
+	// results of the previous step, while the step job captures the next one into the other slot.
+	//
+	JobCounter m_stepCounter;
+	bool m_isStepRunning = false;
+	bool m_hasStepResults = false;
+	std::vector<BodyState> m_steppedStates;
+
+	PhysicsSnapshot m_querySnapshots[2];
+	int m_frontSnapshot = 0;
+	bool m_hasQuerySnapshot = false;
+
+	// Copies whatever game code changed into Jolt, in one pass.
+	void PushDirtyBodies();
+	// Puts bodies back on the axes their entity ignores the simulation on.
+	void PushPinnedBodies( JPH::BodyInterface& bodyInterface );
+	// Queues a simulated body up to be pinned if its entity ignores the simulation on any axis.
+	void PinIgnoredAxes( ModelEntity* modelEntity );
+	// Steps the world and fills m_simulatedBodies.
+	void StepWorld( float deltaTime );
+	// Copies the state of every simulated body back into its entity.
+	void PullSimulatedBodies();
+
+	void BeginAsyncStep();
+	// Waits for the step started by BeginAsyncStep, then applies its results to every entity, other
+	// than anything game code changed in the meantime.
+	void EndAsyncStep();
+
+	// Blocks until any running step has finished. Jolt can't be queried or modified mid-step.
+	void WaitForStep();
+
+	// Works out what traces should run against right now: the published snapshot if there's a step
+	// running and it's allowed, otherwise the live world, waiting for any running step first.
+	// Returns nullptr for the live world.
+	const PhysicsSnapshot* GetTraceSnapshot();
+
+	TraceResult RunTrace( const TraceInfo& traceInfo, const PhysicsSnapshot* snapshot );
+	TraceResult TraceRay( const TraceInfo& traceInfo, const PhysicsSnapshot* snapshot );
+	TraceResult TraceBox( const TraceInfo& traceInfo, const PhysicsSnapshot* snapshot );
 
 public:
 	PhysicsManager();
@@ -263,5 +353,27 @@ public:
 	void Update();
 
 	uint32_t AddBody( ModelEntity* entity, PhysicsBody body );
+
+	// Queues an entity's body to be synced from the entity before the next step.
+	inline void OnBodyDirty( Handle entityHandle ) { m_dirtyEntities.push_back( entityHandle ); }
+
+	// Returns the handle of the entity that owns this body, or UINT32_MAX if there isn't one.
+	inline Handle FindEntityHandleForBodyId( JPH::BodyID bodyId ) const
+	{
+		JPH::uint32 index = bodyId.GetIndex();
+
+		if ( bodyId.IsInvalid() || index >= m_bodyEntityHandles.size() )
+			return UINT32_MAX;
+
+		return m_bodyEntityHandles[index];
+	}
+
+	// While an async step is running, traces see the world as it was published at the start of this
+	// tick rather than waiting for the step; set physics.trace_wait to make them wait instead.
 	GENERATE_BINDINGS TraceResult Trace( TraceInfo traceInfo );
+
+	// Runs every trace in traceInfos (an array of TraceInfo) across the job pool, writing each result
+	// into the matching slot in results (an array of TraceResult, the same length). Blocks until all
+	// of them are done.
+	GENERATE_BINDINGS void TraceBatch( UtilArray traceInfos, UtilArray results );
 };
@@ -0,0 +1,88 @@
+#include "physicssnapshot.h"
+
+#include <algorithm>
+
+void PhysicsSnapshot::Capture( const JPH::PhysicsSystem& physicsSystem )
+{
+	const JPH::BodyInterface& bodyInterface = physicsSystem.GetBodyInterfaceNoLock();
+
+	physicsSystem.GetBodies( m_bodyIdsScratch );
+	std::sort( m_bodyIdsScratch.begin(), m_bodyIdsScratch.end() );
+
+	m_bodies.resize( m_bodyIdsScratch.size() );
+
+	for ( size_t i = 0; i < m_bodyIdsScratch.size(); ++i )
+	{
+		JPH::BodyID bodyId = m_bodyIdsScratch[i];
+		SnapshotBody& body = m_bodies[i];
+
+		body.shape = bodyInterface.GetTransformedShape( bodyId );
+		body.bounds = body.shape.GetWorldSpaceBounds();
+		body.layer = bodyInterface.GetObjectLayer( bodyId );
+	}
+}
+
+void PhysicsSnapshot::Clear()
+{
+	m_bodies.clear();
+	m_bodies.shrink_to_fit();
+}
+
+void PhysicsSnapshot::CastRay( const JPH::RayCast& ray, const JPH::RayCastSettings& rayCastSettings,
+    JPH::CastRayCollector& collector, const JPH::ObjectLayerFilter& objectLayerFilter,
+    const JPH::BodyFilter& bodyFilter ) const
+{
+	JPH::Vec3 end = ray.mOrigin + ray.mDirection;
+	JPH::AABox rayBounds( JPH::Vec3::sMin( ray.mOrigin, end ), JPH::Vec3::sMax( ray.mOrigin, end ) );
+
+	for ( const SnapshotBody& body : m_bodies )
+	{
+		if ( !body.bounds.Overlaps( rayBounds ) )
+			continue;
+
+		if ( !objectLayerFilter.ShouldCollide( body.layer ) || !bodyFilter.ShouldCollide( body.shape.mBodyID ) )
+			continue;
+
+		body.shape.CastRay( ray, rayCastSettings, collector );
+
+		if ( collector.ShouldEarlyOut() )
+			break;
+	}
+}
+
+void PhysicsSnapshot::CastShape( const JPH::ShapeCast& shapeCast, const JPH::ShapeCastSettings& shapeCastSettings,
+    JPH::CastShapeCollector& collector, const JPH::ObjectLayerFilter& objectLayerFilter,
+    const JPH::BodyFilter& bodyFilter ) const
+{
+	// Everything the shape passes through on its way from start to end
+	JPH::AABox castBounds = shapeCast.mShape->GetWorldSpaceBounds( shapeCast.mCenterOfMassStart, shapeCast.mScale );
+	JPH::AABox endBounds = castBounds;
+	endBounds.Translate( shapeCast.mDirection );
+	castBounds.Encapsulate( endBounds );
+
+	for ( const SnapshotBody& body : m_bodies )
+	{
+		if ( !body.bounds.Overlaps( castBounds ) )
+			continue;
+
+		if ( !objectLayerFilter.ShouldCollide( body.layer ) || !bodyFilter.ShouldCollide( body.shape.mBodyID ) )
+			continue;
+
+		body.shape.CastShape( shapeCast, shapeCastSettings, collector );
+
+		if ( collector.ShouldEarlyOut() )
+			break;
+	}
+}
+
+JPH::Vec3 PhysicsSnapshot::GetWorldSpaceSurfaceNormal(
+    const JPH::BodyID& bodyId, const JPH::SubShapeID& subShapeId, JPH::Vec3 position ) const
+{
+	auto it = std::lower_bound( m_bodies.begin(), m_bodies.end(), bodyId,
+	    []( const SnapshotBody& body, const JPH::BodyID& id ) { return body.shape.mBodyID < id; } );
+
+	if ( it == m_bodies.end() || it->shape.mBodyID != bodyId )
+		return JPH::Vec3::sZero();
+
+	return it->shape.GetWorldSpaceSurfaceNormal( subShapeId, position );
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Geometry/AABox.h>
+#include <Jolt/Physics/Body/BodyFilter.h>
+#include <Jolt/Physics/Collision/CastResult.h>
+#include <Jolt/Physics/Collision/CollisionCollector.h>
+#include <Jolt/Physics/Collision/ObjectLayer.h>
+#include <Jolt/Physics/Collision/RayCast.h>
+#include <Jolt/Physics/Collision/ShapeCast.h>
+#include <Jolt/Physics/Collision/TransformedShape.h>
+#include <Jolt/Physics/PhysicsSystem.h>
+#include <vector>
+
+//
+// A copy of every body's shape, transform and layer as they were at the end of a step, so that
+// traces can run while the next step has Jolt to itself.
+//
+// Jolt shapes are immutable and ref counted, so this only holds references to them rather than
+// copying any geometry. There's no broadphase tree, just a bounds check per body, so queries cost
+// more than they do against the live world as the body count goes up.
+//
+class PhysicsSnapshot
+{
+private:
+	struct SnapshotBody
+	{
+		JPH::TransformedShape shape;
+		JPH::AABox bounds;
+		JPH::ObjectLayer layer;
+	};
+
+	// Sorted by body ID
+	std::vector<SnapshotBody> m_bodies;
+	JPH::BodyIDVector m_bodyIdsScratch;
+
+public:
+	// Copies the state of every body in the system. Nothing can be modifying it while this runs.
+	void Capture( const JPH::PhysicsSystem& physicsSystem );
+
+	// Drops every body, and with them the snapshot's references to their shapes.
+	void Clear();
+
+	// Same as JPH::NarrowPhaseQuery::CastRay, but against the captured bodies.
+	void CastRay( const JPH::RayCast& ray, const JPH::RayCastSettings& rayCastSettings, JPH::CastRayCollector& collector,
+	    const JPH::ObjectLayerFilter& objectLayerFilter, const JPH::BodyFilter& bodyFilter ) const;
+
+	// Same as JPH::NarrowPhaseQuery::CastShape, but against the captured bodies.
+	void CastShape( const JPH::ShapeCast& shapeCast, const JPH::ShapeCastSettings& shapeCastSettings,
+	    JPH::CastShapeCollector& collector, const JPH::ObjectLayerFilter& objectLayerFilter,
+	    const JPH::BodyFilter& bodyFilter ) const;
+
+	// Returns the world space surface normal of a captured body at a hit, or zero if the body
+	// isn't in the snapshot.
+	JPH::Vec3 GetWorldSpaceSurfaceNormal(
+	    const JPH::BodyID& bodyId, const JPH::SubShapeID& subShapeId, JPH::Vec3 position ) const;
+};
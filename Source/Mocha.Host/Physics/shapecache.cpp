@@ -0,0 +1,177 @@
+#include "shapecache.h"
+
+#include <Jolt/Core/StreamWrapper.h>
+#include <Jolt/Physics/Collision/Shape/MeshShape.h>
+#include <Physics/physicsmanager.h>
+#include <cstring>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+uint64_t ShapeCache::HashVertices( const std::vector<Vector3>& vertices )
+{
+	// FNV-1a over the raw vertex data
+	uint64_t hash = 14695981039346656037ull;
+
+	const uint8_t* data = reinterpret_cast<const uint8_t*>( vertices.data() );
+	const size_t size = vertices.size() * sizeof( Vector3 );
+
+	for ( size_t i = 0; i < size; ++i )
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+bool ShapeCache::AreVerticesEqual( const std::vector<Vector3>& a, const std::vector<Vector3>& b )
+{
+	// Byte-for-byte, same as the hash
+	return a.size() == b.size() && std::memcmp( a.data(), b.data(), a.size() * sizeof( Vector3 ) ) == 0;
+}
+
+std::filesystem::path ShapeCache::GetCachePath( uint64_t hash ) const
+{
+	return m_cacheDirectory / fmt::format( "{:016x}.shape", hash );
+}
+
+JPH::ShapeRefC ShapeCache::GetMeshShape( const std::vector<Vector3>& vertices )
+{
+	const uint64_t hash = HashVertices( vertices );
+
+	std::lock_guard lock( m_mutex );
+
+	// Already cooked this run?
+	std::vector<MeshShapeEntry>& entries = m_meshShapes[hash];
+
+	for ( const MeshShapeEntry& entry : entries )
+	{
+		if ( AreVerticesEqual( entry.vertices, vertices ) )
+			return entry.shape;
+	}
+
+	if ( !entries.empty() )
+		spdlog::warn( "Mesh shape hash collision on {:016x}, cooking a separate shape", hash );
+
+	// Cooked on a previous run?
+	JPH::ShapeRefC shape = LoadMeshShape( hash, vertices );
+
+	if ( shape == nullptr )
+	{
+		shape = CookMeshShape( vertices );
+
+		if ( shape == nullptr )
+			return nullptr;
+
+		SaveMeshShape( hash, vertices, shape );
+	}
+
+	entries.push_back( { vertices, shape } );
+	return shape;
+}
+
+void ShapeCache::Clear()
+{
+	std::lock_guard lock( m_mutex );
+	m_meshShapes.clear();
+}
+
+JPH::ShapeRefC ShapeCache::CookMeshShape( const std::vector<Vector3>& vertices )
+{
+	JPH::TriangleList triangleList;
+	triangleList.reserve( vertices.size() / 3 );
+
+	for ( size_t i = 0; i + 2 < vertices.size(); i += 3 )
+	{
+		auto index1 = JoltConversions::MochaToJoltFloat3( vertices[i] );
+		auto index2 = JoltConversions::MochaToJoltFloat3( vertices[i + 1] );
+		auto index3 = JoltConversions::MochaToJoltFloat3( vertices[i + 2] );
+
+		triangleList.push_back( JPH::Triangle( index1, index2, index3, 0 ) );
+	}
+
+	JPH::MeshShapeSettings shapeSettings( triangleList );
+	JPH::ShapeSettings::ShapeResult shapeResult = shapeSettings.Create();
+
+	if ( shapeResult.HasError() )
+	{
+		spdlog::error( "Couldn't cook mesh shape: {}", shapeResult.GetError().c_str() );
+		return nullptr;
+	}
+
+	return shapeResult.Get();
+}
+
+JPH::ShapeRefC ShapeCache::LoadMeshShape( uint64_t hash, const std::vector<Vector3>& vertices )
+{
+	std::ifstream file( GetCachePath( hash ), std::ios::binary );
+
+	if ( !file.good() )
+		return nullptr;
+
+	CacheFileHeader header = {};
+	file.read( reinterpret_cast<char*>( &header ), sizeof( header ) );
+
+	// Stale or from a different mesh that happens to share a hash; cook it again and overwrite
+	if ( !file.good() || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.hash != hash ||
+	     header.vertexCount != vertices.size() )
+	{
+		return nullptr;
+	}
+
+	std::vector<Vector3> fileVertices( vertices.size() );
+	file.read( reinterpret_cast<char*>( fileVertices.data() ), fileVertices.size() * sizeof( Vector3 ) );
+
+	if ( !file.good() || !AreVerticesEqual( fileVertices, vertices ) )
+		return nullptr;
+
+	JPH::StreamInWrapper streamIn( file );
+	JPH::Shape::ShapeResult shapeResult = JPH::Shape::sRestoreFromBinaryState( streamIn );
+
+	if ( shapeResult.HasError() || streamIn.IsFailed() )
+	{
+		spdlog::warn( "Ignoring broken shape cache file {}", GetCachePath( hash ).string() );
+		return nullptr;
+	}
+
+	return shapeResult.Get();
+}
+
+void ShapeCache::SaveMeshShape( uint64_t hash, const std::vector<Vector3>& vertices, const JPH::Shape* shape )
+{
+	std::error_code error;
+	std::filesystem::create_directories( m_cacheDirectory, error );
+
+	if ( error )
+	{
+		spdlog::warn( "Couldn't create shape cache directory {}: {}", m_cacheDirectory.string(), error.message() );
+		return;
+	}
+
+	// Write to a temporary file first so that a crash part-way through can't leave a broken file behind
+	std::filesystem::path path = GetCachePath( hash );
+	std::filesystem::path tempPath = path;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream file( tempPath, std::ios::binary | std::ios::trunc );
+
+		if ( !file.good() )
+			return;
+
+		CacheFileHeader header = { CACHE_MAGIC, CACHE_VERSION, hash, static_cast<uint64_t>( vertices.size() ) };
+		file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+		file.write( reinterpret_cast<const char*>( vertices.data() ), vertices.size() * sizeof( Vector3 ) );
+
+		JPH::StreamOutWrapper streamOut( file );
+		shape->SaveBinaryState( streamOut );
+
+		if ( !file.good() || streamOut.IsFailed() )
+		{
+			spdlog::warn( "Couldn't write shape cache file {}", tempPath.string() );
+			return;
+		}
+	}
+
+	std::filesystem::rename( tempPath, path, error );
+}
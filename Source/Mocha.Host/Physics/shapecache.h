@@ -0,0 +1,72 @@
+#pragma once
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Physics/Collision/Shape/Shape.h>
+#include <Misc/mathtypes.h>
+#include <filesystem>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+//
+// Cooks mesh collision shapes once per unique triangle soup.
+//
+// Shapes are keyed by a hash of their vertices, so every entity using the same collision mesh
+// shares one shape. Cooked shapes are also written to disk using Jolt's binary shape state, so that
+// on the next run they're loaded straight back in rather than being rebuilt. Both keep the vertices
+// alongside the shape, and only count a hash match as a hit if those match too.
+//
+class ShapeCache
+{
+private:
+	// Bump this whenever the file layout changes, or Jolt is updated (its binary state isn't
+	// versioned)
+	static constexpr uint32_t CACHE_VERSION = 2;
+	static constexpr uint32_t CACHE_MAGIC = 0x5048534d; // "MSHP"
+
+	struct CacheFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t hash;
+		uint64_t vertexCount;
+
+		// Followed by the vertices themselves, then the shape
+	};
+
+	struct MeshShapeEntry
+	{
+		std::vector<Vector3> vertices;
+		JPH::ShapeRefC shape;
+	};
+
+	std::filesystem::path m_cacheDirectory;
+
+	std::mutex m_mutex;
+
+	// Every mesh we've seen with a given hash; almost always just the one
+	std::unordered_map<uint64_t, std::vector<MeshShapeEntry>> m_meshShapes;
+
+	static uint64_t HashVertices( const std::vector<Vector3>& vertices );
+	static bool AreVerticesEqual( const std::vector<Vector3>& a, const std::vector<Vector3>& b );
+	std::filesystem::path GetCachePath( uint64_t hash ) const;
+
+	JPH::ShapeRefC CookMeshShape( const std::vector<Vector3>& vertices );
+	JPH::ShapeRefC LoadMeshShape( uint64_t hash, const std::vector<Vector3>& vertices );
+	void SaveMeshShape( uint64_t hash, const std::vector<Vector3>& vertices, const JPH::Shape* shape );
+
+public:
+	ShapeCache( std::filesystem::path cacheDirectory )
+	    : m_cacheDirectory( cacheDirectory )
+	{
+	}
+
+	// Returns a mesh shape for this triangle soup (three vertices per triangle), cooking it if this
+	// is the first time we've seen it. Returns nullptr if the mesh couldn't be cooked.
+	JPH::ShapeRefC GetMeshShape( const std::vector<Vector3>& vertices );
+
+	// Drops every shape held in memory. Bodies keep their own references, so this is safe to call
+	// at any time.
+	void Clear();
+};
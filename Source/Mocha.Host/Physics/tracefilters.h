@@ -0,0 +1,101 @@
+#pragma once
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Physics/Body/BodyFilter.h>
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhaseLayer.h>
+#include <Jolt/Physics/Collision/ObjectLayer.h>
+#include <stdint.h>
+
+//
+// Filters used by traces, so that Jolt can reject bodies while it walks the broadphase and
+// narrowphase rather than us having to filter a list of every hit afterwards.
+// None of these allocate.
+//
+
+// Rejects bodies whose owning entity is in a trace's ignore list.
+class TraceBodyFilter : public JPH::BodyFilter
+{
+private:
+	// Entity handle for each body, indexed by JPH::BodyID::GetIndex()
+	const uint32_t* m_bodyEntityHandles;
+	size_t m_bodyCount;
+
+	const uint32_t* m_ignoredEntityHandles;
+	int m_ignoredEntityCount;
+
+public:
+	TraceBodyFilter( const uint32_t* bodyEntityHandles, size_t bodyCount, const uint32_t* ignoredEntityHandles,
+	    int ignoredEntityCount )
+	    : m_bodyEntityHandles( bodyEntityHandles )
+	    , m_bodyCount( bodyCount )
+	    , m_ignoredEntityHandles( ignoredEntityHandles )
+	    , m_ignoredEntityCount( ignoredEntityCount )
+	{
+	}
+
+	bool ShouldCollide( const JPH::BodyID& bodyId ) const override
+	{
+		if ( m_ignoredEntityCount <= 0 )
+			return true;
+
+		JPH::uint32 index = bodyId.GetIndex();
+
+		if ( index >= m_bodyCount )
+			return true;
+
+		uint32_t entityHandle = m_bodyEntityHandles[index];
+
+		for ( int i = 0; i < m_ignoredEntityCount; ++i )
+		{
+			if ( m_ignoredEntityHandles[i] == entityHandle )
+				return false;
+		}
+
+		return true;
+	}
+};
+
+// Accepts object layers whose bit is set in a mask.
+class TraceObjectLayerFilter : public JPH::ObjectLayerFilter
+{
+private:
+	uint32_t m_layerMask;
+
+public:
+	TraceObjectLayerFilter( uint32_t layerMask )
+	    : m_layerMask( layerMask )
+	{
+	}
+
+	bool ShouldCollide( JPH::ObjectLayer layer ) const override
+	{
+		return layer < 32 && ( m_layerMask & ( 1u << layer ) ) != 0;
+	}
+};
+
+// Accepts broadphase layers that any object layer in a mask maps to, so that whole broadphase trees
+// can be skipped.
+class TraceBroadPhaseLayerFilter : public JPH::BroadPhaseLayerFilter
+{
+private:
+	uint32_t m_broadPhaseLayerMask = 0;
+
+public:
+	TraceBroadPhaseLayerFilter(
+	    uint32_t objectLayerMask, const JPH::BroadPhaseLayerInterface& broadPhaseLayerInterface, JPH::ObjectLayer objectLayerCount )
+	{
+		for ( JPH::ObjectLayer layer = 0; layer < objectLayerCount && layer < 32; ++layer )
+		{
+			if ( ( objectLayerMask & ( 1u << layer ) ) == 0 )
+				continue;
+
+			JPH::BroadPhaseLayer broadPhaseLayer = broadPhaseLayerInterface.GetBroadPhaseLayer( layer );
+			m_broadPhaseLayerMask |= 1u << static_cast<JPH::BroadPhaseLayer::Type>( broadPhaseLayer );
+		}
+	}
+
+	bool ShouldCollide( JPH::BroadPhaseLayer layer ) const override
+	{
+		return ( m_broadPhaseLayerMask & ( 1u << static_cast<JPH::BroadPhaseLayer::Type>( layer ) ) ) != 0;
+	}
+};
@@ -6,6 +6,35 @@
 #include <Rendering/rendering.h>
 #include <Rendering/rendermanager.h>
 #include <Root/root.h>
+#include <mutex>
+#include <unordered_map>
+
+//
+// Bindless materials with the same shaders share one pipeline, so that RenderManager can draw them in
+// the same batch. Keyed on everything the pipeline is built from.
+//
+static std::mutex s_sharedPipelinesMutex;
+static std::unordered_map<std::string, Pipeline> s_sharedPipelines;
+
+static std::string MakeSharedPipelineKey( const PipelineInfo_t& pipelineInfo )
+{
+	const ShaderInfo_t& shaderInfo = pipelineInfo.shaderInfo;
+
+	std::string key;
+	key.append( std::to_string( shaderInfo.vertexShaderData.size() ) ).append( ":" );
+	key.append( reinterpret_cast<const char*>( shaderInfo.vertexShaderData.data() ),
+	    shaderInfo.vertexShaderData.size() * sizeof( uint32_t ) );
+	key.append( std::to_string( shaderInfo.fragmentShaderData.size() ) ).append( ":" );
+	key.append( reinterpret_cast<const char*>( shaderInfo.fragmentShaderData.data() ),
+	    shaderInfo.fragmentShaderData.size() * sizeof( uint32_t ) );
+
+	for ( const VertexAttributeInfo_t& attribute : pipelineInfo.vertexAttributes )
+		key.append( attribute.name ).append( ":" ).append( std::to_string( attribute.format ) ).append( ";" );
+
+	key.append( pipelineInfo.ignoreDepth ? "1" : "0" ).append( pipelineInfo.renderToSwapchain ? "1" : "0" );
+
+	return key;
+}
 
 Material::Material( const char* name, UtilArray vertexShaderData, UtilArray fragmentShaderData,
     UtilArray vertexAttributes, UtilArray textures, SamplerType samplerType, bool ignoreDepth )
@@ -45,35 +74,94 @@ void Material::SetShaderData( UtilArray vertexShaderData, UtilArray fragmentShad
 	m_fragmentShaderData = fragmentShaderData.GetData<uint32_t>();
 }
 
+void Material::SetBindlessShaderData( UtilArray vertexShaderData, UtilArray fragmentShaderData )
+{
+	m_bindlessVertexShaderData = vertexShaderData.GetData<uint32_t>();
+	m_bindlessFragmentShaderData = fragmentShaderData.GetData<uint32_t>();
+}
+
 void Material::CreateResources()
 {
+	// Shaders without a bindless variant still sample from a descriptor at set 0, which works alongside
+	// the bindless texture array
+	m_isBindless = Globals::m_renderContext->IsBindless() && !m_bindlessVertexShaderData.empty() &&
+	               !m_bindlessFragmentShaderData.empty();
+
 	PipelineInfo_t pipelineInfo = {};
 
 	pipelineInfo.name = m_name + " pipeline";
 	pipelineInfo.shaderInfo = {};
-	pipelineInfo.shaderInfo.vertexShaderData = m_vertexShaderData;
-	pipelineInfo.shaderInfo.fragmentShaderData = m_fragmentShaderData;
+	pipelineInfo.shaderInfo.vertexShaderData = m_isBindless ? m_bindlessVertexShaderData : m_vertexShaderData;
+	pipelineInfo.shaderInfo.fragmentShaderData = m_isBindless ? m_bindlessFragmentShaderData : m_fragmentShaderData;
 	pipelineInfo.vertexAttributes = m_vertexAttribInfo;
 
-	DescriptorInfo_t descriptorInfo;
-	descriptorInfo.name = m_name + " descriptor";
-	descriptorInfo.bindings = {};
-
-	for ( int i = 0; i < m_textures.size(); ++i )
+	// Bindless shaders find their textures through m_textureIndices instead
+	if ( !m_isBindless )
 	{
-		Texture texture = m_textures[i];
+		DescriptorInfo_t descriptorInfo;
+		descriptorInfo.name = m_name + " descriptor";
+		descriptorInfo.bindings = {};
 
-		DescriptorBindingInfo_t bindingInfo = {};
-		bindingInfo.type = DESCRIPTOR_BINDING_TYPE_IMAGE;
-		bindingInfo.texture = &texture.m_image;
+		for ( int i = 0; i < m_textures.size(); ++i )
+		{
+			DescriptorBindingInfo_t bindingInfo = {};
+			bindingInfo.type = DESCRIPTOR_BINDING_TYPE_IMAGE;
+			bindingInfo.texture = &m_textures[i].m_image;
 
-		descriptorInfo.bindings.push_back( bindingInfo );
+			descriptorInfo.bindings.push_back( bindingInfo );
+		}
+
+		m_descriptor = Descriptor( descriptorInfo );
+		pipelineInfo.descriptors.push_back( &m_descriptor );
 	}
 
-	m_descriptor = Descriptor( descriptorInfo );
-	pipelineInfo.descriptors.push_back( &m_descriptor );
+	UpdateTextureBindings();
+
+	if ( m_isBindless )
+	{
+		std::string key = MakeSharedPipelineKey( pipelineInfo );
+		std::unique_lock lock( s_sharedPipelinesMutex );
 
-	m_pipeline = Pipeline( pipelineInfo );
+		auto it = s_sharedPipelines.find( key );
+		if ( it == s_sharedPipelines.end() )
+			it = s_sharedPipelines.emplace( std::move( key ), Pipeline( pipelineInfo ) ).first;
+
+		m_pipeline = it->second;
+	}
+	else
+	{
+		m_pipeline = Pipeline( pipelineInfo );
+	}
 
 	m_isDirty.store( false );
 }
+
+void Material::UpdateTextureBindings()
+{
+	BaseRenderContext* renderContext = Globals::m_renderContext;
+
+	if ( m_isBindless )
+	{
+		assert( m_textures.size() <= MAX_INSTANCE_TEXTURES && "Too many textures for a bindless material" );
+
+		for ( int i = 0; i < m_textures.size() && i < MAX_INSTANCE_TEXTURES; ++i )
+		{
+			uint32_t index = 0;
+			renderContext->GetBindlessTextureIndex( &m_textures[i].m_image, &index );
+
+			m_textureIndices[i / 4][i % 4] = index;
+		}
+
+		return;
+	}
+
+	for ( int i = 0; i < m_textures.size(); ++i )
+	{
+		DescriptorUpdateInfo_t updateInfo = {};
+		updateInfo.binding = i;
+		updateInfo.samplerType = SAMPLER_TYPE_ANISOTROPIC;
+		updateInfo.src = &m_textures[i].m_image;
+
+		renderContext->UpdateDescriptor( m_descriptor, updateInfo );
+	}
+}
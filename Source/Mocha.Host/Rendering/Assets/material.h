@@ -2,6 +2,7 @@
 #include <Misc/defs.h>
 #include <Rendering/Assets/texture.h>
 #include <Rendering/rendering.h>
+#include <algorithm>
 #include <vector>
 
 class Root;
@@ -27,8 +28,15 @@ private:
 	std::atomic<bool> m_isDirty;
 	std::vector<uint32_t> m_vertexShaderData;
 	std::vector<uint32_t> m_fragmentShaderData;
+
+	// The shader compiled with BINDLESS defined, if it has a bindless variant
+	std::vector<uint32_t> m_bindlessVertexShaderData;
+	std::vector<uint32_t> m_bindlessFragmentShaderData;
 	std::string m_name;
 
+	// Set by CreateResources: is this material drawing with m_textureIndices instead of a descriptor?
+	bool m_isBindless = false;
+
 public:
 	std::vector<Texture> m_textures;
 	std::string m_shaderPath;
@@ -37,19 +45,33 @@ public:
 	GENERATE_BINDINGS void Reload();
 	GENERATE_BINDINGS void SetShaderData( UtilArray vertexShaderData, UtilArray fragmentShaderData );
 
+	// Empty arrays mean the shader has no bindless variant, and the material keeps its descriptor even
+	// in bindless mode
+	GENERATE_BINDINGS void SetBindlessShaderData( UtilArray vertexShaderData, UtilArray fragmentShaderData );
+
 	SamplerType m_samplerType = {};
 	Descriptor m_descriptor = {};
 	Pipeline m_pipeline = {};
+
+	// Bindless materials only: where each of m_textures lives in the bindless texture array. These go
+	// into every instance drawn with this material. Bindless materials have no descriptor.
+	glm::uvec4 m_textureIndices[MAX_INSTANCE_TEXTURES / 4] = {};
 	std::vector<VertexAttributeInfo_t> m_vertexAttribInfo;
 
 	bool m_ignoreDepth;
 	bool IsDirty() { return m_isDirty.load( std::memory_order_relaxed ); }
+	bool IsBindless() const { return m_isBindless; }
+
+	// Points the descriptor (or m_textureIndices, for bindless materials) at the current textures. Cheap to
+	// call every frame: the render context only writes anything for textures that have changed.
+	void UpdateTextureBindings();
 
 	GENERATE_BINDINGS Material( const char* name, UtilArray vertexShaderData, UtilArray fragmentShaderData,
 	    UtilArray vertexAttributes, UtilArray textures, SamplerType samplerType, bool ignoreDepth );
 
 	Material( const Material& other ) noexcept
 	    : m_isDirty( other.m_isDirty.load() )
+	    , m_isBindless( other.m_isBindless )
 	    , m_textures( other.m_textures )
 	    , m_shaderPath( other.m_shaderPath )
 	    , m_samplerType( other.m_samplerType )
@@ -58,6 +80,7 @@ public:
 	    , m_vertexAttribInfo( other.m_vertexAttribInfo )
 	    , m_ignoreDepth( other.m_ignoreDepth )
 	{
+		std::copy( std::begin( other.m_textureIndices ), std::end( other.m_textureIndices ), m_textureIndices );
 	}
 
 	Material& operator=( const Material& other ) noexcept
@@ -65,11 +88,13 @@ public:
 		if ( this == &other )
 			return *this;
 		m_isDirty.store( other.m_isDirty.load() );
+		m_isBindless = other.m_isBindless;
 		m_textures = other.m_textures;
 		m_shaderPath = other.m_shaderPath;
 		m_samplerType = other.m_samplerType;
 		m_descriptor = other.m_descriptor;
 		m_pipeline = other.m_pipeline;
+		std::copy( std::begin( other.m_textureIndices ), std::end( other.m_textureIndices ), m_textureIndices );
 		m_vertexAttribInfo = other.m_vertexAttribInfo;
 		m_ignoreDepth = other.m_ignoreDepth;
 		return *this;
@@ -1,19 +1,35 @@
 #pragma once
 
 #include <Rendering/Assets/material.h>
+#include <Rendering/geometrypool.h>
 #include <Rendering/rendering.h>
 #include <Util/util.h>
+#include <memory>
+
+// Object-space bounds, calculated from a mesh's vertex positions when it's added to a model
+struct MeshBounds
+{
+	glm::vec3 mins = {};
+	glm::vec3 maxs = {};
+
+	// Sphere around the centre of the box, just big enough to hold every vertex
+	glm::vec3 center = {};
+	float radius = 0.0f;
+};
 
 struct Mesh
 {
 	UtilArray vertices{};
 	UtilArray indices{};
 
-	VertexBuffer vertexBuffer{};
-	IndexBuffer indexBuffer{};
+	// Where the vertices and indices live on the GPU. Shared between copies of the mesh, and given back
+	// to the geometry pool when the last one goes
+	std::shared_ptr<GeometryAllocation> geometry{};
 
 	Material* material;
 
+	MeshBounds bounds{};
+
 	std::string name{};
 
 	Mesh( Material* _material )
@@ -5,55 +5,72 @@
 #include <Rendering/rendermanager.h>
 #include <Root/root.h>
 #include <Util/util.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 void Model::UploadMesh( Mesh& mesh )
 {
-	//
-	// Vertex buffer
-	//
+	mesh.geometry = Globals::m_renderManager->GetGeometryPool().Upload( mesh.vertices, mesh.indices );
+
+	m_meshes.push_back( mesh );
+	m_isInitialized = true;
+}
+
+MeshBounds Model::CalculateBounds( UtilArray vertices )
+{
+	MeshBounds bounds = {};
+
+	const size_t count = static_cast<size_t>( vertices.count );
+	const size_t stride = static_cast<size_t>( vertices.size ) / count;
+
+	if ( stride < sizeof( glm::vec3 ) )
+	{
+		spdlog::warn( "Vertices are too small to hold a position; mesh won't have any bounds" );
+		return bounds;
+	}
+
+	const uint8_t* data = static_cast<const uint8_t*>( vertices.data );
+
+	auto getPosition = [&]( size_t i ) {
+		glm::vec3 position;
+		memcpy( &position, data + i * stride, sizeof( glm::vec3 ) );
+		return position;
+	};
+
+	bounds.mins = getPosition( 0 );
+	bounds.maxs = bounds.mins;
+
+	for ( size_t i = 1; i < count; ++i )
 	{
-		BufferInfo_t vertexBufferInfo = {};
-		vertexBufferInfo.name = mesh.name + " vertex buffer";
-		vertexBufferInfo.size = mesh.vertices.size;
-		vertexBufferInfo.type = BUFFER_TYPE_VERTEX_INDEX_DATA;
-		vertexBufferInfo.usage = BUFFER_USAGE_FLAG_VERTEX_BUFFER | BUFFER_USAGE_FLAG_TRANSFER_DST;
-		VertexBuffer vertexBuffer( vertexBufferInfo );
-
-		BufferUploadInfo_t vertexUploadInfo = {};
-		vertexUploadInfo.data = mesh.vertices;
-		vertexBuffer.Upload( vertexUploadInfo );
-
-		mesh.vertexBuffer = vertexBuffer;
+		glm::vec3 position = getPosition( i );
+		bounds.mins = glm::min( bounds.mins, position );
+		bounds.maxs = glm::max( bounds.maxs, position );
 	}
 
-	//
-	// Index buffer (optional)
-	//
-	if ( mesh.indices.size > 0 )
+	bounds.center = ( bounds.mins + bounds.maxs ) * 0.5f;
+
+	// Tighter than the box's half-diagonal for most meshes
+	float radiusSquared = 0.0f;
+
+	for ( size_t i = 0; i < count; ++i )
 	{
-		BufferInfo_t indexBufferInfo = {};
-		indexBufferInfo.name = mesh.name + " index buffer";
-		indexBufferInfo.size = mesh.indices.size;
-		indexBufferInfo.type = BUFFER_TYPE_VERTEX_INDEX_DATA;
-		indexBufferInfo.usage = BUFFER_USAGE_FLAG_INDEX_BUFFER | BUFFER_USAGE_FLAG_TRANSFER_DST;
-		IndexBuffer indexBuffer( indexBufferInfo );
-
-		BufferUploadInfo_t indexUploadInfo = {};
-		indexUploadInfo.data = mesh.indices;
-		indexBuffer.Upload( indexUploadInfo );
-
-		mesh.indexBuffer = indexBuffer;
+		glm::vec3 offset = getPosition( i ) - bounds.center;
+		radiusSquared = std::max( radiusSquared, glm::dot( offset, offset ) );
 	}
 
-	m_meshes.push_back( mesh );
-	m_isInitialized = true;
+	bounds.radius = std::sqrt( radiusSquared );
+
+	return bounds;
 }
 
 void Model::AddMesh( const char* name, UtilArray vertices, UtilArray indices, Material* material )
 {
-	if ( vertices.size == 0 )
+	if ( vertices.size <= 0 || vertices.count <= 0 )
 		return;
 
 	Mesh mesh( std::string( name ), vertices, indices, material );
+	mesh.bounds = CalculateBounds( vertices );
+
 	UploadMesh( mesh );
 }
\ No newline at end of file
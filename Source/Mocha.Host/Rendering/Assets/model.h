@@ -18,6 +18,9 @@ class Model
 private:
 	void UploadMesh( Mesh& mesh );
 
+	// Vertices can be any layout, as long as each one starts with its position (as three floats)
+	static MeshBounds CalculateBounds( UtilArray vertices );
+
 public:
 	std::vector<Mesh> m_meshes;
 	bool m_hasIndexBuffer;
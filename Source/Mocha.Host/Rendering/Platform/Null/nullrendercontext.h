@@ -62,7 +62,43 @@ public:
 	RenderStatus BindConstants( RenderPushConstants p ) override { return RENDER_STATUS_OK; }
 
 	/// <inheritdoc />
-	RenderStatus Draw( uint32_t vertexCount, uint32_t indexCount, uint32_t instanceCount ) override { return RENDER_STATUS_OK; }
+	RenderStatus SetFrameConstants( const RenderFrameConstants& constants ) override { return RENDER_STATUS_OK; }
+
+	/// <inheritdoc />
+	RenderStatus SetLightData( const std::vector<RenderLight>& lights, const std::vector<RenderLightCluster>& clusters,
+	    const std::vector<uint32_t>& lightIndices ) override
+	{
+		return RENDER_STATUS_OK;
+	}
+
+	/// <inheritdoc />
+	RenderStatus SetInstanceData( const std::vector<RenderInstanceData>& instances ) override { return RENDER_STATUS_OK; }
+
+	/// <inheritdoc />
+	RenderStatus Draw( uint32_t vertexCount, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset,
+	    uint32_t instanceCount, uint32_t firstInstance ) override
+	{
+		return RENDER_STATUS_OK;
+	}
+
+	/// <inheritdoc />
+	RenderStatus RecordParallel( uint32_t count, std::function<void( uint32_t index )> func ) override
+	{
+		for ( uint32_t i = 0; i < count; ++i )
+			func( i );
+
+		return RENDER_STATUS_OK;
+	}
+
+	/// <inheritdoc />
+	RenderStatus CullIndirectDraws( const std::vector<RenderIndirectDraw>& draws, const std::vector<uint32_t>& instanceDraws,
+	    const Frustum& frustum ) override
+	{
+		return RENDER_STATUS_OK;
+	}
+
+	/// <inheritdoc />
+	RenderStatus DrawIndirect( uint32_t firstDraw, uint32_t drawCount ) override { return RENDER_STATUS_OK; }
 
 	/// <inheritdoc />
 	RenderStatus BindRenderTarget( RenderTexture rt ) override { return RENDER_STATUS_OK; }
@@ -91,4 +127,17 @@ public:
 
 	/// <inheritdoc />
 	RenderStatus GetImGuiTextureID( ImageTexture* texture, void** outTextureId ) override { return RENDER_STATUS_OK; }
+
+	// ----------------------------------------
+
+	/// <inheritdoc />
+	bool IsBindless() override { return false; }
+
+	/// <inheritdoc />
+	RenderStatus GetBindlessTextureIndex( ImageTexture* texture, uint32_t* outIndex ) override { return RENDER_STATUS_OK; }
+
+	// ----------------------------------------
+
+	/// <inheritdoc />
+	bool IsGpuDriven() override { return false; }
 };
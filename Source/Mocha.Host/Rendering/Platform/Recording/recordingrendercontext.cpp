@@ -0,0 +1,512 @@
+#include "recordingrendercontext.h"
+
+#include <Misc/jobmanager.h>
+
+thread_local RecordingRenderContext::CommandStream* RecordingRenderContext::s_parallelStream = nullptr;
+
+void RecordingCounts::Add( const RecordingCounts& other )
+{
+	frames += other.frames;
+	pipelineBinds += other.pipelineBinds;
+	descriptorBinds += other.descriptorBinds;
+	vertexBufferBinds += other.vertexBufferBinds;
+	indexBufferBinds += other.indexBufferBinds;
+	constantBinds += other.constantBinds;
+	descriptorUpdates += other.descriptorUpdates;
+	draws += other.draws;
+	indirectDraws += other.indirectDraws;
+	instances += other.instances;
+	bufferUploads += other.bufferUploads;
+	textureUploads += other.textureUploads;
+	uploadedBytes += other.uploadedBytes;
+}
+
+RecordingRenderContext::RecordingRenderContext( Size2D renderSize )
+    : m_renderSize( renderSize )
+{
+	m_hasInitialized = false;
+	m_renderingActive = false;
+	m_currentPipeline = nullptr;
+	m_currentVertexBuffer = nullptr;
+}
+
+RecordingRenderContext::CommandStream& RecordingRenderContext::GetStream()
+{
+	if ( s_parallelStream != nullptr )
+		return *s_parallelStream;
+
+	return m_mainStream;
+}
+
+void RecordingRenderContext::Record(
+    RecordedCommandType type, Handle handle, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3 )
+{
+	CommandStream& stream = GetStream();
+
+	// Parallel streams belong to one thread each; the main one is shared with anything uploading
+	std::unique_lock<std::mutex> lock( m_mutex, std::defer_lock );
+
+	if ( &stream == &m_mainStream )
+		lock.lock();
+
+	stream.commands.push_back( { type, handle, { arg0, arg1, arg2, arg3 } } );
+
+	RecordingCounts& counts = stream.counts;
+
+	switch ( type )
+	{
+	case RECORDED_COMMAND_BIND_PIPELINE:
+		counts.pipelineBinds++;
+		break;
+	case RECORDED_COMMAND_BIND_DESCRIPTOR:
+		counts.descriptorBinds++;
+		break;
+	case RECORDED_COMMAND_UPDATE_DESCRIPTOR:
+		counts.descriptorUpdates++;
+		break;
+	case RECORDED_COMMAND_BIND_VERTEX_BUFFER:
+		counts.vertexBufferBinds++;
+		break;
+	case RECORDED_COMMAND_BIND_INDEX_BUFFER:
+		counts.indexBufferBinds++;
+		break;
+	case RECORDED_COMMAND_BIND_CONSTANTS:
+		counts.constantBinds++;
+		break;
+	case RECORDED_COMMAND_DRAW:
+		counts.draws++;
+		counts.instances += arg2;
+		break;
+	case RECORDED_COMMAND_DRAW_INDIRECT:
+		counts.indirectDraws++;
+		break;
+	case RECORDED_COMMAND_UPLOAD_BUFFER:
+		counts.bufferUploads++;
+		counts.uploadedBytes += arg0;
+		break;
+	case RECORDED_COMMAND_UPLOAD_TEXTURE:
+		counts.textureUploads++;
+		counts.uploadedBytes += arg3;
+		break;
+	default:
+		break;
+	}
+}
+
+void RecordingRenderContext::ResetCounts()
+{
+	std::lock_guard lock( m_mutex );
+	m_mainStream.counts = {};
+}
+
+// ----------------------------------------------------------------------------------------------------------------------------
+
+RenderStatus RecordingRenderContext::CreateImageTexture( ImageTextureInfo_t textureInfo, Handle* outHandle )
+{
+	*outHandle = m_imageTextures.Add( { textureInfo.width, textureInfo.height } );
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::CreateRenderTexture( RenderTextureInfo_t textureInfo, Handle* outHandle )
+{
+	*outHandle = m_renderTextures.Add( { textureInfo.width, textureInfo.height } );
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::SetImageTextureData( Handle handle, TextureData_t textureData )
+{
+	ErrorIf( !m_imageTextures.IsValid( handle ), RENDER_STATUS_INVALID_HANDLE );
+
+	m_imageTextures.Get( handle )->version++;
+
+	Record( RECORDED_COMMAND_UPLOAD_TEXTURE, handle, textureData.width, textureData.height, textureData.mipCount,
+	    static_cast<uint32_t>( textureData.mipData.size ) );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::CopyImageTexture( Handle handle, TextureCopyData_t copyData )
+{
+	ErrorIf( !m_imageTextures.IsValid( handle ), RENDER_STATUS_INVALID_HANDLE );
+	ErrorIf( copyData.src == nullptr || !m_imageTextures.IsValid( copyData.src->m_handle ), RENDER_STATUS_INVALID_HANDLE );
+
+	Record( RECORDED_COMMAND_COPY_TEXTURE, handle, copyData.width, copyData.height );
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::CreateBuffer( BufferInfo_t bufferInfo, Handle* outHandle )
+{
+	*outHandle = m_buffers.Add( { bufferInfo.size, bufferInfo.usage } );
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::CreateVertexBuffer( BufferInfo_t bufferInfo, Handle* outHandle )
+{
+	bufferInfo.usage = bufferInfo.usage | BUFFER_USAGE_FLAG_VERTEX_BUFFER;
+	return CreateBuffer( bufferInfo, outHandle );
+}
+
+RenderStatus RecordingRenderContext::CreateIndexBuffer( BufferInfo_t bufferInfo, Handle* outHandle )
+{
+	bufferInfo.usage = bufferInfo.usage | BUFFER_USAGE_FLAG_INDEX_BUFFER;
+	return CreateBuffer( bufferInfo, outHandle );
+}
+
+RenderStatus RecordingRenderContext::UploadBuffer( Handle handle, BufferUploadInfo_t uploadInfo )
+{
+	std::shared_ptr<RecordedBuffer> buffer = m_buffers.Get( handle );
+	ErrorIf( buffer == nullptr, RENDER_STATUS_INVALID_HANDLE );
+	assert( uploadInfo.offset + uploadInfo.data.size <= buffer->size && "Upload runs off the end of the buffer" );
+
+	Record( RECORDED_COMMAND_UPLOAD_BUFFER, handle, static_cast<uint32_t>( uploadInfo.data.size ), uploadInfo.offset );
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::CreatePipeline( PipelineInfo_t pipelineInfo, Handle* outHandle )
+{
+	*outHandle = m_pipelines.Add( {} );
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::CreateDescriptor( DescriptorInfo_t descriptorInfo, Handle* outHandle )
+{
+	RecordedDescriptor descriptor = {};
+	descriptor.boundImages.resize( descriptorInfo.bindings.size() );
+
+	*outHandle = m_descriptors.Add( descriptor );
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::CreateShader( ShaderInfo_t shaderInfo, Handle* outHandle )
+{
+	*outHandle = m_shaders.Add( {} );
+	return RENDER_STATUS_OK;
+}
+
+// ----------------------------------------------------------------------------------------------------------------------------
+
+RenderStatus RecordingRenderContext::Startup()
+{
+	ErrorIf( m_hasInitialized, RENDER_STATUS_ALREADY_INITIALIZED );
+
+	// Same startup-only switches as the Vulkan backend, so that either path through RenderManager can
+	// be exercised
+	m_isBindless = EngineProperties::Bindless;
+	m_isGpuDriven = EngineProperties::GpuDriven;
+
+	m_hasInitialized = true;
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::Shutdown()
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+
+	m_hasInitialized = false;
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::BeginRendering()
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+
+	{
+		std::lock_guard lock( m_mutex );
+
+		m_mainStream.commands.clear();
+		m_mainStream.counts.frames++;
+
+		// A fresh command buffer has nothing bound
+		m_mainStream.bound = {};
+	}
+
+	m_indirectDrawCount = 0;
+	m_renderingActive = true;
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::EndRendering()
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+
+	m_renderingActive = false;
+
+	return RENDER_STATUS_OK;
+}
+
+// ----------------------------------------------------------------------------------------------------------------------------
+
+RenderStatus RecordingRenderContext::BindPipeline( Pipeline p )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+	ErrorIf( !m_pipelines.IsValid( p.m_handle ), RENDER_STATUS_INVALID_HANDLE );
+
+	GetStream().bound.pipeline = p.m_handle;
+	Record( RECORDED_COMMAND_BIND_PIPELINE, p.m_handle );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::BindDescriptor( Descriptor d )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+	ErrorIf( !m_descriptors.IsValid( d.m_handle ), RENDER_STATUS_INVALID_HANDLE );
+
+	// Descriptor sets are bound against the pipeline's layout
+	ErrorIf( GetStream().bound.pipeline == HANDLE_INVALID, RENDER_STATUS_NO_PIPELINE_BOUND );
+
+	Record( RECORDED_COMMAND_BIND_DESCRIPTOR, d.m_handle );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::UpdateDescriptor( Descriptor d, DescriptorUpdateInfo_t updateInfo )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_descriptors.IsValid( d.m_handle ), RENDER_STATUS_INVALID_HANDLE );
+	ErrorIf( updateInfo.src == nullptr || !m_imageTextures.IsValid( updateInfo.src->m_handle ), RENDER_STATUS_INVALID_HANDLE );
+
+	std::shared_ptr<RecordedDescriptor> descriptor = m_descriptors.Get( d.m_handle );
+	std::shared_ptr<RecordedTexture> texture = m_imageTextures.Get( updateInfo.src->m_handle );
+
+	ErrorIf( updateInfo.binding < 0 || static_cast<size_t>( updateInfo.binding ) >= descriptor->boundImages.size(),
+	    RENDER_STATUS_INVALID_HANDLE );
+
+	// Nothing to point at yet
+	if ( texture->version == 0 )
+		return RENDER_STATUS_OK;
+
+	RecordedDescriptor::BoundImage& boundImage = descriptor->boundImages[updateInfo.binding];
+
+	if ( boundImage.texture == updateInfo.src->m_handle && boundImage.textureVersion == texture->version &&
+	     boundImage.samplerType == updateInfo.samplerType )
+	{
+		return RENDER_STATUS_OK;
+	}
+
+	boundImage.texture = updateInfo.src->m_handle;
+	boundImage.textureVersion = texture->version;
+	boundImage.samplerType = updateInfo.samplerType;
+
+	Record( RECORDED_COMMAND_UPDATE_DESCRIPTOR, d.m_handle, static_cast<uint32_t>( updateInfo.binding ) );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::BindVertexBuffer( VertexBuffer vb )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+	ErrorIf( !m_buffers.IsValid( vb.m_handle ), RENDER_STATUS_INVALID_HANDLE );
+
+	GetStream().bound.vertexBuffer = vb.m_handle;
+	Record( RECORDED_COMMAND_BIND_VERTEX_BUFFER, vb.m_handle );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::BindIndexBuffer( IndexBuffer ib )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+	ErrorIf( !m_buffers.IsValid( ib.m_handle ), RENDER_STATUS_INVALID_HANDLE );
+
+	GetStream().bound.indexBuffer = ib.m_handle;
+	Record( RECORDED_COMMAND_BIND_INDEX_BUFFER, ib.m_handle );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::BindConstants( RenderPushConstants p )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+	ErrorIf( GetStream().bound.pipeline == HANDLE_INVALID, RENDER_STATUS_NO_PIPELINE_BOUND );
+
+	Record( RECORDED_COMMAND_BIND_CONSTANTS, HANDLE_INVALID );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::SetFrameConstants( const RenderFrameConstants& constants )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+
+	Record( RECORDED_COMMAND_SET_FRAME_CONSTANTS, HANDLE_INVALID );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::SetLightData( const std::vector<RenderLight>& lights,
+    const std::vector<RenderLightCluster>& clusters, const std::vector<uint32_t>& lightIndices )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+
+	Record( RECORDED_COMMAND_SET_LIGHT_DATA, HANDLE_INVALID, static_cast<uint32_t>( lights.size() ),
+	    static_cast<uint32_t>( clusters.size() ), static_cast<uint32_t>( lightIndices.size() ) );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::SetInstanceData( const std::vector<RenderInstanceData>& instances )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+
+	Record( RECORDED_COMMAND_SET_INSTANCE_DATA, HANDLE_INVALID, static_cast<uint32_t>( instances.size() ) );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::Draw( uint32_t vertexCount, uint32_t indexCount, uint32_t firstIndex,
+    int32_t vertexOffset, uint32_t instanceCount, uint32_t firstInstance )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+
+	const BoundState& bound = GetStream().bound;
+	ErrorIf( bound.pipeline == HANDLE_INVALID, RENDER_STATUS_NO_PIPELINE_BOUND );
+	ErrorIf( bound.vertexBuffer == HANDLE_INVALID, RENDER_STATUS_NO_VERTEX_BUFFER_BOUND );
+	ErrorIf( indexCount > 0 && bound.indexBuffer == HANDLE_INVALID, RENDER_STATUS_NO_INDEX_BUFFER_BOUND );
+
+	Record( RECORDED_COMMAND_DRAW, bound.pipeline, indexCount > 0 ? indexCount : vertexCount, firstIndex, instanceCount,
+	    firstInstance );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::RecordParallel( uint32_t count, std::function<void( uint32_t index )> func )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+
+	if ( count == 0 )
+		return RENDER_STATUS_OK;
+
+	// Like secondary command buffers, each stream starts off with nothing bound
+	std::vector<CommandStream> streams( count );
+
+	Globals::m_jobManager->ParallelFor( count, 1, [&]( size_t start, size_t end ) {
+		for ( size_t i = start; i < end; ++i )
+		{
+			// Jobs can run inside other jobs on the same thread, so put back whatever was there before
+			CommandStream* previousStream = s_parallelStream;
+			s_parallelStream = &streams[i];
+
+			func( static_cast<uint32_t>( i ) );
+
+			s_parallelStream = previousStream;
+		}
+	} );
+
+	std::lock_guard lock( m_mutex );
+
+	for ( CommandStream& stream : streams )
+	{
+		m_mainStream.commands.insert( m_mainStream.commands.end(), stream.commands.begin(), stream.commands.end() );
+		m_mainStream.counts.Add( stream.counts );
+	}
+
+	// The Vulkan backend forgets its bindings after executing secondary command buffers, so do the same
+	m_mainStream.bound = {};
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::CullIndirectDraws(
+    const std::vector<RenderIndirectDraw>& draws, const std::vector<uint32_t>& instanceDraws, const Frustum& frustum )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+	ErrorIf( !m_isGpuDriven, RENDER_STATUS_NOT_INITIALIZED );
+
+	m_indirectDrawCount = static_cast<uint32_t>( draws.size() );
+
+	Record( RECORDED_COMMAND_CULL_INDIRECT, HANDLE_INVALID, static_cast<uint32_t>( draws.size() ),
+	    static_cast<uint32_t>( instanceDraws.size() ) );
+
+	// Culling runs between render passes, which disturbs the bindings
+	GetStream().bound.pipeline = HANDLE_INVALID;
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::DrawIndirect( uint32_t firstDraw, uint32_t drawCount )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+	ErrorIf( !m_isGpuDriven, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( firstDraw + drawCount > m_indirectDrawCount, RENDER_STATUS_INVALID_HANDLE );
+
+	const BoundState& bound = GetStream().bound;
+	ErrorIf( bound.pipeline == HANDLE_INVALID, RENDER_STATUS_NO_PIPELINE_BOUND );
+	ErrorIf( bound.vertexBuffer == HANDLE_INVALID, RENDER_STATUS_NO_VERTEX_BUFFER_BOUND );
+	ErrorIf( bound.indexBuffer == HANDLE_INVALID, RENDER_STATUS_NO_INDEX_BUFFER_BOUND );
+
+	Record( RECORDED_COMMAND_DRAW_INDIRECT, bound.pipeline, firstDraw, drawCount );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::BindRenderTarget( RenderTexture rt )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+	ErrorIf( !m_renderTextures.IsValid( rt.m_handle ), RENDER_STATUS_INVALID_HANDLE );
+
+	Record( RECORDED_COMMAND_BIND_RENDER_TARGET, rt.m_handle );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::GetRenderSize( Size2D* outSize )
+{
+	*outSize = m_renderSize;
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::GetWindowSize( Size2D* outSize )
+{
+	*outSize = m_renderSize;
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::GetGPUInfo( GPUInfo* outInfo )
+{
+	GPUInfo info = {};
+	info.gpuName = "None (recording)";
+
+	*outInfo = info;
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::GetImGuiTextureID( ImageTexture* texture, void** outTextureId )
+{
+	// There's no ImGui to hand textures to
+	*outTextureId = nullptr;
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus RecordingRenderContext::GetBindlessTextureIndex( ImageTexture* texture, uint32_t* outIndex )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	assert( m_isBindless && "Bindless textures are only available when render.bindless is on" );
+
+	if ( !m_imageTextures.IsValid( texture->m_handle ) )
+		return RENDER_STATUS_INVALID_HANDLE;
+
+	// Same slot scheme as the Vulkan backend
+	*outIndex = HandleMap<RecordedTexture>::GetSlotIndex( texture->m_handle );
+
+	return RENDER_STATUS_OK;
+}
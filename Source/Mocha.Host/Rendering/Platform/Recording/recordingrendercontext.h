@@ -0,0 +1,286 @@
+#pragma once
+
+#include <Misc/defs.h>
+#include <Misc/globalvars.h>
+#include <Misc/handlemap.h>
+#include <Misc/mathtypes.h>
+#include <Rendering/baserendercontext.h>
+#include <mutex>
+#include <vector>
+
+// ----------------------------------------------------------------------------------------------------------------------------
+
+enum RecordedCommandType : uint8_t
+{
+	RECORDED_COMMAND_BIND_PIPELINE,
+	RECORDED_COMMAND_BIND_DESCRIPTOR,
+	RECORDED_COMMAND_UPDATE_DESCRIPTOR,
+	RECORDED_COMMAND_BIND_VERTEX_BUFFER,
+	RECORDED_COMMAND_BIND_INDEX_BUFFER,
+	RECORDED_COMMAND_BIND_CONSTANTS,
+	RECORDED_COMMAND_BIND_RENDER_TARGET,
+	RECORDED_COMMAND_SET_FRAME_CONSTANTS,
+	RECORDED_COMMAND_SET_LIGHT_DATA,    // args: light count, cluster count, light index count
+	RECORDED_COMMAND_SET_INSTANCE_DATA, // args: instance count
+	RECORDED_COMMAND_DRAW,              // args: index (or vertex) count, first index, instance count, first instance
+	RECORDED_COMMAND_CULL_INDIRECT,     // args: draw count, instance count
+	RECORDED_COMMAND_DRAW_INDIRECT,     // args: first draw, draw count
+	RECORDED_COMMAND_UPLOAD_BUFFER,     // args: size, offset
+	RECORDED_COMMAND_UPLOAD_TEXTURE,    // args: width, height, mip count, size
+	RECORDED_COMMAND_COPY_TEXTURE       // args: width, height
+};
+
+// One call into the render context. handle is whatever object the call was about, if any.
+struct RecordedCommand
+{
+	RecordedCommandType type;
+	Handle handle = HANDLE_INVALID;
+	uint32_t args[4] = {};
+};
+
+// Running totals, kept until ResetCounts
+struct RecordingCounts
+{
+	uint32_t frames = 0;
+
+	uint32_t pipelineBinds = 0;
+	uint32_t descriptorBinds = 0;
+	uint32_t vertexBufferBinds = 0;
+	uint32_t indexBufferBinds = 0;
+	uint32_t constantBinds = 0;
+
+	uint32_t descriptorUpdates = 0;
+
+	// Draw and DrawIndirect calls respectively; each DrawIndirect can cover many draws
+	uint32_t draws = 0;
+	uint32_t indirectDraws = 0;
+
+	// Instances covered by Draw calls
+	uint32_t instances = 0;
+
+	uint32_t bufferUploads = 0;
+	uint32_t textureUploads = 0;
+	uint64_t uploadedBytes = 0;
+
+	void Add( const RecordingCounts& other );
+};
+
+// ----------------------------------------------------------------------------------------------------------------------------
+
+//
+// A render context with no GPU behind it. Objects get real handles, bound state is tracked and checked
+// the same way the Vulkan backend does, and every call is written to a compact command stream along
+// with running counts. This lets the CPU side of the renderer be run, profiled and checked on machines
+// without a GPU (see render.recording).
+//
+// The command stream holds everything since the last BeginRendering; the counts hold everything since
+// the last ResetCounts.
+//
+class RecordingRenderContext : public BaseRenderContext
+{
+private:
+	struct RecordedBuffer
+	{
+		uint32_t size;
+		BufferUsageFlags usage;
+	};
+
+	struct RecordedTexture
+	{
+		uint32_t width;
+		uint32_t height;
+
+		// Bumped every time the texture's data is set; 0 means it hasn't got any yet
+		uint32_t version = 0;
+	};
+
+	struct RecordedDescriptor
+	{
+		// What was last written to each binding, so that UpdateDescriptor can skip writes that wouldn't
+		// change anything, the same way the Vulkan backend does
+		struct BoundImage
+		{
+			Handle texture = HANDLE_INVALID;
+			uint32_t textureVersion = 0;
+			SamplerType samplerType = SAMPLER_TYPE_POINT;
+		};
+
+		std::vector<BoundImage> boundImages;
+	};
+
+	// Placeholder for objects that have nothing worth keeping
+	struct RecordedObject
+	{
+	};
+
+	// What's bound, as seen by one stream of commands
+	struct BoundState
+	{
+		Handle pipeline = HANDLE_INVALID;
+		Handle vertexBuffer = HANDLE_INVALID;
+		Handle indexBuffer = HANDLE_INVALID;
+	};
+
+	// Each RecordParallel index gets one of these, like a secondary command buffer, and they're added on
+	// to the main one in order once they're all done
+	struct CommandStream
+	{
+		std::vector<RecordedCommand> commands;
+		RecordingCounts counts;
+		BoundState bound;
+	};
+
+	Size2D m_renderSize;
+
+	bool m_isBindless = false;
+	bool m_isGpuDriven = false;
+
+	// How many draws the last CullIndirectDraws handed over, for checking DrawIndirect against
+	uint32_t m_indirectDrawCount = 0;
+
+	// Uploads can come from any thread, so anything going into the main stream goes through this
+	std::mutex m_mutex;
+	CommandStream m_mainStream = {};
+
+	HandleMap<RecordedBuffer> m_buffers = {};
+	HandleMap<RecordedTexture> m_imageTextures = {};
+	HandleMap<RecordedTexture> m_renderTextures = {};
+	HandleMap<RecordedDescriptor> m_descriptors = {};
+	HandleMap<RecordedObject> m_pipelines = {};
+	HandleMap<RecordedObject> m_shaders = {};
+
+	// The stream a RecordParallel job is recording into, if the calling thread is running one
+	static thread_local CommandStream* s_parallelStream;
+
+	// The stream the calling thread should record into
+	CommandStream& GetStream();
+
+	// Adds a command to the calling thread's stream, and counts it
+	void Record( RecordedCommandType type, Handle handle, uint32_t arg0 = 0, uint32_t arg1 = 0, uint32_t arg2 = 0,
+	    uint32_t arg3 = 0 );
+
+protected:
+	// ----------------------------------------
+
+	RenderStatus CreateImageTexture( ImageTextureInfo_t textureInfo, Handle* outHandle ) override;
+	RenderStatus CreateRenderTexture( RenderTextureInfo_t textureInfo, Handle* outHandle ) override;
+	RenderStatus SetImageTextureData( Handle handle, TextureData_t pipelineInfo ) override;
+	RenderStatus CopyImageTexture( Handle handle, TextureCopyData_t pipelineInfo ) override;
+
+	RenderStatus CreateBuffer( BufferInfo_t bufferInfo, Handle* outHandle ) override;
+	RenderStatus CreateVertexBuffer( BufferInfo_t bufferInfo, Handle* outHandle ) override;
+	RenderStatus CreateIndexBuffer( BufferInfo_t bufferInfo, Handle* outHandle ) override;
+	RenderStatus UploadBuffer( Handle handle, BufferUploadInfo_t pipelineInfo ) override;
+
+	RenderStatus CreatePipeline( PipelineInfo_t pipelineInfo, Handle* outHandle ) override;
+	RenderStatus CreateDescriptor( DescriptorInfo_t pipelineInfo, Handle* outHandle ) override;
+	RenderStatus CreateShader( ShaderInfo_t pipelineInfo, Handle* outHandle ) override;
+
+public:
+	// renderSize is what GetRenderSize and GetWindowSize report, since there's no window to measure
+	RecordingRenderContext( Size2D renderSize = { 1280, 720 } );
+
+	// Everything recorded since the last BeginRendering. Only safe to read while nothing is recording.
+	const std::vector<RecordedCommand>& GetCommands() const { return m_mainStream.commands; }
+
+	// Totals since the last ResetCounts. Only safe to read while nothing is recording.
+	const RecordingCounts& GetCounts() const { return m_mainStream.counts; }
+
+	void ResetCounts();
+
+	// ----------------------------------------
+
+	/// <inheritdoc />
+	RenderStatus Startup() override;
+	/// <inheritdoc />
+	RenderStatus Shutdown() override;
+	/// <inheritdoc />
+	RenderStatus BeginRendering() override;
+	/// <inheritdoc />
+	RenderStatus EndRendering() override;
+
+	// ----------------------------------------
+
+	/// <inheritdoc />
+	RenderStatus BindPipeline( Pipeline p ) override;
+
+	/// <inheritdoc />
+	RenderStatus BindDescriptor( Descriptor d ) override;
+
+	/// <inheritdoc />
+	RenderStatus UpdateDescriptor( Descriptor d, DescriptorUpdateInfo_t updateInfo ) override;
+
+	/// <inheritdoc />
+	RenderStatus BindVertexBuffer( VertexBuffer vb ) override;
+
+	/// <inheritdoc />
+	RenderStatus BindIndexBuffer( IndexBuffer ib ) override;
+
+	/// <inheritdoc />
+	RenderStatus BindConstants( RenderPushConstants p ) override;
+
+	/// <inheritdoc />
+	RenderStatus SetFrameConstants( const RenderFrameConstants& constants ) override;
+
+	/// <inheritdoc />
+	RenderStatus SetLightData( const std::vector<RenderLight>& lights, const std::vector<RenderLightCluster>& clusters,
+	    const std::vector<uint32_t>& lightIndices ) override;
+
+	/// <inheritdoc />
+	RenderStatus SetInstanceData( const std::vector<RenderInstanceData>& instances ) override;
+
+	/// <inheritdoc />
+	RenderStatus Draw( uint32_t vertexCount, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset,
+	    uint32_t instanceCount, uint32_t firstInstance ) override;
+
+	/// <inheritdoc />
+	RenderStatus RecordParallel( uint32_t count, std::function<void( uint32_t index )> func ) override;
+
+	/// <inheritdoc />
+	RenderStatus CullIndirectDraws( const std::vector<RenderIndirectDraw>& draws, const std::vector<uint32_t>& instanceDraws,
+	    const Frustum& frustum ) override;
+
+	/// <inheritdoc />
+	RenderStatus DrawIndirect( uint32_t firstDraw, uint32_t drawCount ) override;
+
+	/// <inheritdoc />
+	RenderStatus BindRenderTarget( RenderTexture rt ) override;
+
+	/// <inheritdoc />
+	RenderStatus GetRenderSize( Size2D* outSize ) override;
+
+	/// <inheritdoc />
+	RenderStatus GetWindowSize( Size2D* outSize ) override;
+
+	/// <inheritdoc />
+	void UpdateWindow() override {}
+
+	/// <inheritdoc />
+	bool GetWindowCloseRequested() override { return false; }
+
+	/// <inheritdoc />
+	RenderStatus GetGPUInfo( GPUInfo* outInfo ) override;
+
+	// ----------------------------------------
+
+	/// <inheritdoc />
+	RenderStatus BeginImGui() override { return RENDER_STATUS_OK; }
+	/// <inheritdoc />
+	RenderStatus EndImGui() override { return RENDER_STATUS_OK; }
+
+	/// <inheritdoc />
+	RenderStatus GetImGuiTextureID( ImageTexture* texture, void** outTextureId ) override;
+
+	// ----------------------------------------
+
+	/// <inheritdoc />
+	bool IsBindless() override { return m_isBindless; }
+
+	/// <inheritdoc />
+	RenderStatus GetBindlessTextureIndex( ImageTexture* texture, uint32_t* outIndex ) override;
+
+	// ----------------------------------------
+
+	/// <inheritdoc />
+	bool IsGpuDriven() override { return m_isGpuDriven; }
+};
@@ -2,7 +2,7 @@
 
 #include <spdlog/spdlog.h>
 
-VkPipeline PipelineBuilder::Build( VkDevice device, VkFormat colorFormat, VkFormat depthFormat )
+VkPipeline PipelineBuilder::Build( VkDevice device, VkPipelineCache pipelineCache, VkFormat colorFormat, VkFormat depthFormat )
 {
 	VkPipelineViewportStateCreateInfo viewportState = {};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -68,6 +68,6 @@ VkPipeline PipelineBuilder::Build( VkDevice device, VkFormat colorFormat, VkForm
 	pipelineInfo.renderPass = VK_NULL_HANDLE;
 
 	VkPipeline newPipeline;
-	VK_CHECK( vkCreateGraphicsPipelines( device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline ) );
+	VK_CHECK( vkCreateGraphicsPipelines( device, pipelineCache, 1, &pipelineInfo, nullptr, &newPipeline ) );
 	return newPipeline;
 }
@@ -16,5 +16,5 @@ public:
 
 	VkPipelineDepthStencilStateCreateInfo m_depthStencil = {};
 
-	VkPipeline Build( VkDevice device, VkFormat depthFormat, VkFormat colorFormat );
+	VkPipeline Build( VkDevice device, VkPipelineCache pipelineCache, VkFormat colorFormat, VkFormat depthFormat );
 };
\ No newline at end of file
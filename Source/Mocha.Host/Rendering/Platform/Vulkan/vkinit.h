@@ -339,4 +339,20 @@ namespace VKInit
 
 		return write;
 	}
+
+	inline VkWriteDescriptorSet WriteDescriptorBuffer(
+	    VkDescriptorType type, VkDescriptorSet dstSet, VkDescriptorBufferInfo* bufferInfo, uint32_t binding )
+	{
+		VkWriteDescriptorSet write = {};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.pNext = nullptr;
+
+		write.dstBinding = binding;
+		write.dstSet = dstSet;
+		write.descriptorCount = 1;
+		write.descriptorType = type;
+		write.pBufferInfo = bufferInfo;
+
+		return write;
+	}
 } // namespace VKInit
\ No newline at end of file
@@ -1,11 +1,14 @@
 #include "vulkanrendercontext.h"
 
 #include <Managed/hostmanager.h>
+#include <Misc/jobmanager.h>
 #include <Misc/projectmanager.h>
 #include <Rendering/Assets/mesh.h>
 #include <Rendering/Platform/Vulkan/pipeline.h>
 #include <Rendering/shadercompiler.h>
 #include <Root/root.h>
+#include <filesystem>
+#include <fstream>
 #include <volk.h>
 
 #if 0
@@ -26,6 +29,55 @@
 #include <fontawesome.h>
 #include <imgui.h>
 #include <implot.h>
+
+// Anything bigger than a quarter of this skips the ring and gets its own staging buffer
+static constexpr VkDeviceSize UPLOAD_RING_SIZE = 64 * 1024 * 1024;
+
+// Buffer copies only need 4 bytes, but copies into block-compressed images need a whole block
+static constexpr VkDeviceSize UPLOAD_ALIGNMENT = 16;
+
+static const std::filesystem::path PIPELINE_CACHE_PATH = ".cache/pipelines.bin";
+
+// Goes in front of the driver's own pipeline cache data, so that we can tell whether it's worth
+// handing back to the driver at all
+struct PipelineCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	uint64_t dataSize;
+};
+
+static constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x434c504d; // "MPLC"
+static constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+
+// Upper bound on the bindless texture array; the device's own limits can bring this down further
+static constexpr uint32_t MAX_BINDLESS_TEXTURES = 65536;
+
+// What the calling thread is recording into while it runs part of a RecordParallel
+struct VulkanRecordingState
+{
+	VkCommandBuffer commandBuffer;
+	std::shared_ptr<VulkanPipeline> pipeline;
+};
+
+static thread_local VulkanRecordingState* t_recordingState = nullptr;
+
+// Push constants for both GPU culling passes; matches g_gpuCullingShaderCommon
+struct VulkanCullConstants
+{
+	glm::vec4 frustumPlanes[6];
+	uint32_t instanceCount;
+	uint32_t drawCount;
+};
+
+// Threads per workgroup in the GPU culling shaders
+static constexpr uint32_t CULL_WORKGROUP_SIZE = 64;
+
+IntCVar renderFramesInFlight( "render.frames_in_flight", 2, CVarFlags::Archive,
+    "How many frames the CPU can record ahead of the GPU. Only read at startup" );
 #endif
 
 // ----------------------------------------------------------------------------------------------------------------------------
@@ -179,8 +231,29 @@ VulkanImageTexture::VulkanImageTexture( VulkanRenderContext* parent, ImageTextur
 
 void VulkanImageTexture::SetData( TextureData_t textureData )
 {
-	// Destroy old image
-	Delete();
+	//
+	// Destroy old image once nothing can be using it. Frames already in flight (or commands recorded
+	// earlier this one) might still sample it, and its own upload might not have run yet.
+	//
+	if ( image != VK_NULL_HANDLE )
+	{
+		VulkanRenderContext* parent = m_parent;
+		VkImage oldImage = image;
+		VmaAllocation oldAllocation = allocation;
+		VkImageView oldImageView = imageView;
+		VulkanUploadTicket oldUploadTicket = uploadTicket;
+
+		m_parent->GetFrameDeletionQueue().Enqueue( [parent, oldImage, oldAllocation, oldImageView, oldUploadTicket]() {
+			parent->m_uploadQueue->Wait( oldUploadTicket );
+
+			vkDestroyImageView( parent->m_device, oldImageView, nullptr );
+			vmaDestroyImage( parent->m_allocator, oldImage, oldAllocation );
+		} );
+
+		image = VK_NULL_HANDLE;
+		allocation = VK_NULL_HANDLE;
+		imageView = VK_NULL_HANDLE;
+	}
 
 	VkFormat imageFormat = ( VkFormat )textureData.imageFormat;
 	uint32_t imageSize = 0;
@@ -190,21 +263,6 @@ void VulkanImageTexture::SetData( TextureData_t textureData )
 		imageSize += CalcMipSize( textureData.width, textureData.height, i, imageFormat );
 	}
 
-	BufferInfo_t bufferInfo = {};
-	bufferInfo.size = imageSize;
-	bufferInfo.type = BUFFER_TYPE_STAGING;
-	bufferInfo.usage = BUFFER_USAGE_FLAG_TRANSFER_SRC;
-
-	Handle bufferHandle;
-	m_parent->CreateBuffer( bufferInfo, &bufferHandle );
-
-	std::shared_ptr<VulkanBuffer> stagingBuffer = m_parent->m_buffers.Get( bufferHandle );
-
-	void* mappedData;
-	vmaMapMemory( m_parent->m_allocator, stagingBuffer->allocation, &mappedData );
-	memcpy( mappedData, textureData.mipData.data, static_cast<size_t>( textureData.mipData.size ) );
-	vmaUnmapMemory( m_parent->m_allocator, stagingBuffer->allocation );
-
 	VkExtent3D imageExtent;
 	imageExtent.width = textureData.width;
 	imageExtent.height = textureData.height;
@@ -215,6 +273,7 @@ void VulkanImageTexture::SetData( TextureData_t textureData )
 	                               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
 	VkImageCreateInfo imageCreateInfo = VKInit::ImageCreateInfo( imageFormat, usageFlags, imageExtent, textureData.mipCount );
+	m_parent->SetUploadSharingMode( imageCreateInfo );
 
 	VmaAllocationCreateInfo allocInfo = {};
 	allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
@@ -222,7 +281,7 @@ void VulkanImageTexture::SetData( TextureData_t textureData )
 	vmaCreateImage( m_parent->m_allocator, &imageCreateInfo, &allocInfo, &image, &allocation, nullptr );
 	vmaSetAllocationName( m_parent->m_allocator, allocation, textureInfo.name.c_str() );
 
-	m_parent->ImmediateSubmit( [&]( VkCommandBuffer cmd ) -> RenderStatus {
+	auto recordCopy = [&]( VkCommandBuffer cmd, VkBuffer stagingBuffer, VkDeviceSize stagingOffset ) {
 		{
 			VkImageMemoryBarrier transitionBarrier =
 			    VKInit::ImageMemoryBarrier( 0, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, image );
@@ -239,7 +298,7 @@ void VulkanImageTexture::SetData( TextureData_t textureData )
 			// Calculate the number of bytes that have passed until this mip
 			// This is done by taking all past mip widths * heights
 			//
-			VkDeviceSize bufferOffset = 0;
+			VkDeviceSize bufferOffset = stagingOffset;
 
 			for ( size_t i = 0; i < mip; ++i )
 			{
@@ -268,22 +327,28 @@ void VulkanImageTexture::SetData( TextureData_t textureData )
 		}
 
 		vkCmdCopyBufferToImage(
-		    cmd, stagingBuffer->buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipRegions.size(), mipRegions.data() );
+		    cmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipRegions.size(), mipRegions.data() );
 
 		{
+			// This might be recorded on a transfer-only queue, which doesn't know about fragment shaders.
+			// The frame waits on the upload's semaphore before it samples this, which makes the writes
+			// visible to it.
 			VkImageMemoryBarrier transitionBarrier = VKInit::ImageMemoryBarrier( VK_ACCESS_TRANSFER_WRITE_BIT,
 			    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, image );
 
-			vkCmdPipelineBarrier( cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
+			vkCmdPipelineBarrier( cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0,
 			    nullptr, 1, &transitionBarrier );
 		}
+	};
 
-		return RENDER_STATUS_OK;
-	} );
+	// The mip offsets above come from CalcMipSize, so the data has to be laid out the same way
+	assert( static_cast<uint32_t>( textureData.mipData.size ) >= imageSize );
+	uploadTicket = m_parent->m_uploadQueue->Upload( textureData.mipData.data, imageSize, recordCopy );
 
 	VkImageViewCreateInfo imageViewInfo =
 	    VKInit::ImageViewCreateInfo( ( VkFormat )imageFormat, image, VK_IMAGE_ASPECT_COLOR_BIT, textureData.mipCount );
 	vkCreateImageView( m_parent->m_device, &imageViewInfo, nullptr, &imageView );
+	version++;
 
 	SetDebugName( textureInfo.name.c_str(), VK_OBJECT_TYPE_IMAGE, ( uint64_t )image );
 
@@ -468,6 +533,322 @@ void VulkanCommandContext::Delete() const
 
 // ----------------------------------------------------------------------------------------------------------------------------
 
+VulkanUploadQueue::VulkanUploadQueue( VulkanRenderContext* parent, VkQueue queue, uint32_t queueFamily, VkDeviceSize ringSize )
+{
+	SetParent( parent );
+
+	m_queue = queue;
+	m_queueFamily = queueFamily;
+	m_ringSize = ringSize;
+
+	VkSemaphoreTypeCreateInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timelineInfo.pNext = nullptr;
+	timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &timelineInfo;
+
+	VK_CHECK( vkCreateSemaphore( parent->m_device, &semaphoreInfo, nullptr, &m_timelineSemaphore ) );
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.pNext = nullptr;
+	bufferInfo.size = ringSize;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+	VmaAllocationCreateInfo allocInfo = {};
+	allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+	allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	VmaAllocationInfo allocationInfo = {};
+	VK_CHECK( vmaCreateBuffer(
+	    parent->m_allocator, &bufferInfo, &allocInfo, &m_ringBuffer, &m_ringAllocation, &allocationInfo ) );
+
+	m_ringData = static_cast<uint8_t*>( allocationInfo.pMappedData );
+
+	SetDebugName( "Upload Timeline Semaphore", VK_OBJECT_TYPE_SEMAPHORE, ( uint64_t )m_timelineSemaphore );
+	SetDebugName( "Upload Staging Ring", VK_OBJECT_TYPE_BUFFER, ( uint64_t )m_ringBuffer );
+}
+
+uint64_t VulkanUploadQueue::GetCompletedValue() const
+{
+	uint64_t value = 0;
+	VK_CHECK( vkGetSemaphoreCounterValue( m_parent->m_device, m_timelineSemaphore, &value ) );
+
+	return value;
+}
+
+void VulkanUploadQueue::WaitForValue( uint64_t value ) const
+{
+	VkSemaphoreWaitInfo waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.pNext = nullptr;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &m_timelineSemaphore;
+	waitInfo.pValues = &value;
+
+	VK_CHECK( vkWaitSemaphores( m_parent->m_device, &waitInfo, UINT64_MAX ) );
+}
+
+bool VulkanUploadQueue::TryAllocate( VkDeviceSize size, VkDeviceSize* outOffset )
+{
+	// Nothing in flight; start again from the beginning, which gives us as much contiguous space as possible
+	if ( m_ringHead == m_ringTail )
+	{
+		m_ringHead = 0;
+		m_ringTail = 0;
+	}
+
+	VkDeviceSize offset = ( m_ringHead + UPLOAD_ALIGNMENT - 1 ) & ~( UPLOAD_ALIGNMENT - 1 );
+
+	if ( m_ringHead >= m_ringTail )
+	{
+		// Free space is [head, end) and [0, tail). The head can never catch up with the tail, otherwise a
+		// full ring would look the same as an empty one
+		if ( offset + size > m_ringSize )
+		{
+			if ( size >= m_ringTail )
+				return false;
+
+			offset = 0;
+		}
+	}
+	else if ( offset + size >= m_ringTail )
+	{
+		// Free space is [head, tail)
+		return false;
+	}
+
+	m_ringHead = offset + size;
+	*outOffset = offset;
+
+	return true;
+}
+
+void VulkanUploadQueue::OpenBatch()
+{
+	if ( !m_freeBatches.empty() )
+	{
+		m_openBatch = std::move( m_freeBatches.back() );
+		m_freeBatches.pop_back();
+	}
+	else
+	{
+		m_openBatch = {};
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.pNext = nullptr;
+		poolInfo.queueFamilyIndex = m_queueFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		VK_CHECK( vkCreateCommandPool( m_parent->m_device, &poolInfo, nullptr, &m_openBatch.commandPool ) );
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.pNext = nullptr;
+		allocInfo.commandPool = m_openBatch.commandPool;
+		allocInfo.commandBufferCount = 1;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+		VK_CHECK( vkAllocateCommandBuffers( m_parent->m_device, &allocInfo, &m_openBatch.commandBuffer ) );
+
+		SetDebugName( "Upload Batch Command Buffer", VK_OBJECT_TYPE_COMMAND_BUFFER, ( uint64_t )m_openBatch.commandBuffer );
+	}
+
+	m_openBatch.uploadCount = 0;
+
+	VkCommandBufferBeginInfo beginInfo = VKInit::CommandBufferBeginInfo( VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT );
+	VK_CHECK( vkBeginCommandBuffer( m_openBatch.commandBuffer, &beginInfo ) );
+
+	m_hasOpenBatch = true;
+}
+
+void VulkanUploadQueue::SubmitOpenBatch()
+{
+	if ( !m_hasOpenBatch || m_openBatch.uploadCount == 0 )
+		return;
+
+	VK_CHECK( vkEndCommandBuffer( m_openBatch.commandBuffer ) );
+
+	m_openBatch.value = ++m_submittedValue;
+	m_openBatch.ringEnd = m_ringHead;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.pNext = nullptr;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &m_openBatch.value;
+
+	VkSubmitInfo submit = VKInit::SubmitInfo( &m_openBatch.commandBuffer );
+	submit.pNext = &timelineInfo;
+	submit.signalSemaphoreCount = 1;
+	submit.pSignalSemaphores = &m_timelineSemaphore;
+
+	VK_CHECK( vkQueueSubmit( m_queue, 1, &submit, VK_NULL_HANDLE ) );
+
+	m_submittedBatches.push_back( std::move( m_openBatch ) );
+	m_hasOpenBatch = false;
+}
+
+void VulkanUploadQueue::RetireBatches( bool waitForOldest )
+{
+	if ( waitForOldest && !m_submittedBatches.empty() )
+		WaitForValue( m_submittedBatches.front().value );
+
+	const uint64_t completedValue = GetCompletedValue();
+
+	while ( !m_submittedBatches.empty() && m_submittedBatches.front().value <= completedValue )
+	{
+		Batch& batch = m_submittedBatches.front();
+
+		// Everything up to the end of this batch is free again
+		m_ringTail = batch.ringEnd;
+
+		for ( const VulkanBuffer& stagingBuffer : batch.stagingBuffers )
+		{
+			stagingBuffer.Delete();
+		}
+
+		batch.stagingBuffers.clear();
+		VK_CHECK( vkResetCommandPool( m_parent->m_device, batch.commandPool, 0 ) );
+
+		m_freeBatches.push_back( std::move( batch ) );
+		m_submittedBatches.pop_front();
+	}
+}
+
+VulkanUploadTicket VulkanUploadQueue::Upload( const void* data, VkDeviceSize size, RecordFunc record )
+{
+	if ( size == 0 )
+		return {};
+
+	std::lock_guard lock( m_mutex );
+
+	RetireBatches( false );
+
+	if ( size > m_ringSize / 4 )
+	{
+		//
+		// Too big to share the ring with everything else; give it a staging buffer of its own, which gets
+		// deleted once the batch is done with it
+		//
+		if ( !m_hasOpenBatch )
+			OpenBatch();
+
+		BufferInfo_t bufferInfo = {};
+		bufferInfo.name = "Upload Staging Buffer";
+		bufferInfo.size = static_cast<uint32_t>( size );
+		bufferInfo.type = BUFFER_TYPE_STAGING;
+		bufferInfo.usage = BUFFER_USAGE_FLAG_TRANSFER_SRC;
+
+		VulkanBuffer stagingBuffer( m_parent, bufferInfo, VMA_MEMORY_USAGE_AUTO_PREFER_HOST );
+
+		void* mappedData;
+		VK_CHECK( vmaMapMemory( m_parent->m_allocator, stagingBuffer.allocation, &mappedData ) );
+		memcpy( mappedData, data, size );
+		VK_CHECK( vmaFlushAllocation( m_parent->m_allocator, stagingBuffer.allocation, 0, size ) );
+		vmaUnmapMemory( m_parent->m_allocator, stagingBuffer.allocation );
+
+		record( m_openBatch.commandBuffer, stagingBuffer.buffer, 0 );
+
+		m_openBatch.stagingBuffers.push_back( stagingBuffer );
+		m_openBatch.uploadCount++;
+
+		return { m_submittedValue + 1 };
+	}
+
+	VkDeviceSize offset = 0;
+
+	while ( !TryAllocate( size, &offset ) )
+	{
+		// The ring is full of uploads the GPU hasn't got to yet. Send ours off as well (they're taking up
+		// space too), then wait for the oldest to make some room
+		SubmitOpenBatch();
+		RetireBatches( true );
+	}
+
+	if ( !m_hasOpenBatch )
+		OpenBatch();
+
+	memcpy( m_ringData + offset, data, size );
+	VK_CHECK( vmaFlushAllocation( m_parent->m_allocator, m_ringAllocation, offset, size ) );
+
+	record( m_openBatch.commandBuffer, m_ringBuffer, offset );
+	m_openBatch.uploadCount++;
+
+	// The open batch is always the next one to be submitted
+	return { m_submittedValue + 1 };
+}
+
+uint64_t VulkanUploadQueue::Submit()
+{
+	std::lock_guard lock( m_mutex );
+
+	SubmitOpenBatch();
+	RetireBatches( false );
+
+	return m_submittedValue;
+}
+
+bool VulkanUploadQueue::IsComplete( VulkanUploadTicket ticket ) const
+{
+	return ticket.value == 0 || GetCompletedValue() >= ticket.value;
+}
+
+void VulkanUploadQueue::Wait( VulkanUploadTicket ticket )
+{
+	if ( ticket.value == 0 )
+		return;
+
+	{
+		std::lock_guard lock( m_mutex );
+
+		// Still sitting in the open batch
+		if ( ticket.value > m_submittedValue )
+			SubmitOpenBatch();
+	}
+
+	WaitForValue( ticket.value );
+}
+
+void VulkanUploadQueue::Delete() const
+{
+	if ( m_submittedValue > 0 )
+		WaitForValue( m_submittedValue );
+
+	auto deleteBatch = [&]( const Batch& batch ) {
+		for ( const VulkanBuffer& stagingBuffer : batch.stagingBuffers )
+		{
+			stagingBuffer.Delete();
+		}
+
+		// Frees the command buffer too
+		vkDestroyCommandPool( m_parent->m_device, batch.commandPool, nullptr );
+	};
+
+	for ( const Batch& batch : m_submittedBatches )
+	{
+		deleteBatch( batch );
+	}
+
+	for ( const Batch& batch : m_freeBatches )
+	{
+		deleteBatch( batch );
+	}
+
+	if ( m_hasOpenBatch )
+		deleteBatch( m_openBatch );
+
+	vmaDestroyBuffer( m_parent->m_allocator, m_ringBuffer, m_ringAllocation );
+	vkDestroySemaphore( m_parent->m_device, m_timelineSemaphore, nullptr );
+}
+
+// ----------------------------------------------------------------------------------------------------------------------------
+
 VkSamplerCreateInfo VulkanSampler::GetCreateInfo( SamplerType samplerType )
 {
 	if ( samplerType == SAMPLER_TYPE_POINT )
@@ -500,12 +881,23 @@ VulkanBuffer::VulkanBuffer( VulkanRenderContext* parent, BufferInfo_t bufferInfo
 
 	bufferCreateInfo.size = bufferInfo.size;
 	bufferCreateInfo.usage = GetBufferUsageFlags( bufferInfo );
+	m_parent->SetUploadSharingMode( bufferCreateInfo );
 
 	VmaAllocationCreateInfo allocInfo = {};
 	allocInfo.usage = memoryUsage;
-	allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
 
-	VK_CHECK( vmaCreateBuffer( m_parent->m_allocator, &bufferCreateInfo, &allocInfo, &buffer, &allocation, nullptr ) );
+	// The CPU never touches GPU data, so it can go wherever is fastest for the GPU
+	if ( bufferInfo.type != BUFFER_TYPE_GPU_DATA )
+		allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+	if ( bufferInfo.type == BUFFER_TYPE_DYNAMIC_DATA )
+		allocInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	VmaAllocationInfo allocationInfo = {};
+	VK_CHECK( vmaCreateBuffer( m_parent->m_allocator, &bufferCreateInfo, &allocInfo, &buffer, &allocation, &allocationInfo ) );
+
+	if ( bufferInfo.type == BUFFER_TYPE_DYNAMIC_DATA )
+		mappedData = allocationInfo.pMappedData;
 
 	SetDebugName( bufferInfo.name.c_str(), VK_OBJECT_TYPE_BUFFER, ( uint64_t )buffer );
 }
@@ -529,6 +921,12 @@ VkBufferUsageFlags VulkanBuffer::GetBufferUsageFlags( BufferInfo_t bufferInfo )
 	if ( ( bufferInfo.usage & BUFFER_USAGE_FLAG_TRANSFER_DST ) != 0 )
 		outFlags |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 
+	if ( ( bufferInfo.usage & BUFFER_USAGE_FLAG_STORAGE_BUFFER ) != 0 )
+		outFlags |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+	if ( ( bufferInfo.usage & BUFFER_USAGE_FLAG_INDIRECT_BUFFER ) != 0 )
+		outFlags |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
 	if ( bufferInfo.type == BUFFER_TYPE_VERTEX_INDEX_DATA )
 		assert( ( outFlags & VK_BUFFER_USAGE_INDEX_BUFFER_BIT ) != 0 || ( outFlags & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT ) != 0 );
 
@@ -539,45 +937,28 @@ VkBufferUsageFlags VulkanBuffer::GetBufferUsageFlags( BufferInfo_t bufferInfo )
 
 void VulkanBuffer::SetData( BufferUploadInfo_t uploadInfo )
 {
-	struct AllocatedBuffer
+	// Dynamic buffers are host-visible; write straight into them rather than going through a staging
+	// buffer and waiting on a submit
+	if ( mappedData != nullptr )
 	{
-		VkBuffer buffer;
-		VmaAllocation allocation;
-	};
-
-	VkBufferCreateInfo stagingBufferInfo = {};
-	stagingBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	stagingBufferInfo.pNext = nullptr;
-
-	stagingBufferInfo.size = uploadInfo.data.size;
-	stagingBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-
-	VmaAllocationCreateInfo vmaallocInfo = {};
-	AllocatedBuffer stagingBuffer = {};
-
-	vmaallocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-
-	VK_CHECK( vmaCreateBuffer(
-	    m_parent->m_allocator, &stagingBufferInfo, &vmaallocInfo, &stagingBuffer.buffer, &stagingBuffer.allocation, nullptr ) );
+		memcpy( static_cast<uint8_t*>( mappedData ) + uploadInfo.offset, uploadInfo.data.data, uploadInfo.data.size );
+		vmaFlushAllocation( m_parent->m_allocator, allocation, uploadInfo.offset, uploadInfo.data.size );
+		return;
+	}
 
-	void* data;
-	vmaMapMemory( m_parent->m_allocator, stagingBuffer.allocation, &data );
-	memcpy( data, uploadInfo.data.data, uploadInfo.data.size );
-	vmaUnmapMemory( m_parent->m_allocator, stagingBuffer.allocation );
+	const VkDeviceSize size = uploadInfo.data.size;
+	const VkDeviceSize offset = uploadInfo.offset;
 
-	m_parent->ImmediateSubmit( [=]( VkCommandBuffer cmd ) -> RenderStatus {
+	auto recordCopy = [this, size, offset]( VkCommandBuffer cmd, VkBuffer stagingBuffer, VkDeviceSize stagingOffset ) {
 		VkBufferCopy copy = {};
-		copy.dstOffset = 0;
-		copy.srcOffset = 0;
-		copy.size = uploadInfo.data.size;
+		copy.dstOffset = offset;
+		copy.srcOffset = stagingOffset;
+		copy.size = size;
 
-		vkCmdCopyBuffer( cmd, stagingBuffer.buffer, buffer, 1, &copy );
-
-		return RENDER_STATUS_OK;
-	} );
+		vkCmdCopyBuffer( cmd, stagingBuffer, buffer, 1, &copy );
+	};
 
-	// Destroy staging buffer
-	vmaDestroyBuffer( m_parent->m_allocator, stagingBuffer.buffer, stagingBuffer.allocation );
+	uploadTicket = m_parent->m_uploadQueue->Upload( uploadInfo.data.data, size, recordCopy );
 }
 
 void VulkanBuffer::Delete() const
@@ -655,6 +1036,23 @@ void VulkanRenderContext::FinalizeAndCreateDevice( vkb::PhysicalDevice physicalD
 	m_graphicsQueue = vkbDevice.get_queue( vkb::QueueType::graphics ).value();
 	m_graphicsQueueFamily = vkbDevice.get_queue_index( vkb::QueueType::graphics ).value();
 
+	// Uploads go on their own queue if there's one to spare, so that they can run alongside rendering
+	auto transferQueue = vkbDevice.get_dedicated_queue( vkb::QueueType::transfer );
+
+	if ( transferQueue.has_value() )
+	{
+		m_transferQueue = transferQueue.value();
+		m_transferQueueFamily = vkbDevice.get_dedicated_queue_index( vkb::QueueType::transfer ).value();
+	}
+	else
+	{
+		m_transferQueue = m_graphicsQueue;
+		m_transferQueueFamily = m_graphicsQueueFamily;
+	}
+
+	m_uploadQueueFamilies[0] = m_graphicsQueueFamily;
+	m_uploadQueueFamilies[1] = m_transferQueueFamily;
+
 	// Save device properties for later
 	VkPhysicalDeviceProperties deviceProperties = {};
 	vkGetPhysicalDeviceProperties( m_chosenGPU, &m_deviceProperties );
@@ -663,6 +1061,9 @@ void VulkanRenderContext::FinalizeAndCreateDevice( vkb::PhysicalDevice physicalD
 	SetDebugName( "Main Physical Device", VK_OBJECT_TYPE_PHYSICAL_DEVICE, ( uint64_t )m_chosenGPU );
 
 	SetDebugName( "Graphics Queue", VK_OBJECT_TYPE_QUEUE, ( uint64_t )m_graphicsQueue );
+
+	if ( m_transferQueue != m_graphicsQueue )
+		SetDebugName( "Transfer Queue", VK_OBJECT_TYPE_QUEUE, ( uint64_t )m_transferQueue );
 }
 
 vkb::PhysicalDevice VulkanRenderContext::CreatePhysicalDevice( vkb::Instance vkbInstance )
@@ -693,6 +1094,13 @@ vkb::PhysicalDevice VulkanRenderContext::CreatePhysicalDevice( vkb::Instance vkb
 	//
 	VkPhysicalDeviceFeatures requiredFeatures = {};
 	requiredFeatures.samplerAnisotropy = VK_TRUE;
+
+	// GPU-driven drawing puts many draws in each indirect call
+	m_isGpuDriven = EngineProperties::GpuDriven;
+
+	if ( m_isGpuDriven )
+		requiredFeatures.multiDrawIndirect = VK_TRUE;
+
 	selector = selector.set_required_features( requiredFeatures );
 
 	//
@@ -711,6 +1119,23 @@ vkb::PhysicalDevice VulkanRenderContext::CreatePhysicalDevice( vkb::Instance vkb
 	requiredFeatures12.pNext = nullptr;
 	requiredFeatures12.descriptorIndexing = VK_TRUE;
 	requiredFeatures12.bufferDeviceAddress = VK_TRUE;
+	requiredFeatures12.timelineSemaphore = VK_TRUE;
+
+	// Vulkan 1.3 guarantees all of these, since it requires descriptorIndexing; they just need turning on
+	m_isBindless = EngineProperties::Bindless;
+
+	if ( m_isBindless )
+	{
+		requiredFeatures12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+		requiredFeatures12.runtimeDescriptorArray = VK_TRUE;
+		requiredFeatures12.descriptorBindingPartiallyBound = VK_TRUE;
+		requiredFeatures12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		requiredFeatures12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	}
+
+	if ( m_isGpuDriven )
+		requiredFeatures12.drawIndirectCount = VK_TRUE;
+
 	selector = selector.set_required_features_12( requiredFeatures12 );
 
 	//
@@ -746,6 +1171,7 @@ void VulkanRenderContext::CreateSwapchain()
 	m_swapchain = VulkanSwapchain( this, size );
 
 	m_window->m_onWindowResized = [&]( Size2D newSize ) {
+		WaitForFrames();
 		m_swapchain.Update( newSize );
 		CreateRenderTargets();
 		Globals::m_hostManager->FireEvent( "Event.Window.Resized" );
@@ -754,7 +1180,20 @@ void VulkanRenderContext::CreateSwapchain()
 
 void VulkanRenderContext::CreateCommands()
 {
-	m_mainContext = VulkanCommandContext( this );
+	// ImGui keeps one set of buffers per swapchain image, so we can't have more frames in flight than that
+	const int maxFrames = static_cast<int>( m_swapchain.m_swapchainTextures.size() );
+	const int frameCount = std::clamp( renderFramesInFlight.GetValue(), 1, maxFrames );
+
+	if ( frameCount != renderFramesInFlight.GetValue() )
+		spdlog::warn( "render.frames_in_flight must be between 1 and {}, using {}", maxFrames, frameCount );
+
+	m_frames.resize( frameCount );
+	m_frameIndex = 0;
+
+	for ( VulkanFrameContext& frame : m_frames )
+	{
+		frame.commandContext = VulkanCommandContext( this );
+	}
 }
 
 void VulkanRenderContext::CreateSyncStructures()
@@ -764,10 +1203,18 @@ void VulkanRenderContext::CreateSyncStructures()
 	semaphoreCreateInfo.pNext = nullptr;
 	semaphoreCreateInfo.flags = 0;
 
-	VK_CHECK( vkCreateSemaphore( m_device, &semaphoreCreateInfo, nullptr, &m_presentSemaphore ) );
-	VK_CHECK( vkCreateSemaphore( m_device, &semaphoreCreateInfo, nullptr, &m_renderSemaphore ) );
+	for ( VulkanFrameContext& frame : m_frames )
+	{
+		VK_CHECK( vkCreateSemaphore( m_device, &semaphoreCreateInfo, nullptr, &frame.presentSemaphore ) );
+		VK_CHECK( vkCreateSemaphore( m_device, &semaphoreCreateInfo, nullptr, &frame.renderSemaphore ) );
+	}
+
+	// Fences are handled by VulkanCommandContexts. Each frame's fence is frame.commandContext.fence.
+}
 
-	// Fences are handled by VulkanCommandContexts. Our main fence is m_mainContext.fence.
+void VulkanRenderContext::CreateUploadQueue()
+{
+	m_uploadQueue = std::make_unique<VulkanUploadQueue>( this, m_transferQueue, m_transferQueueFamily, UPLOAD_RING_SIZE );
 }
 
 void VulkanRenderContext::CreateDescriptors()
@@ -789,49 +1236,429 @@ void VulkanRenderContext::CreateDescriptors()
 	VK_CHECK( vkCreateDescriptorPool( m_device, &poolInfo, nullptr, &m_descriptorPool ) );
 }
 
-void VulkanRenderContext::CreateRenderTargets()
+void VulkanRenderContext::CreateFrameConstants()
 {
-	// Are we re-creating render targets? If so, queue the originals for deletion
-	if ( m_colorTarget.image != VK_NULL_HANDLE )
-	{
-		// Make copies of m_colorTarget and m_depthTarget
-		VulkanRenderTexture colorTarget( m_colorTarget );
-		VulkanRenderTexture depthTarget( m_depthTarget );
+	// The constants themselves, then the light list
+	VkDescriptorSetLayoutBinding bindings[4] = {};
 
-		m_frameDeletionQueue.Enqueue( [colorTarget, depthTarget]() {
-			// Delete copied render targets
-			colorTarget.Delete();
-			depthTarget.Delete();
-		} );
+	for ( uint32_t i = 0; i < 4; ++i )
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT;
 	}
 
-	Size2D size = m_window->GetWindowSize();
+	VkDescriptorSetLayoutCreateInfo layoutInfo = VKInit::DescriptorSetLayoutCreateInfo( bindings, 4 );
+	VK_CHECK( vkCreateDescriptorSetLayout( m_device, &layoutInfo, nullptr, &m_frameConstantsSetLayout ) );
 
-	//
-	// Create render targets
-	//
-	RenderTextureInfo_t renderTextureInfo;
-	renderTextureInfo.name = "Main render target";
-	renderTextureInfo.width = size.x * renderScale;
-	renderTextureInfo.height = size.y * renderScale;
+	VkDescriptorSetLayoutCreateInfo emptyLayoutInfo = VKInit::DescriptorSetLayoutCreateInfo( nullptr, 0 );
+	VK_CHECK( vkCreateDescriptorSetLayout( m_device, &emptyLayoutInfo, nullptr, &m_emptySetLayout ) );
 
-	// BUG: Resizing the window after setting render scale to something high will cause
-	// an engine crash.. even though we're limiting sizes?
+	// Each frame in flight gets its own buffer, so that writing this frame's constants can't stomp on
+	// the ones the GPU is still reading for the last one
+	for ( VulkanFrameContext& frame : m_frames )
+	{
+		BufferInfo_t bufferInfo = {};
+		bufferInfo.name = "Frame constants";
+		bufferInfo.size = sizeof( RenderFrameConstants );
+		bufferInfo.type = BUFFER_TYPE_DYNAMIC_DATA;
+		bufferInfo.usage = BUFFER_USAGE_FLAG_UNIFORM_BUFFER;
 
-	//
-	// Limit size to something sensible
-	// TODO: Query device support?
-	//
-	const float maxSize = 8192.0f;
-	const float aspect = ( float )size.x / ( float )size.y;
+		frame.frameConstantsBuffer = std::make_shared<VulkanBuffer>( this, bufferInfo, VMA_MEMORY_USAGE_AUTO_PREFER_HOST );
 
-	if ( renderTextureInfo.width > maxSize || renderTextureInfo.height > maxSize )
-	{
-		renderTextureInfo.width = maxSize;
-		renderTextureInfo.height = maxSize / aspect;
+		// Every binding needs something behind it, even before the first SetLightData
+		bufferInfo.usage = BUFFER_USAGE_FLAG_STORAGE_BUFFER;
 
-		spdlog::warn( "Render target size is too large. Clamping to {}x{}", renderTextureInfo.width, renderTextureInfo.height );
-	}
+		bufferInfo.name = "Lights";
+		ReserveFrameBuffer( frame.lightBuffer, frame.lightCapacity, sizeof( RenderLight ), bufferInfo,
+		    VMA_MEMORY_USAGE_AUTO_PREFER_HOST );
+
+		bufferInfo.name = "Light clusters";
+		ReserveFrameBuffer( frame.lightClusterBuffer, frame.lightClusterCapacity, sizeof( RenderLightCluster ), bufferInfo,
+		    VMA_MEMORY_USAGE_AUTO_PREFER_HOST );
+
+		bufferInfo.name = "Light indices";
+		ReserveFrameBuffer( frame.lightIndexBuffer, frame.lightIndexCapacity, sizeof( uint32_t ), bufferInfo,
+		    VMA_MEMORY_USAGE_AUTO_PREFER_HOST );
+
+		VkDescriptorSetAllocateInfo allocInfo =
+		    VKInit::DescriptorSetAllocateInfo( m_descriptorPool, &m_frameConstantsSetLayout, 1 );
+		VK_CHECK( vkAllocateDescriptorSets( m_device, &allocInfo, &frame.frameConstantsSet ) );
+
+		SetDebugName( "Frame constants", VK_OBJECT_TYPE_DESCRIPTOR_SET, ( uint64_t )frame.frameConstantsSet );
+
+		WriteFrameConstantsSet( frame );
+
+		// Start off with something sensible in there, in case anything gets drawn before the first
+		// SetFrameConstants. No lights, so the light buffers are never read
+		RenderFrameConstants constants = {};
+		memcpy( frame.frameConstantsBuffer->mappedData, &constants, sizeof( constants ) );
+	}
+}
+
+void VulkanRenderContext::WriteFrameConstantsSet( VulkanFrameContext& frame )
+{
+	VkBuffer buffers[4] = { frame.frameConstantsBuffer->buffer, frame.lightBuffer->buffer, frame.lightClusterBuffer->buffer,
+		frame.lightIndexBuffer->buffer };
+
+	VkDescriptorBufferInfo bufferInfos[4] = {};
+	VkWriteDescriptorSet writes[4] = {};
+
+	for ( uint32_t i = 0; i < 4; ++i )
+	{
+		bufferInfos[i].buffer = buffers[i];
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = i == 0 ? sizeof( RenderFrameConstants ) : VK_WHOLE_SIZE;
+
+		VkDescriptorType type = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i] = VKInit::WriteDescriptorBuffer( type, frame.frameConstantsSet, &bufferInfos[i], i );
+	}
+
+	vkUpdateDescriptorSets( m_device, 4, writes, 0, nullptr );
+}
+
+void VulkanRenderContext::CreateBindlessTextures()
+{
+	if ( !m_isBindless )
+		return;
+
+	//
+	// Combined image samplers count against both the sampler and the sampled image limits
+	//
+	VkPhysicalDeviceVulkan12Properties properties12 = {};
+	properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &properties12;
+	vkGetPhysicalDeviceProperties2( m_chosenGPU, &properties );
+
+	m_bindlessTextureCapacity = std::min( { MAX_BINDLESS_TEXTURES, properties12.maxDescriptorSetUpdateAfterBindSamplers,
+	    properties12.maxDescriptorSetUpdateAfterBindSampledImages, properties12.maxPerStageDescriptorUpdateAfterBindSamplers,
+	    properties12.maxPerStageDescriptorUpdateAfterBindSampledImages } );
+
+	//
+	// Partially bound, so that only the slots that are in use need to be valid; update-after-bind, so
+	// that textures can be added without waiting for the frames that are using the set
+	//
+	VkDescriptorSetLayoutBinding binding = {};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = m_bindlessTextureCapacity;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+	                                        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+	                                        VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = 1;
+	bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = VKInit::DescriptorSetLayoutCreateInfo( &binding, 1 );
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	VK_CHECK( vkCreateDescriptorSetLayout( m_device, &layoutInfo, nullptr, &m_bindlessSetLayout ) );
+
+	// Update-after-bind sets need a pool of their own
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_bindlessTextureCapacity };
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.pNext = nullptr;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	VK_CHECK( vkCreateDescriptorPool( m_device, &poolInfo, nullptr, &m_bindlessPool ) );
+
+	VkDescriptorSetAllocateInfo allocInfo = VKInit::DescriptorSetAllocateInfo( m_bindlessPool, &m_bindlessSetLayout, 1 );
+	VK_CHECK( vkAllocateDescriptorSets( m_device, &allocInfo, &m_bindlessSet ) );
+
+	SetDebugName( "Bindless textures", VK_OBJECT_TYPE_DESCRIPTOR_SET, ( uint64_t )m_bindlessSet );
+
+	spdlog::info( "Bindless textures enabled, with room for {}", m_bindlessTextureCapacity );
+}
+
+void VulkanRenderContext::CreateGpuCulling()
+{
+	if ( !m_isGpuDriven )
+		return;
+
+	//
+	// Both passes share one layout: six storage buffers, and the frustum in push constants
+	//
+	VkDescriptorSetLayoutBinding bindings[6] = {};
+
+	for ( uint32_t i = 0; i < 6; ++i )
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = VKInit::DescriptorSetLayoutCreateInfo( bindings, 6 );
+	VK_CHECK( vkCreateDescriptorSetLayout( m_device, &layoutInfo, nullptr, &m_cullSetLayout ) );
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof( VulkanCullConstants );
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = VKInit::PipelineLayoutCreateInfo();
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_cullSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	VK_CHECK( vkCreatePipelineLayout( m_device, &pipelineLayoutInfo, nullptr, &m_cullPipelineLayout ) );
+
+	//
+	// Compile both compute shaders
+	//
+	std::vector<ShaderCompileRequest> shaderRequests( 2 );
+	shaderRequests[0].type = SHADER_TYPE_COMPUTE;
+	shaderRequests[0].source = g_cullInstancesShader;
+	shaderRequests[1].type = SHADER_TYPE_COMPUTE;
+	shaderRequests[1].source = g_buildIndirectDrawsShader;
+
+	ShaderCompiler::Instance().CompileBatch( shaderRequests );
+
+	if ( !shaderRequests[0].succeeded )
+	{
+		ErrorMessage( "GPU culling shader failed to compile." );
+		abort();
+	}
+
+	if ( !shaderRequests[1].succeeded )
+	{
+		ErrorMessage( "Indirect draw building shader failed to compile." );
+		abort();
+	}
+
+	auto createPipeline = [&]( const std::vector<uint32_t>& spirv, const char* name, VkPipeline* outPipeline ) {
+		VkShaderModuleCreateInfo moduleInfo = {};
+		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleInfo.codeSize = spirv.size() * sizeof( uint32_t );
+		moduleInfo.pCode = spirv.data();
+
+		VkShaderModule shaderModule;
+		VK_CHECK( vkCreateShaderModule( m_device, &moduleInfo, nullptr, &shaderModule ) );
+
+		VkComputePipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage = VKInit::PipelineShaderStageCreateInfo( VK_SHADER_STAGE_COMPUTE_BIT, shaderModule );
+		pipelineInfo.layout = m_cullPipelineLayout;
+		VK_CHECK( vkCreateComputePipelines( m_device, m_pipelineCache, 1, &pipelineInfo, nullptr, outPipeline ) );
+
+		SetDebugName( name, VK_OBJECT_TYPE_PIPELINE, ( uint64_t )*outPipeline );
+
+		// The pipeline keeps everything it needs from the module
+		vkDestroyShaderModule( m_device, shaderModule, nullptr );
+	};
+
+	createPipeline( shaderRequests[0].spirv, "Cull instances", &m_cullInstancesPipeline );
+	createPipeline( shaderRequests[1].spirv, "Build indirect draws", &m_buildIndirectDrawsPipeline );
+
+	// The buffers behind each set can be replaced as they grow, so they're written by CullIndirectDraws
+	for ( VulkanFrameContext& frame : m_frames )
+	{
+		VkDescriptorSetAllocateInfo allocInfo = VKInit::DescriptorSetAllocateInfo( m_descriptorPool, &m_cullSetLayout, 1 );
+		VK_CHECK( vkAllocateDescriptorSets( m_device, &allocInfo, &frame.cullSet ) );
+
+		SetDebugName( "GPU culling", VK_OBJECT_TYPE_DESCRIPTOR_SET, ( uint64_t )frame.cullSet );
+	}
+
+	spdlog::info( "GPU-driven rendering enabled" );
+}
+
+void VulkanRenderContext::CreatePipelineCache()
+{
+	std::vector<uint8_t> cacheData;
+	std::ifstream file( PIPELINE_CACHE_PATH, std::ios::binary );
+
+	if ( file.good() )
+	{
+		PipelineCacheHeader header = {};
+		file.read( reinterpret_cast<char*>( &header ), sizeof( header ) );
+
+		// Anything from a different GPU or driver is useless; start from scratch and overwrite it on shutdown
+		const bool isValid = file.good() && header.magic == PIPELINE_CACHE_MAGIC && header.version == PIPELINE_CACHE_VERSION &&
+		                     header.vendorID == m_deviceProperties.vendorID && header.deviceID == m_deviceProperties.deviceID &&
+		                     memcmp( header.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE ) == 0;
+
+		if ( isValid )
+		{
+			cacheData.resize( header.dataSize );
+			file.read( reinterpret_cast<char*>( cacheData.data() ), cacheData.size() );
+
+			if ( !file.good() )
+			{
+				spdlog::warn( "Ignoring broken pipeline cache file {}", PIPELINE_CACHE_PATH.string() );
+				cacheData.clear();
+			}
+		}
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.pNext = nullptr;
+	cacheInfo.initialDataSize = cacheData.size();
+	cacheInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+	VK_CHECK( vkCreatePipelineCache( m_device, &cacheInfo, nullptr, &m_pipelineCache ) );
+	SetDebugName( "Pipeline Cache", VK_OBJECT_TYPE_PIPELINE_CACHE, ( uint64_t )m_pipelineCache );
+
+	spdlog::info( "Loaded {} bytes of pipeline cache", cacheData.size() );
+}
+
+void VulkanRenderContext::SavePipelineCache()
+{
+	size_t dataSize = 0;
+	VK_CHECK( vkGetPipelineCacheData( m_device, m_pipelineCache, &dataSize, nullptr ) );
+
+	std::vector<uint8_t> cacheData( dataSize );
+	VK_CHECK( vkGetPipelineCacheData( m_device, m_pipelineCache, &dataSize, cacheData.data() ) );
+
+	std::error_code error;
+	std::filesystem::create_directories( PIPELINE_CACHE_PATH.parent_path(), error );
+
+	if ( error )
+	{
+		spdlog::warn( "Couldn't create pipeline cache directory: {}", error.message() );
+		return;
+	}
+
+	// Write to a temporary file first so that a crash part-way through can't leave a broken file behind
+	std::filesystem::path tempPath = PIPELINE_CACHE_PATH;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream file( tempPath, std::ios::binary | std::ios::trunc );
+
+		if ( !file.good() )
+			return;
+
+		PipelineCacheHeader header = {};
+		header.magic = PIPELINE_CACHE_MAGIC;
+		header.version = PIPELINE_CACHE_VERSION;
+		header.vendorID = m_deviceProperties.vendorID;
+		header.deviceID = m_deviceProperties.deviceID;
+		memcpy( header.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE );
+		header.dataSize = dataSize;
+
+		file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+		file.write( reinterpret_cast<const char*>( cacheData.data() ), dataSize );
+
+		if ( !file.good() )
+		{
+			spdlog::warn( "Couldn't write pipeline cache file {}", tempPath.string() );
+			return;
+		}
+	}
+
+	std::filesystem::rename( tempPath, PIPELINE_CACHE_PATH, error );
+}
+
+std::string VulkanRenderContext::GetPipelineKey( const PipelineInfo_t& pipelineInfo )
+{
+	// The raw bytes of everything that ends up in the pipeline. The name doesn't, so materials that only
+	// differ by name get the same one
+	std::string key;
+
+	auto appendBytes = [&key]( const void* data, size_t size ) { key.append( static_cast<const char*>( data ), size ); };
+
+	auto appendValue = [&appendBytes]( auto value ) { appendBytes( &value, sizeof( value ) ); };
+
+	const std::vector<uint32_t>& vertexShaderData = pipelineInfo.shaderInfo.vertexShaderData;
+	const std::vector<uint32_t>& fragmentShaderData = pipelineInfo.shaderInfo.fragmentShaderData;
+
+	// The shaders are nearly all of it
+	key.reserve( ( vertexShaderData.size() + fragmentShaderData.size() ) * sizeof( uint32_t ) + 256 );
+
+	appendValue( vertexShaderData.size() );
+	appendBytes( vertexShaderData.data(), vertexShaderData.size() * sizeof( uint32_t ) );
+	appendValue( fragmentShaderData.size() );
+	appendBytes( fragmentShaderData.data(), fragmentShaderData.size() * sizeof( uint32_t ) );
+
+	appendValue( pipelineInfo.vertexAttributes.size() );
+
+	for ( const VertexAttributeInfo_t& attribute : pipelineInfo.vertexAttributes )
+	{
+		appendValue( attribute.format );
+	}
+
+	appendValue( pipelineInfo.ignoreDepth );
+	appendValue( pipelineInfo.renderToSwapchain );
+
+	// Descriptor set layouts that are defined the same way are compatible, so only what's in them matters,
+	// not which VkDescriptorSetLayout the pipeline layout gets built from
+	appendValue( pipelineInfo.descriptors.size() );
+
+	for ( Descriptor* descriptor : pipelineInfo.descriptors )
+	{
+		std::shared_ptr<VulkanDescriptor> vkDescriptor = m_descriptors.Get( descriptor->m_handle );
+
+		appendValue( vkDescriptor->bindingTypes.size() );
+
+		for ( VkDescriptorType type : vkDescriptor->bindingTypes )
+		{
+			appendValue( type );
+		}
+	}
+
+	return key;
+}
+
+void VulkanRenderContext::CreateRenderTargets()
+{
+	// Are we re-creating render targets? If so, queue the originals for deletion
+	if ( m_colorTarget.image != VK_NULL_HANDLE )
+	{
+		// Frames in flight still render into the old targets, and the fullscreen triangle's descriptor
+		// can't be re-pointed while they're using it. This only happens on resize, so just wait them out
+		WaitForFrames();
+
+		// Make copies of m_colorTarget and m_depthTarget
+		VulkanRenderTexture colorTarget( m_colorTarget );
+		VulkanRenderTexture depthTarget( m_depthTarget );
+
+		GetFrameDeletionQueue().Enqueue( [colorTarget, depthTarget]() {
+			// Delete copied render targets
+			colorTarget.Delete();
+			depthTarget.Delete();
+		} );
+	}
+
+	Size2D size = m_window->GetWindowSize();
+
+	//
+	// Create render targets
+	//
+	RenderTextureInfo_t renderTextureInfo;
+	renderTextureInfo.name = "Main render target";
+	renderTextureInfo.width = size.x * renderScale;
+	renderTextureInfo.height = size.y * renderScale;
+
+	// BUG: Resizing the window after setting render scale to something high will cause
+	// an engine crash.. even though we're limiting sizes?
+
+	//
+	// Limit size to something sensible
+	// TODO: Query device support?
+	//
+	const float maxSize = 8192.0f;
+	const float aspect = ( float )size.x / ( float )size.y;
+
+	if ( renderTextureInfo.width > maxSize || renderTextureInfo.height > maxSize )
+	{
+		renderTextureInfo.width = maxSize;
+		renderTextureInfo.height = maxSize / aspect;
+
+		spdlog::warn( "Render target size is too large. Clamping to {}x{}", renderTextureInfo.width, renderTextureInfo.height );
+	}
 
 	renderTextureInfo.type = RENDER_TEXTURE_DEPTH;
 	m_depthTarget = VulkanRenderTexture( this, renderTextureInfo );
@@ -920,6 +1747,7 @@ void VulkanRenderContext::CreateImGui()
 	init_info.Device = m_device;
 	init_info.Queue = m_graphicsQueue;
 	init_info.DescriptorPool = imguiPool;
+	init_info.PipelineCache = m_pipelineCache;
 	init_info.MinImageCount = 2;
 	init_info.ImageCount = m_swapchain.m_swapchainTextures.size();
 	init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
@@ -1135,32 +1963,29 @@ void VulkanRenderContext::CreateFullScreenTri()
 	pipelineInfo.shaderInfo = {};
 
 	// Compile fragment & vertex shaders
-	std::vector<unsigned int> vertexShaderBits;
-	std::vector<unsigned int> fragmentShaderBits;
+	std::vector<ShaderCompileRequest> shaderRequests( 2 );
+	shaderRequests[0].type = SHADER_TYPE_VERTEX;
+	shaderRequests[0].source = g_fullScreenTriVertexShader;
+	shaderRequests[1].type = SHADER_TYPE_FRAGMENT;
+	shaderRequests[1].source = g_fullScreenTriFragmentShader;
 
-	// Vertex
-	{
-		if ( !ShaderCompiler::Instance().Compile( SHADER_TYPE_VERTEX, g_fullScreenTriVertexShader.c_str(), vertexShaderBits ) )
-		{
-			ErrorMessage( "Fullscreen triangle vertex shader failed to compile." );
-			abort();
-		}
+	ShaderCompiler::Instance().CompileBatch( shaderRequests );
 
-		pipelineInfo.shaderInfo.vertexShaderData = vertexShaderBits;
+	if ( !shaderRequests[0].succeeded )
+	{
+		ErrorMessage( "Fullscreen triangle vertex shader failed to compile." );
+		abort();
 	}
 
-	// Fragment
+	if ( !shaderRequests[1].succeeded )
 	{
-		if ( !ShaderCompiler::Instance().Compile(
-		         SHADER_TYPE_FRAGMENT, g_fullScreenTriFragmentShader.c_str(), fragmentShaderBits ) )
-		{
-			ErrorMessage( "Fullscreen triangle fragment shader failed to compile." );
-			abort();
-		}
-
-		pipelineInfo.shaderInfo.fragmentShaderData = fragmentShaderBits;
+		ErrorMessage( "Fullscreen triangle fragment shader failed to compile." );
+		abort();
 	}
 
+	pipelineInfo.shaderInfo.vertexShaderData = shaderRequests[0].spirv;
+	pipelineInfo.shaderInfo.fragmentShaderData = shaderRequests[1].spirv;
+
 	m_fullScreenTri.pipeline = Pipeline( pipelineInfo );
 }
 
@@ -1203,7 +2028,12 @@ RenderStatus VulkanRenderContext::Startup()
 		CreateSwapchain();
 		CreateCommands();
 		CreateSyncStructures();
+		CreateUploadQueue();
 		CreateDescriptors();
+		CreatePipelineCache();
+		CreateFrameConstants();
+		CreateBindlessTextures();
+		CreateGpuCulling();
 		CreateImGui();
 		CreateRenderTargets();
 		CreateFullScreenTri();
@@ -1216,6 +2046,14 @@ RenderStatus VulkanRenderContext::Shutdown()
 {
 	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
 
+	// Every frame context could still be in flight, along with uploads; nothing below is safe to
+	// destroy until the GPU is done with all of it
+	VK_CHECK( vkDeviceWaitIdle( m_device ) );
+
+	// Deferred deletions can check upload tickets, so these go before the upload queue does
+	for ( VulkanFrameContext& frame : m_frames )
+		frame.deletionQueue.Flush();
+
 	//
 	// Delete everything
 	//
@@ -1224,20 +2062,70 @@ RenderStatus VulkanRenderContext::Shutdown()
 	ImGui::DestroyContext();
 
 	// Delete command contexts
-	m_mainContext.Delete();
+	for ( VulkanFrameContext& frame : m_frames )
+	{
+		frame.commandContext.Delete();
+
+		for ( VulkanSecondaryCommandPool& pool : frame.secondaryPools )
+			vkDestroyCommandPool( m_device, pool.commandPool, nullptr );
+	}
+
 	for ( auto& context : m_uploadContexts )
 	{
 		context.second->Delete();
 	}
 
+	m_uploadQueue->Delete();
+
 	// Delete allocated objects
 	// Must be done in a specific order
-	m_pipelines.ForEach( []( std::shared_ptr<VulkanPipeline> pipeline ) { pipeline->Delete(); } );
-	m_descriptors.ForEach( []( std::shared_ptr<VulkanDescriptor> descriptor ) { descriptor->Delete(); } );
-	m_shaders.ForEach( []( std::shared_ptr<VulkanShader> shader ) { shader->Delete(); } );
-	m_buffers.ForEach( []( std::shared_ptr<VulkanBuffer> buffer ) { buffer->Delete(); } );
-	m_imageTextures.ForEach( []( std::shared_ptr<VulkanImageTexture> imageTexture ) { imageTexture->Delete(); } );
-	m_renderTextures.ForEach( []( std::shared_ptr<VulkanRenderTexture> renderTexture ) { renderTexture->Delete(); } );
+	SavePipelineCache();
+	m_pipelines.ForEach( []( const std::shared_ptr<VulkanPipeline>& pipeline ) { pipeline->Delete(); } );
+	vkDestroyPipelineCache( m_device, m_pipelineCache, nullptr );
+	m_descriptors.ForEach( []( const std::shared_ptr<VulkanDescriptor>& descriptor ) { descriptor->Delete(); } );
+	m_shaders.ForEach( []( const std::shared_ptr<VulkanShader>& shader ) { shader->Delete(); } );
+	m_buffers.ForEach( []( const std::shared_ptr<VulkanBuffer>& buffer ) { buffer->Delete(); } );
+
+	for ( VulkanFrameContext& frame : m_frames )
+	{
+		if ( frame.instanceBuffer != nullptr )
+			frame.instanceBuffer->Delete();
+
+		frame.frameConstantsBuffer->Delete();
+		frame.lightBuffer->Delete();
+		frame.lightClusterBuffer->Delete();
+		frame.lightIndexBuffer->Delete();
+	}
+
+	vkDestroyDescriptorSetLayout( m_device, m_frameConstantsSetLayout, nullptr );
+	vkDestroyDescriptorSetLayout( m_device, m_emptySetLayout, nullptr );
+
+	if ( m_isBindless )
+	{
+		vkDestroyDescriptorPool( m_device, m_bindlessPool, nullptr );
+		vkDestroyDescriptorSetLayout( m_device, m_bindlessSetLayout, nullptr );
+	}
+
+	if ( m_isGpuDriven )
+	{
+		for ( VulkanFrameContext& frame : m_frames )
+		{
+			for ( auto buffer : { frame.indirectDrawBuffer, frame.instanceDrawBuffer, frame.drawCountBuffer,
+			          frame.drawCommandBuffer, frame.culledInstanceBuffer } )
+			{
+				if ( buffer != nullptr )
+					buffer->Delete();
+			}
+		}
+
+		vkDestroyPipeline( m_device, m_cullInstancesPipeline, nullptr );
+		vkDestroyPipeline( m_device, m_buildIndirectDrawsPipeline, nullptr );
+		vkDestroyPipelineLayout( m_device, m_cullPipelineLayout, nullptr );
+		vkDestroyDescriptorSetLayout( m_device, m_cullSetLayout, nullptr );
+	}
+
+	m_imageTextures.ForEach( []( const std::shared_ptr<VulkanImageTexture>& imageTexture ) { imageTexture->Delete(); } );
+	m_renderTextures.ForEach( []( const std::shared_ptr<VulkanRenderTexture>& renderTexture ) { renderTexture->Delete(); } );
 
 	m_depthTarget.Delete();
 	m_colorTarget.Delete();
@@ -1248,8 +2136,12 @@ RenderStatus VulkanRenderContext::Shutdown()
 	// Delete raw vulkan objects (eg. device, instance, descriptor pool, semaphores, debugm essenger)
 	// Must also be done in a specific order
 	vkDestroyDebugUtilsMessengerEXT( m_instance, m_debugMessenger, nullptr );
-	vkDestroySemaphore( m_device, m_presentSemaphore, nullptr );
-	vkDestroySemaphore( m_device, m_renderSemaphore, nullptr );
+
+	for ( VulkanFrameContext& frame : m_frames )
+	{
+		vkDestroySemaphore( m_device, frame.presentSemaphore, nullptr );
+		vkDestroySemaphore( m_device, frame.renderSemaphore, nullptr );
+	}
 
 	vkDestroyDescriptorPool( m_device, m_descriptorPool, nullptr );
 
@@ -1277,9 +2169,37 @@ inline bool VulkanRenderContext::CanRender()
 	return true;
 }
 
+VkCommandBuffer VulkanRenderContext::GetCommandBuffer()
+{
+	if ( t_recordingState != nullptr )
+		return t_recordingState->commandBuffer;
+
+	return m_frames[m_frameIndex].commandContext.commandBuffer;
+}
+
+std::shared_ptr<VulkanPipeline>& VulkanRenderContext::GetBoundPipeline()
+{
+	if ( t_recordingState != nullptr )
+		return t_recordingState->pipeline;
+
+	return m_pipeline;
+}
+
+void VulkanRenderContext::WaitForFrames()
+{
+	for ( uint32_t i = 0; i < m_frames.size(); ++i )
+	{
+		// The frame we're recording hasn't been submitted yet, so its fence will never signal
+		if ( m_renderingActive && i == m_frameIndex )
+			continue;
+
+		VK_CHECK( vkWaitForFences( m_device, 1, &m_frames[i].commandContext.fence, true, 1000000000 ) );
+	}
+}
+
 void VulkanRenderContext::RenderImGui()
 {
-	VkCommandBuffer cmd = m_mainContext.commandBuffer;
+	VkCommandBuffer cmd = GetCommandBuffer();
 
 	if ( m_isRenderPassActive )
 	{
@@ -1325,16 +2245,33 @@ RenderStatus VulkanRenderContext::BeginRendering()
 		return RENDER_STATUS_WINDOW_SIZE_INVALID;
 	}
 
+	//
+	// Move on to the next frame. The GPU could still be working on the others, but this one was
+	// submitted m_frames.size() frames ago and should be done (or close to it) by now
+	//
+	m_frameIndex = ( m_frameIndex + 1 ) % m_frames.size();
+	VulkanFrameContext& frame = GetCurrentFrame();
+
 	// Wait until we can render ( 1 second timeout )
-	VK_CHECK( vkWaitForFences( m_device, 1, &m_mainContext.fence, true, 1000000000 ) );
-	VK_CHECK( vkResetFences( m_device, 1, &m_mainContext.fence ) );
+	VK_CHECK( vkWaitForFences( m_device, 1, &frame.commandContext.fence, true, 1000000000 ) );
+	VK_CHECK( vkResetFences( m_device, 1, &frame.commandContext.fence ) );
+
+	// Nothing from this frame's last go around is in use any more
+	frame.deletionQueue.Flush();
+
+	for ( VulkanSecondaryCommandPool& pool : frame.secondaryPools )
+	{
+		VK_CHECK( vkResetCommandPool( m_device, pool.commandPool, 0 ) );
+		pool.usedCount = 0;
+	}
 
 	// Acquire swapchain image ( 1 second timeout )
-	m_swapchainImageIndex = m_swapchain.AcquireSwapchainImageIndex( m_device, m_presentSemaphore, m_mainContext );
+	m_swapchainImageIndex =
+	    m_swapchain.AcquireSwapchainImageIndex( m_device, frame.presentSemaphore, frame.commandContext );
 	m_swapchainTarget = m_swapchain.m_swapchainTextures[m_swapchainImageIndex];
 
 	// Begin command buffer
-	VkCommandBuffer cmd = m_mainContext.commandBuffer;
+	VkCommandBuffer cmd = frame.commandContext.commandBuffer;
 	VkCommandBufferBeginInfo cmdBeginInfo = VKInit::CommandBufferBeginInfo( VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT );
 	VK_CHECK( vkBeginCommandBuffer( cmd, &cmdBeginInfo ) );
 
@@ -1361,6 +2298,23 @@ RenderStatus VulkanRenderContext::BeginRendering()
 	vkCmdPipelineBarrier( cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0,
 	    nullptr, 0, nullptr, 1, &writeToColorTargetBarrier );
 
+	//
+	// The depth target is shared between every frame context, so the previous frame could still be
+	// testing against it. We clear it anyway, so its old contents (and layout) can be thrown away.
+	//
+	VkImageMemoryBarrier writeToDepthTargetBarrier = VKInit::ImageMemoryBarrier( VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+	    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, m_depthTarget.image );
+	writeToDepthTargetBarrier.dstAccessMask =
+	    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	// The target has a stencil aspect too, and it's bound as the stencil attachment as well, so both
+	// aspects have to move together
+	writeToDepthTargetBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+
+	vkCmdPipelineBarrier( cmd, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+	    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0, 0, nullptr, 0, nullptr, 1,
+	    &writeToDepthTargetBarrier );
+
 	VkClearValue colorClear = { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
 	VkClearValue depthClear = {};
 	depthClear.depthStencil.depth = 1.0f;
@@ -1376,7 +2330,11 @@ RenderStatus VulkanRenderContext::BeginRendering()
 	VkRenderingInfo renderInfo = VKInit::RenderingInfo( &colorAttachmentInfo, &depthAttachmentInfo, renderSize );
 	vkCmdBeginRendering( cmd, &renderInfo );
 
+	m_renderPassTarget = { m_colorTarget.imageView, m_depthTarget.imageView, m_colorTarget.format, m_depthTarget.format,
+	    renderSize };
+
 	m_isRenderPassActive = true;
+	m_isCulledInstanceBufferBound = false;
 	m_renderingActive = true;
 	return RENDER_STATUS_OK;
 }
@@ -1386,7 +2344,8 @@ RenderStatus VulkanRenderContext::EndRendering()
 	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
 	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
 
-	VkCommandBuffer cmd = m_mainContext.commandBuffer;
+	VulkanFrameContext& frame = GetCurrentFrame();
+	VkCommandBuffer cmd = frame.commandContext.commandBuffer;
 
 	if ( m_isRenderPassActive )
 	{
@@ -1439,16 +2398,17 @@ RenderStatus VulkanRenderContext::EndRendering()
 	BindVertexBuffer( m_fullScreenTri.vertexBuffer );
 	BindIndexBuffer( m_fullScreenTri.indexBuffer );
 	BindPipeline( m_fullScreenTri.pipeline );
-	BindDescriptor( m_fullScreenTri.descriptor );
 
+	// Only actually writes anything when CreateRenderTargets has made a new color target
 	DescriptorUpdateInfo_t updateInfo = {};
 	updateInfo.binding = 0;
 	updateInfo.samplerType = SAMPLER_TYPE_POINT;
 	updateInfo.src = &m_fullScreenTri.imageTexture;
 
 	UpdateDescriptor( m_fullScreenTri.descriptor, updateInfo );
+	BindDescriptor( m_fullScreenTri.descriptor );
 
-	Draw( m_fullScreenTri.vertexCount, m_fullScreenTri.indexCount, 1 );
+	Draw( m_fullScreenTri.vertexCount, m_fullScreenTri.indexCount, 1, 0 );
 
 	vkCmdEndRendering( cmd );
 
@@ -1469,22 +2429,38 @@ RenderStatus VulkanRenderContext::EndRendering()
 
 	VK_CHECK( vkEndCommandBuffer( cmd ) );
 
-	// Submit
-	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	//
+	// Submit. As well as the swapchain image, wait on anything that was uploaded for this frame; the upload
+	// queue only sends its work off here, so this is the only place we need to wait on it.
+	//
+	VkSemaphore waitSemaphores[] = { frame.presentSemaphore, m_uploadQueue->GetTimelineSemaphore() };
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+	uint64_t waitValues[] = { 0, m_uploadQueue->Submit() };
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.pNext = nullptr;
+	timelineInfo.waitSemaphoreValueCount = 2;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
+
 	VkSubmitInfo submit = VKInit::SubmitInfo( &cmd );
+	submit.pNext = &timelineInfo;
 
-	submit.pWaitDstStageMask = &waitStage;
+	submit.pWaitDstStageMask = waitStages;
 
-	submit.waitSemaphoreCount = 1;
-	submit.pWaitSemaphores = &m_presentSemaphore;
+	submit.waitSemaphoreCount = 2;
+	submit.pWaitSemaphores = waitSemaphores;
 
 	submit.signalSemaphoreCount = 1;
-	submit.pSignalSemaphores = &m_renderSemaphore;
+	submit.pSignalSemaphores = &frame.renderSemaphore;
 
-	VK_CHECK( vkQueueSubmit( m_graphicsQueue, 1, &submit, m_mainContext.fence ) );
+	// Don't wait on this; BeginRendering waits on the fence once this frame comes back around, which lets
+	// the CPU get on with recording the next one while the GPU works on this
+	VK_CHECK( vkQueueSubmit( m_graphicsQueue, 1, &submit, frame.commandContext.fence ) );
 
 	// Present
-	VkPresentInfoKHR presentInfo = VKInit::PresentInfo( &m_swapchain.m_swapchain, &m_renderSemaphore, &m_swapchainImageIndex );
+	VkPresentInfoKHR presentInfo =
+	    VKInit::PresentInfo( &m_swapchain.m_swapchain, &frame.renderSemaphore, &m_swapchainImageIndex );
 
 	if ( !CanRender() )
 	{
@@ -1494,11 +2470,6 @@ RenderStatus VulkanRenderContext::EndRendering()
 
 	VK_CHECK( vkQueuePresentKHR( m_graphicsQueue, &presentInfo ) );
 
-	//
-	// Delete everything in the deletion queue, because we can be 100% sure we're not using it here
-	//
-	m_frameDeletionQueue.Flush();
-
 	m_renderingActive = false;
 	return RENDER_STATUS_OK;
 }
@@ -1510,9 +2481,18 @@ RenderStatus VulkanRenderContext::BindPipeline( Pipeline p )
 
 	std::shared_ptr<VulkanPipeline> pipeline = m_pipelines.Get( p.m_handle );
 
-	m_pipeline = pipeline;
+	GetBoundPipeline() = pipeline;
+
+	VkCommandBuffer cmd = GetCommandBuffer();
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->pipeline );
+
+	// Frame constants, followed by the bindless textures if we have them
+	VkDescriptorSet sharedSets[] = { GetCurrentFrame().frameConstantsSet, m_bindlessSet };
+	uint32_t sharedSetCount = m_isBindless ? 2 : 1;
 
-	vkCmdBindPipeline( m_mainContext.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->pipeline );
+	vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->layout, FRAME_CONSTANTS_SET, sharedSetCount,
+	    sharedSets, 0, nullptr );
 
 	return RENDER_STATUS_OK;
 }
@@ -1524,7 +2504,7 @@ RenderStatus VulkanRenderContext::BindDescriptor( Descriptor d )
 
 	std::shared_ptr<VulkanDescriptor> descriptor = m_descriptors.Get( d.m_handle );
 
-	vkCmdBindDescriptorSets( m_mainContext.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->layout, 0, 1,
+	vkCmdBindDescriptorSets( GetCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, GetBoundPipeline()->layout, 0, 1,
 	    &descriptor->descriptorSet, 0, nullptr );
 
 	return RENDER_STATUS_OK;
@@ -1533,23 +2513,47 @@ RenderStatus VulkanRenderContext::BindDescriptor( Descriptor d )
 RenderStatus VulkanRenderContext::UpdateDescriptor( Descriptor d, DescriptorUpdateInfo_t updateInfo )
 {
 	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
-	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
-
-	BindDescriptor( d );
 
 	std::shared_ptr<VulkanDescriptor> descriptor = m_descriptors.Get( d.m_handle );
 	std::shared_ptr<VulkanImageTexture> texture = m_imageTextures.Get( updateInfo.src->m_handle );
 
+	// Nothing to point at yet
+	if ( texture->imageView == VK_NULL_HANDLE )
+		return RENDER_STATUS_OK;
+
+	VkSampler sampler = SAMPLER_TYPE_ANISOTROPIC ? m_anisoSampler.sampler : m_pointSampler.sampler; // TODO
+
+	//
+	// Descriptor sets are written once and then left alone; only write again if the texture (or the
+	// image behind it) has changed since last time
+	//
+	VulkanDescriptor::BoundImage& boundImage = descriptor->boundImages[updateInfo.binding];
+
+	if ( boundImage.texture == updateInfo.src->m_handle && boundImage.textureVersion == texture->version &&
+	     boundImage.sampler == sampler )
+	{
+		return RENDER_STATUS_OK;
+	}
+
+	// A set that's already been written might be in use by a frame that's still in flight, and it can't
+	// be written while that's happening. This is rare enough that just waiting is fine.
+	if ( boundImage.texture != HANDLE_INVALID )
+		WaitForFrames();
+
 	VkDescriptorImageInfo imageInfo = {};
 	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	imageInfo.imageView = texture->imageView;
-	imageInfo.sampler = SAMPLER_TYPE_ANISOTROPIC ? m_anisoSampler.sampler : m_pointSampler.sampler; // TODO
+	imageInfo.sampler = sampler;
 
 	auto descriptorWrite = VKInit::WriteDescriptorImage(
 	    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, descriptor->descriptorSet, &imageInfo, updateInfo.binding );
 
 	vkUpdateDescriptorSets( m_device, 1, &descriptorWrite, 0, nullptr );
 
+	boundImage.texture = updateInfo.src->m_handle;
+	boundImage.textureVersion = texture->version;
+	boundImage.sampler = sampler;
+
 	return RENDER_STATUS_OK;
 }
 
@@ -1561,7 +2565,7 @@ RenderStatus VulkanRenderContext::BindVertexBuffer( VertexBuffer vb )
 	std::shared_ptr<VulkanBuffer> vertexBuffer = m_buffers.Get( vb.m_handle );
 
 	VkDeviceSize offset = 0;
-	vkCmdBindVertexBuffers( m_mainContext.commandBuffer, 0, 1, &vertexBuffer->buffer, &offset );
+	vkCmdBindVertexBuffers( GetCommandBuffer(), 0, 1, &vertexBuffer->buffer, &offset );
 
 	return RENDER_STATUS_OK;
 }
@@ -1574,7 +2578,7 @@ RenderStatus VulkanRenderContext::BindIndexBuffer( IndexBuffer ib )
 	std::shared_ptr<VulkanBuffer> indexBuffer = m_buffers.Get( ib.m_handle );
 
 	VkDeviceSize offset = 0;
-	vkCmdBindIndexBuffer( m_mainContext.commandBuffer, indexBuffer->buffer, offset, VK_INDEX_TYPE_UINT32 );
+	vkCmdBindIndexBuffer( GetCommandBuffer(), indexBuffer->buffer, offset, VK_INDEX_TYPE_UINT32 );
 
 	return RENDER_STATUS_OK;
 }
@@ -1584,18 +2588,505 @@ RenderStatus VulkanRenderContext::BindConstants( RenderPushConstants p )
 	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
 	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
 
-	vkCmdPushConstants( m_mainContext.commandBuffer, m_pipeline->layout,
+	vkCmdPushConstants( GetCommandBuffer(), GetBoundPipeline()->layout,
 	    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( RenderPushConstants ), &p );
 
 	return RENDER_STATUS_OK;
 }
 
-RenderStatus VulkanRenderContext::Draw( uint32_t vertexCount, uint32_t indexCount, uint32_t instanceCount )
+RenderStatus VulkanRenderContext::SetFrameConstants( const RenderFrameConstants& constants )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+
+	// The GPU has finished with this frame's constants from last time around by now (we waited on its
+	// fence in BeginRendering), so they can be overwritten in place
+	BufferUploadInfo_t uploadInfo = {};
+	uploadInfo.data.count = 1;
+	uploadInfo.data.size = sizeof( RenderFrameConstants );
+	uploadInfo.data.data = ( void* )&constants;
+
+	GetCurrentFrame().frameConstantsBuffer->SetData( uploadInfo );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus VulkanRenderContext::SetLightData( const std::vector<RenderLight>& lights,
+    const std::vector<RenderLightCluster>& clusters, const std::vector<uint32_t>& lightIndices )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+
+	VulkanFrameContext& frame = GetCurrentFrame();
+
+	VkBuffer previousBuffers[3] = { frame.lightBuffer->buffer, frame.lightClusterBuffer->buffer,
+		frame.lightIndexBuffer->buffer };
+
+	BufferInfo_t bufferInfo = {};
+	bufferInfo.type = BUFFER_TYPE_DYNAMIC_DATA;
+	bufferInfo.usage = BUFFER_USAGE_FLAG_STORAGE_BUFFER;
+
+	bufferInfo.name = "Lights";
+	ReserveFrameBuffer( frame.lightBuffer, frame.lightCapacity, lights.size() * sizeof( RenderLight ), bufferInfo,
+	    VMA_MEMORY_USAGE_AUTO_PREFER_HOST );
+
+	bufferInfo.name = "Light clusters";
+	ReserveFrameBuffer( frame.lightClusterBuffer, frame.lightClusterCapacity, clusters.size() * sizeof( RenderLightCluster ),
+	    bufferInfo, VMA_MEMORY_USAGE_AUTO_PREFER_HOST );
+
+	bufferInfo.name = "Light indices";
+	ReserveFrameBuffer( frame.lightIndexBuffer, frame.lightIndexCapacity, lightIndices.size() * sizeof( uint32_t ), bufferInfo,
+	    VMA_MEMORY_USAGE_AUTO_PREFER_HOST );
+
+	// Nothing can be using this frame's set yet, as long as this is called before anything is bound
+	if ( previousBuffers[0] != frame.lightBuffer->buffer || previousBuffers[1] != frame.lightClusterBuffer->buffer ||
+	     previousBuffers[2] != frame.lightIndexBuffer->buffer )
+	{
+		WriteFrameConstantsSet( frame );
+	}
+
+	auto upload = []( VulkanBuffer& buffer, const void* data, size_t count, size_t stride ) {
+		if ( count == 0 )
+			return;
+
+		BufferUploadInfo_t uploadInfo = {};
+		uploadInfo.data.count = count;
+		uploadInfo.data.size = count * stride;
+		uploadInfo.data.data = ( void* )data;
+
+		buffer.SetData( uploadInfo );
+	};
+
+	upload( *frame.lightBuffer, lights.data(), lights.size(), sizeof( RenderLight ) );
+	upload( *frame.lightClusterBuffer, clusters.data(), clusters.size(), sizeof( RenderLightCluster ) );
+	upload( *frame.lightIndexBuffer, lightIndices.data(), lightIndices.size(), sizeof( uint32_t ) );
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus VulkanRenderContext::SetInstanceData( const std::vector<RenderInstanceData>& instances )
 {
 	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
 	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
 
-	vkCmdDrawIndexed( m_mainContext.commandBuffer, indexCount, instanceCount, 0, 0, 0 );
+	if ( instances.empty() )
+		return RENDER_STATUS_OK;
+
+	VulkanFrameContext& frame = GetCurrentFrame();
+
+	if ( instances.size() > frame.instanceBufferCapacity )
+	{
+		// This frame's last go around has finished with the old buffer by now (we waited on its fence in
+		// BeginRendering), but commands recorded earlier this frame might still use it
+		if ( frame.instanceBuffer != nullptr )
+		{
+			std::shared_ptr<VulkanBuffer> oldBuffer = frame.instanceBuffer;
+			frame.deletionQueue.Enqueue( [oldBuffer]() { oldBuffer->Delete(); } );
+		}
+
+		frame.instanceBufferCapacity =
+		    std::max<size_t>( std::max<size_t>( instances.size(), frame.instanceBufferCapacity * 2 ), 1024 );
+
+		BufferInfo_t bufferInfo = {};
+		bufferInfo.name = "Instance buffer";
+		bufferInfo.size = static_cast<uint32_t>( frame.instanceBufferCapacity * sizeof( RenderInstanceData ) );
+		bufferInfo.type = BUFFER_TYPE_DYNAMIC_DATA;
+		bufferInfo.usage = BUFFER_USAGE_FLAG_VERTEX_BUFFER | BUFFER_USAGE_FLAG_STORAGE_BUFFER;
+
+		frame.instanceBuffer = std::make_shared<VulkanBuffer>( this, bufferInfo, VMA_MEMORY_USAGE_AUTO_PREFER_HOST );
+	}
+
+	BufferUploadInfo_t uploadInfo = {};
+	uploadInfo.data.count = instances.size();
+	uploadInfo.data.size = instances.size() * sizeof( RenderInstanceData );
+	uploadInfo.data.data = ( void* )instances.data();
+
+	frame.instanceBuffer->SetData( uploadInfo );
+
+	// Vertex buffer bindings survive pipeline changes, so this only needs doing once
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers( frame.commandContext.commandBuffer, 1, 1, &frame.instanceBuffer->buffer, &offset );
+	m_isCulledInstanceBufferBound = false;
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus VulkanRenderContext::Draw( uint32_t vertexCount, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset,
+    uint32_t instanceCount, uint32_t firstInstance )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+
+	// In GPU-driven mode, anything that has to keep its order is drawn this way after the indirect draws,
+	// from every instance rather than from the ones that survived culling
+	if ( m_isCulledInstanceBufferBound && t_recordingState == nullptr )
+	{
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers( GetCommandBuffer(), 1, 1, &GetCurrentFrame().instanceBuffer->buffer, &offset );
+		m_isCulledInstanceBufferBound = false;
+	}
+
+	vkCmdDrawIndexed( GetCommandBuffer(), indexCount, instanceCount, firstIndex, vertexOffset, firstInstance );
+
+	return RENDER_STATUS_OK;
+}
+
+void VulkanRenderContext::RestartRenderPass( VkRenderingFlags flags, std::function<void( VkCommandBuffer cmd )> recordBetween )
+{
+	VkCommandBuffer cmd = m_frames[m_frameIndex].commandContext.commandBuffer;
+
+	vkCmdEndRendering( cmd );
+
+	if ( recordBetween != nullptr )
+		recordBetween( cmd );
+
+	// Separate render passes don't synchronise with each other, so wait for everything the last one wrote
+	VkMemoryBarrier attachmentBarrier = {};
+	attachmentBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	attachmentBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	attachmentBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+	                                  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+	                                  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	VkPipelineStageFlags attachmentStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+	                                        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+	                                        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+	vkCmdPipelineBarrier( cmd, attachmentStages, attachmentStages, 0, 1, &attachmentBarrier, 0, nullptr, 0, nullptr );
+
+	VkRenderingAttachmentInfo colorAttachmentInfo =
+	    VKInit::RenderingAttachmentInfo( m_renderPassTarget.colorView, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL );
+	colorAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+	VkRenderingAttachmentInfo depthAttachmentInfo =
+	    VKInit::RenderingAttachmentInfo( m_renderPassTarget.depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL );
+	depthAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+	VkRenderingInfo renderInfo = VKInit::RenderingInfo( &colorAttachmentInfo, &depthAttachmentInfo, m_renderPassTarget.size );
+	renderInfo.flags = flags;
+
+	vkCmdBeginRendering( cmd, &renderInfo );
+}
+
+RenderStatus VulkanRenderContext::RecordParallel( uint32_t count, std::function<void( uint32_t index )> func )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+	ErrorIf( !m_isRenderPassActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+
+	if ( count == 0 )
+		return RENDER_STATUS_OK;
+
+	VulkanFrameContext& frame = GetCurrentFrame();
+
+	//
+	// Grab a secondary command buffer for each index. Pools and buffers are only ever created here, on
+	// the main thread, so the workers don't need to touch anything shared.
+	//
+	while ( frame.secondaryPools.size() < count )
+	{
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.pNext = nullptr;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = m_graphicsQueueFamily;
+
+		VulkanSecondaryCommandPool pool = {};
+		VK_CHECK( vkCreateCommandPool( m_device, &poolInfo, nullptr, &pool.commandPool ) );
+		SetDebugName( "Secondary Command Pool", VK_OBJECT_TYPE_COMMAND_POOL, ( uint64_t )pool.commandPool );
+
+		frame.secondaryPools.push_back( pool );
+	}
+
+	std::vector<VkCommandBuffer> commandBuffers( count );
+
+	for ( uint32_t i = 0; i < count; ++i )
+	{
+		VulkanSecondaryCommandPool& pool = frame.secondaryPools[i];
+
+		if ( pool.usedCount == pool.commandBuffers.size() )
+		{
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.pNext = nullptr;
+			allocInfo.commandPool = pool.commandPool;
+			allocInfo.commandBufferCount = 1;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+			VkCommandBuffer commandBuffer;
+			VK_CHECK( vkAllocateCommandBuffers( m_device, &allocInfo, &commandBuffer ) );
+			pool.commandBuffers.push_back( commandBuffer );
+		}
+
+		commandBuffers[i] = pool.commandBuffers[pool.usedCount++];
+	}
+
+	//
+	// Secondary command buffers continue the render pass, so they need to know what it's drawing to
+	//
+	VkCommandBufferInheritanceRenderingInfo inheritanceRenderingInfo = {};
+	inheritanceRenderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+	inheritanceRenderingInfo.colorAttachmentCount = 1;
+	inheritanceRenderingInfo.pColorAttachmentFormats = &m_renderPassTarget.colorFormat;
+	inheritanceRenderingInfo.depthAttachmentFormat = m_renderPassTarget.depthFormat;
+	inheritanceRenderingInfo.stencilAttachmentFormat = m_renderPassTarget.depthFormat;
+	inheritanceRenderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkCommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.pNext = &inheritanceRenderingInfo;
+
+	VkCommandBufferBeginInfo beginInfo = VKInit::CommandBufferBeginInfo(
+	    VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT );
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	// Secondary command buffers don't inherit any state, so viewport, scissor and instance data all
+	// need setting again in each of them
+	Size2D size = m_renderPassTarget.size;
+
+	VkViewport viewport = {};
+	viewport.minDepth = 0.0;
+	viewport.maxDepth = 1.0;
+	viewport.width = static_cast<float>( size.x );
+	viewport.height = static_cast<float>( size.y );
+
+	VkRect2D scissor = { { 0, 0 }, { size.x, size.y } };
+
+	std::shared_ptr<VulkanBuffer> instanceBuffer = frame.instanceBuffer;
+
+	// The primary command buffer can only execute secondary ones while the pass is set up for them
+	RestartRenderPass( VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT );
+
+	Globals::m_jobManager->ParallelFor( count, 1, [&]( size_t start, size_t end ) {
+		for ( size_t i = start; i < end; ++i )
+		{
+			VkCommandBuffer cmd = commandBuffers[i];
+			VK_CHECK( vkBeginCommandBuffer( cmd, &beginInfo ) );
+
+			vkCmdSetViewport( cmd, 0, 1, &viewport );
+			vkCmdSetScissor( cmd, 0, 1, &scissor );
+
+			if ( instanceBuffer != nullptr )
+			{
+				VkDeviceSize offset = 0;
+				vkCmdBindVertexBuffers( cmd, 1, 1, &instanceBuffer->buffer, &offset );
+			}
+
+			// Jobs can run inside other jobs on the same thread, so put back whatever was there before
+			VulkanRecordingState recordingState = { cmd, nullptr };
+			VulkanRecordingState* previousState = t_recordingState;
+			t_recordingState = &recordingState;
+
+			func( static_cast<uint32_t>( i ) );
+
+			t_recordingState = previousState;
+			VK_CHECK( vkEndCommandBuffer( cmd ) );
+		}
+	} );
+
+	VkCommandBuffer primary = frame.commandContext.commandBuffer;
+	vkCmdExecuteCommands( primary, count, commandBuffers.data() );
+
+	// Back to recording inline for anything that comes after. Pipeline and descriptor bindings on the
+	// primary command buffer have been disturbed, so forget the pipeline too
+	RestartRenderPass( 0 );
+	m_pipeline = nullptr;
+
+	return RENDER_STATUS_OK;
+}
+
+void VulkanRenderContext::ReserveFrameBuffer( std::shared_ptr<VulkanBuffer>& buffer, size_t& capacity, size_t size,
+    BufferInfo_t bufferInfo, VmaMemoryUsage memoryUsage )
+{
+	if ( size <= capacity )
+		return;
+
+	// Same as the instance buffer: commands recorded earlier this frame might still use the old one
+	if ( buffer != nullptr )
+	{
+		std::shared_ptr<VulkanBuffer> oldBuffer = buffer;
+		GetCurrentFrame().deletionQueue.Enqueue( [oldBuffer]() { oldBuffer->Delete(); } );
+	}
+
+	capacity = std::max<size_t>( std::max<size_t>( size, capacity * 2 ), 64 * 1024 );
+
+	bufferInfo.size = static_cast<uint32_t>( capacity );
+	buffer = std::make_shared<VulkanBuffer>( this, bufferInfo, memoryUsage );
+}
+
+RenderStatus VulkanRenderContext::CullIndirectDraws( const std::vector<RenderIndirectDraw>& draws,
+    const std::vector<uint32_t>& instanceDraws, const Frustum& frustum )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+	ErrorIf( !m_isRenderPassActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+	ErrorIf( !m_isGpuDriven, RENDER_STATUS_NOT_INITIALIZED );
+
+	VulkanFrameContext& frame = GetCurrentFrame();
+	frame.indirectDrawCount = static_cast<uint32_t>( draws.size() );
+
+	if ( draws.empty() || instanceDraws.empty() )
+		return RENDER_STATUS_OK;
+
+	const size_t drawCount = draws.size();
+	const size_t instanceCount = instanceDraws.size();
+
+	//
+	// Make room for everything. The inputs are written by the CPU every frame; everything else is
+	// only ever touched by the GPU
+	//
+	BufferInfo_t bufferInfo = {};
+
+	bufferInfo.name = "Indirect draws";
+	bufferInfo.type = BUFFER_TYPE_DYNAMIC_DATA;
+	bufferInfo.usage = BUFFER_USAGE_FLAG_STORAGE_BUFFER;
+	ReserveFrameBuffer( frame.indirectDrawBuffer, frame.indirectDrawCapacity, drawCount * sizeof( RenderIndirectDraw ),
+	    bufferInfo, VMA_MEMORY_USAGE_AUTO_PREFER_HOST );
+
+	bufferInfo.name = "Instance draws";
+	ReserveFrameBuffer( frame.instanceDrawBuffer, frame.instanceDrawCapacity, instanceCount * sizeof( uint32_t ), bufferInfo,
+	    VMA_MEMORY_USAGE_AUTO_PREFER_HOST );
+
+	bufferInfo.name = "Draw counts";
+	bufferInfo.type = BUFFER_TYPE_GPU_DATA;
+	bufferInfo.usage = BUFFER_USAGE_FLAG_STORAGE_BUFFER | BUFFER_USAGE_FLAG_INDIRECT_BUFFER | BUFFER_USAGE_FLAG_TRANSFER_DST;
+	ReserveFrameBuffer( frame.drawCountBuffer, frame.drawCountCapacity, drawCount * 2 * sizeof( uint32_t ), bufferInfo,
+	    VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE );
+
+	bufferInfo.name = "Draw commands";
+	bufferInfo.usage = BUFFER_USAGE_FLAG_STORAGE_BUFFER | BUFFER_USAGE_FLAG_INDIRECT_BUFFER;
+	ReserveFrameBuffer( frame.drawCommandBuffer, frame.drawCommandCapacity, drawCount * sizeof( VkDrawIndexedIndirectCommand ),
+	    bufferInfo, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE );
+
+	bufferInfo.name = "Culled instance buffer";
+	bufferInfo.usage = BUFFER_USAGE_FLAG_STORAGE_BUFFER | BUFFER_USAGE_FLAG_VERTEX_BUFFER;
+	ReserveFrameBuffer( frame.culledInstanceBuffer, frame.culledInstanceCapacity, instanceCount * sizeof( RenderInstanceData ),
+	    bufferInfo, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE );
+
+	BufferUploadInfo_t uploadInfo = {};
+	uploadInfo.data.count = drawCount;
+	uploadInfo.data.size = drawCount * sizeof( RenderIndirectDraw );
+	uploadInfo.data.data = ( void* )draws.data();
+	frame.indirectDrawBuffer->SetData( uploadInfo );
+
+	uploadInfo.data.count = instanceCount;
+	uploadInfo.data.size = instanceCount * sizeof( uint32_t );
+	uploadInfo.data.data = ( void* )instanceDraws.data();
+	frame.instanceDrawBuffer->SetData( uploadInfo );
+
+	//
+	// Point the set at any of this frame's buffers that were replaced above, or by SetInstanceData. Most
+	// frames nothing has grown, and nothing needs writing. The last time this set was used was this
+	// frame's previous go around, which we waited on in BeginRendering.
+	//
+	VkBuffer setBuffers[6] = { frame.instanceBuffer->buffer, frame.instanceDrawBuffer->buffer, frame.indirectDrawBuffer->buffer,
+		frame.drawCountBuffer->buffer, frame.drawCommandBuffer->buffer, frame.culledInstanceBuffer->buffer };
+
+	VkDescriptorBufferInfo bufferInfos[6] = {};
+	VkWriteDescriptorSet writes[6] = {};
+	uint32_t writeCount = 0;
+
+	for ( uint32_t i = 0; i < 6; ++i )
+	{
+		if ( frame.cullSetBuffers[i] == setBuffers[i] )
+			continue;
+
+		bufferInfos[writeCount].buffer = setBuffers[i];
+		bufferInfos[writeCount].offset = 0;
+		bufferInfos[writeCount].range = VK_WHOLE_SIZE;
+
+		writes[writeCount] =
+		    VKInit::WriteDescriptorBuffer( VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.cullSet, &bufferInfos[writeCount], i );
+		writeCount++;
+
+		frame.cullSetBuffers[i] = setBuffers[i];
+	}
+
+	if ( writeCount > 0 )
+		vkUpdateDescriptorSets( m_device, writeCount, writes, 0, nullptr );
+
+	VulkanCullConstants constants = {};
+	std::copy( std::begin( frustum.planes ), std::end( frustum.planes ), constants.frustumPlanes );
+	constants.instanceCount = static_cast<uint32_t>( instanceCount );
+	constants.drawCount = static_cast<uint32_t>( drawCount );
+
+	//
+	// Compute can't run inside a render pass, so step out of it for the two passes
+	//
+	RestartRenderPass( 0, [&]( VkCommandBuffer cmd ) {
+		auto barrier = [cmd]( VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage,
+		                   VkAccessFlags dstAccess ) {
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = srcAccess;
+			memoryBarrier.dstAccessMask = dstAccess;
+
+			vkCmdPipelineBarrier( cmd, srcStage, dstStage, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr );
+		};
+
+		// Every count starts at zero
+		vkCmdFillBuffer( cmd, frame.drawCountBuffer->buffer, 0, drawCount * 2 * sizeof( uint32_t ), 0 );
+		barrier( VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		    VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT );
+
+		vkCmdBindDescriptorSets(
+		    cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1, &frame.cullSet, 0, nullptr );
+		vkCmdPushConstants(
+		    cmd, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( VulkanCullConstants ), &constants );
+
+		// Test every instance, and copy the visible ones next to each other for each draw...
+		vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullInstancesPipeline );
+		vkCmdDispatch( cmd, static_cast<uint32_t>( ( instanceCount + CULL_WORKGROUP_SIZE - 1 ) / CULL_WORKGROUP_SIZE ), 1, 1 );
+
+		barrier( VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		    VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT );
+
+		// ...then write a command for every draw with something left in it
+		vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_buildIndirectDrawsPipeline );
+		vkCmdDispatch( cmd, static_cast<uint32_t>( ( drawCount + CULL_WORKGROUP_SIZE - 1 ) / CULL_WORKGROUP_SIZE ), 1, 1 );
+
+		barrier( VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		    VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT );
+	} );
+
+	// Only what survived gets drawn
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers( frame.commandContext.commandBuffer, 1, 1, &frame.culledInstanceBuffer->buffer, &offset );
+	m_isCulledInstanceBufferBound = true;
+
+	// The compute layout disturbs push constants, so whatever was bound before needs binding again
+	m_pipeline = nullptr;
+
+	return RENDER_STATUS_OK;
+}
+
+RenderStatus VulkanRenderContext::DrawIndirect( uint32_t firstDraw, uint32_t drawCount )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	ErrorIf( !m_renderingActive, RENDER_STATUS_BEGIN_END_MISMATCH );
+	ErrorIf( !m_isGpuDriven, RENDER_STATUS_NOT_INITIALIZED );
+
+	VulkanFrameContext& frame = GetCurrentFrame();
+	ErrorIf( firstDraw + drawCount > frame.indirectDrawCount, RENDER_STATUS_INVALID_HANDLE );
+
+	if ( drawCount == 0 )
+		return RENDER_STATUS_OK;
+
+	if ( !m_isCulledInstanceBufferBound )
+	{
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers( GetCommandBuffer(), 1, 1, &frame.culledInstanceBuffer->buffer, &offset );
+		m_isCulledInstanceBufferBound = true;
+	}
+
+	// The group's commands were packed from its first draw onwards, and how many there are was left in
+	// the second half of the count buffer
+	const VkDeviceSize commandOffset = firstDraw * sizeof( VkDrawIndexedIndirectCommand );
+	const VkDeviceSize countOffset = ( frame.indirectDrawCount + firstDraw ) * sizeof( uint32_t );
+
+	vkCmdDrawIndexedIndirectCount( GetCommandBuffer(), frame.drawCommandBuffer->buffer, commandOffset,
+	    frame.drawCountBuffer->buffer, countOffset, drawCount, sizeof( VkDrawIndexedIndirectCommand ) );
 
 	return RENDER_STATUS_OK;
 }
@@ -1607,7 +3098,7 @@ RenderStatus VulkanRenderContext::BindRenderTarget( RenderTexture rt )
 
 	if ( m_isRenderPassActive )
 	{
-		vkCmdEndRendering( m_mainContext.commandBuffer );
+		vkCmdEndRendering( GetCommandBuffer() );
 	}
 
 	std::shared_ptr<VulkanRenderTexture> renderTexture = m_renderTextures.Get( rt.m_handle );
@@ -1616,7 +3107,7 @@ RenderStatus VulkanRenderContext::BindRenderTarget( RenderTexture rt )
 	VkImageMemoryBarrier startRenderImageMemoryBarrier = VKInit::ImageMemoryBarrier( VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
 	    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, renderTexture->image );
 
-	vkCmdPipelineBarrier( m_mainContext.commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+	vkCmdPipelineBarrier( GetCommandBuffer(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
 	    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &startRenderImageMemoryBarrier );
 
 	VkClearValue colorClear = { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
@@ -1632,7 +3123,10 @@ RenderStatus VulkanRenderContext::BindRenderTarget( RenderTexture rt )
 	depthAttachmentInfo.clearValue = depthClear;
 
 	VkRenderingInfo renderInfo = VKInit::RenderingInfo( &colorAttachmentInfo, &depthAttachmentInfo, renderTexture->size );
-	vkCmdBeginRendering( m_mainContext.commandBuffer, &renderInfo );
+	vkCmdBeginRendering( GetCommandBuffer(), &renderInfo );
+
+	m_renderPassTarget = { renderTexture->imageView, m_depthTarget.imageView, renderTexture->format, m_depthTarget.format,
+	    renderTexture->size };
 
 	return RENDER_STATUS_OK;
 }
@@ -1749,9 +3243,35 @@ RenderStatus VulkanRenderContext::CreatePipeline( PipelineInfo_t pipelineInfo, H
 {
 	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
 
+	std::string key = GetPipelineKey( pipelineInfo );
+
+	{
+		std::lock_guard lock( m_pipelineMutex );
+		auto it = m_pipelineLookup.find( key );
+
+		if ( it != m_pipelineLookup.end() )
+		{
+			*outHandle = it->second;
+			return RENDER_STATUS_OK;
+		}
+	}
+
+	// Build outside the lock; this is the slow part
 	VulkanPipeline pipeline( this, pipelineInfo );
 
+	std::lock_guard lock( m_pipelineMutex );
+	auto it = m_pipelineLookup.find( key );
+
+	// Someone else built the same thing while we were busy
+	if ( it != m_pipelineLookup.end() )
+	{
+		pipeline.Delete();
+		*outHandle = it->second;
+		return RENDER_STATUS_OK;
+	}
+
 	*outHandle = m_pipelines.Add( pipeline );
+	m_pipelineLookup.emplace( std::move( key ), *outHandle );
 
 	return RENDER_STATUS_OK;
 }
@@ -1796,6 +3316,42 @@ RenderStatus VulkanRenderContext::GetImGuiTextureID( ImageTexture* texture, void
 	return RENDER_STATUS_OK;
 }
 
+RenderStatus VulkanRenderContext::GetBindlessTextureIndex( ImageTexture* texture, uint32_t* outIndex )
+{
+	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
+	assert( m_isBindless && "Bindless textures are only available when render.bindless is on" );
+
+	std::shared_ptr<VulkanImageTexture> vkTexture = m_imageTextures.Get( texture->m_handle );
+	uint32_t index = HandleMap<VulkanImageTexture>::GetSlotIndex( texture->m_handle );
+
+	if ( vkTexture == nullptr || index >= m_bindlessTextureCapacity )
+		return RENDER_STATUS_INVALID_HANDLE;
+
+	*outIndex = index;
+
+	// Nothing to point at yet, or already pointing at the right thing
+	if ( vkTexture->imageView == VK_NULL_HANDLE || vkTexture->bindlessVersion == vkTexture->version )
+		return RENDER_STATUS_OK;
+
+	// Frames in flight can carry on using other slots while this one is written, but not this one
+	if ( vkTexture->bindlessVersion != UINT32_MAX )
+		WaitForFrames();
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = vkTexture->imageView;
+	imageInfo.sampler = m_anisoSampler.sampler;
+
+	auto descriptorWrite =
+	    VKInit::WriteDescriptorImage( VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_bindlessSet, &imageInfo, 0 );
+	descriptorWrite.dstArrayElement = index;
+
+	vkUpdateDescriptorSets( m_device, 1, &descriptorWrite, 0, nullptr );
+
+	vkTexture->bindlessVersion = vkTexture->version;
+	return RENDER_STATUS_OK;
+}
+
 RenderStatus VulkanRenderContext::ImmediateSubmit( std::function<RenderStatus( VkCommandBuffer commandBuffer )> func )
 {
 	ErrorIf( !m_hasInitialized, RENDER_STATUS_NOT_INITIALIZED );
@@ -1814,7 +3370,23 @@ RenderStatus VulkanRenderContext::ImmediateSubmit( std::function<RenderStatus( V
 
 	VK_CHECK( vkEndCommandBuffer( cmd ) );
 
+	// Whatever this does might use something that's still waiting in the upload queue
+	VkSemaphore uploadSemaphore = m_uploadQueue->GetTimelineSemaphore();
+	VkPipelineStageFlags uploadWaitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	uint64_t uploadValue = m_uploadQueue->Submit();
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.pNext = nullptr;
+	timelineInfo.waitSemaphoreValueCount = 1;
+	timelineInfo.pWaitSemaphoreValues = &uploadValue;
+
 	VkSubmitInfo submit = VKInit::SubmitInfo( &cmd );
+	submit.pNext = &timelineInfo;
+	submit.waitSemaphoreCount = 1;
+	submit.pWaitSemaphores = &uploadSemaphore;
+	submit.pWaitDstStageMask = &uploadWaitStage;
+
 	VK_CHECK( vkQueueSubmit( m_graphicsQueue, 1, &submit, currentContext->fence ) );
 
 	vkWaitForFences( m_device, 1, &currentContext->fence, true, 9999999999 );
@@ -1890,8 +3462,11 @@ VulkanDescriptor::VulkanDescriptor( VulkanRenderContext* parent, DescriptorInfo_
 		binding.pImmutableSamplers = nullptr;
 
 		bindings.push_back( binding );
+		bindingTypes.push_back( binding.descriptorType );
 	}
 
+	boundImages.resize( bindings.size() );
+
 	VkDescriptorSetLayoutCreateInfo layoutInfo =
 	    VKInit::DescriptorSetLayoutCreateInfo( bindings.data(), static_cast<uint32_t>( bindings.size() ) );
 	VK_CHECK( vkCreateDescriptorSetLayout( m_parent->m_device, &layoutInfo, nullptr, &descriptorSetLayout ) );
@@ -1991,6 +3566,8 @@ VulkanPipeline::VulkanPipeline( VulkanRenderContext* parent, PipelineInfo_t pipe
 
 	std::vector<VkDescriptorSetLayout> setLayouts;
 
+	assert( pipelineInfo.descriptors.size() <= FRAME_CONSTANTS_SET && "Too many descriptors" );
+
 	for ( auto& descriptor : pipelineInfo.descriptors )
 	{
 		std::shared_ptr<VulkanDescriptor> vkDescriptor = m_parent->m_descriptors.Get( descriptor->m_handle );
@@ -1998,6 +3575,15 @@ VulkanPipeline::VulkanPipeline( VulkanRenderContext* parent, PipelineInfo_t pipe
 		setLayouts.push_back( vkDescriptor->descriptorSetLayout );
 	}
 
+	// Every pipeline gets the frame constants at the same set index
+	while ( setLayouts.size() < FRAME_CONSTANTS_SET )
+		setLayouts.push_back( m_parent->m_emptySetLayout );
+
+	setLayouts.push_back( m_parent->m_frameConstantsSetLayout );
+
+	if ( m_parent->m_isBindless )
+		setLayouts.push_back( m_parent->m_bindlessSetLayout );
+
 	pipeline_layout_info.pSetLayouts = setLayouts.data();
 	pipeline_layout_info.setLayoutCount = static_cast<uint32_t>( setLayouts.size() );
 
@@ -2037,6 +3623,16 @@ VulkanPipeline::VulkanPipeline( VulkanRenderContext* parent, PipelineInfo_t pipe
 
 	description.bindings.push_back( mainBinding );
 
+	// Per-instance data always comes from binding 1; shaders that don't need it just don't read it
+	VkVertexInputBindingDescription instanceBinding = {};
+	instanceBinding.binding = 1;
+	instanceBinding.stride = sizeof( RenderInstanceData );
+	instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	description.bindings.push_back( instanceBinding );
+
+	assert( pipelineInfo.vertexAttributes.size() <= INSTANCE_ATTRIBUTE_LOCATION && "Too many vertex attributes" );
+
 	uint32_t offset = 0;
 
 	for ( int i = 0; i < pipelineInfo.vertexAttributes.size(); ++i )
@@ -2053,6 +3649,28 @@ VulkanPipeline::VulkanPipeline( VulkanRenderContext* parent, PipelineInfo_t pipe
 		offset += GetSizeOf( ( VertexAttributeFormat )attribute.format );
 	}
 
+	// Model matrix, one column per location
+	for ( uint32_t i = 0; i < 4; ++i )
+	{
+		VkVertexInputAttributeDescription columnAttribute = {};
+		columnAttribute.binding = 1;
+		columnAttribute.location = INSTANCE_ATTRIBUTE_LOCATION + i;
+		columnAttribute.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		columnAttribute.offset = offsetof( RenderInstanceData, modelMatrix ) + sizeof( glm::vec4 ) * i;
+		description.attributes.push_back( columnAttribute );
+	}
+
+	// Bindless texture indices, four per location
+	for ( uint32_t i = 0; i < MAX_INSTANCE_TEXTURES / 4; ++i )
+	{
+		VkVertexInputAttributeDescription textureIndexAttribute = {};
+		textureIndexAttribute.binding = 1;
+		textureIndexAttribute.location = INSTANCE_ATTRIBUTE_LOCATION + 4 + i;
+		textureIndexAttribute.format = VK_FORMAT_R32G32B32A32_UINT;
+		textureIndexAttribute.offset = offsetof( RenderInstanceData, textureIndices ) + sizeof( glm::uvec4 ) * i;
+		description.attributes.push_back( textureIndexAttribute );
+	}
+
 	builder.m_vertexInputInfo = VKInit::PipelineVertexInputStateCreateInfo();
 	builder.m_vertexInputInfo.pVertexAttributeDescriptions = description.attributes.data();
 	builder.m_vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>( description.attributes.size() );
@@ -2064,15 +3682,21 @@ VulkanPipeline::VulkanPipeline( VulkanRenderContext* parent, PipelineInfo_t pipe
 	builder.m_depthStencil =
 	    VKInit::DepthStencilCreateInfo( !pipelineInfo.ignoreDepth, !pipelineInfo.ignoreDepth, VK_COMPARE_OP_LESS_OR_EQUAL );
 
+	VkDevice device = m_parent->m_device;
+	VkPipelineCache pipelineCache = m_parent->m_pipelineCache;
+
 	if ( pipelineInfo.renderToSwapchain )
 	{
-		pipeline = builder.Build( m_parent->m_device, m_parent->m_colorTarget.format, VK_FORMAT_D32_SFLOAT_S8_UINT );
+		pipeline = builder.Build( device, pipelineCache, m_parent->m_colorTarget.format, VK_FORMAT_D32_SFLOAT_S8_UINT );
 	}
 	else
 	{
-		pipeline = builder.Build( m_parent->m_device, m_parent->m_colorTarget.format, m_parent->m_depthTarget.format );
+		pipeline = builder.Build( device, pipelineCache, m_parent->m_colorTarget.format, m_parent->m_depthTarget.format );
 	}
 
+	// The pipeline has everything it needs from these now
+	shader.Delete();
+
 	SetDebugName( pipelineInfo.name.c_str(), VK_OBJECT_TYPE_PIPELINE, ( uint64_t )pipeline );
 }
 
@@ -9,6 +9,7 @@
 #include <Rendering/window.h>
 #include <VkBootstrap.h>
 #include <algorithm>
+#include <mutex>
 #include <shared_mutex>
 #include <unordered_map>
 #include <vk_mem_alloc.h>
@@ -67,6 +68,129 @@ static const std::string g_fullScreenTriFragmentShader = R"(
 	}
 )";
 
+//
+// GPU-driven culling (render.gpu_driven). Both passes share one descriptor set and push constant layout:
+// the first culls instances and packs the visible ones together, the second turns the draws that
+// ended up with any instances into indirect commands, packed together within each group.
+//
+static const std::string g_gpuCullingShaderCommon = R"(
+	#version 460
+
+	layout ( local_size_x = 64 ) in;
+
+	struct Instance
+	{
+		mat4 modelMatrix;
+		uvec4 textureIndices[2];
+	};
+
+	struct IndirectDraw
+	{
+		uint indexCount;
+		uint firstIndex;
+		int vertexOffset;
+		uint firstInstance;
+		vec4 boundingSphere;
+		uint groupFirstDraw;
+		uint cull;
+	};
+
+	struct DrawCommand
+	{
+		uint indexCount;
+		uint instanceCount;
+		uint firstIndex;
+		int vertexOffset;
+		uint firstInstance;
+	};
+
+	layout ( std430, set = 0, binding = 0 ) readonly buffer InstancesIn { Instance g_instancesIn[]; };
+	layout ( std430, set = 0, binding = 1 ) readonly buffer InstanceDraws { uint g_instanceDraws[]; };
+	layout ( std430, set = 0, binding = 2 ) readonly buffer Draws { IndirectDraw g_draws[]; };
+
+	// [0, drawCount): visible instances for each draw. [drawCount, drawCount * 2): commands written
+	// for each group, indexed by the group's first draw
+	layout ( std430, set = 0, binding = 3 ) buffer Counts { uint g_counts[]; };
+
+	layout ( std430, set = 0, binding = 4 ) writeonly buffer Commands { DrawCommand g_commands[]; };
+	layout ( std430, set = 0, binding = 5 ) writeonly buffer InstancesOut { Instance g_instancesOut[]; };
+
+	layout ( push_constant ) uniform Constants
+	{
+		vec4 frustumPlanes[6];
+		uint instanceCount;
+		uint drawCount;
+	} g_constants;
+)";
+
+static const std::string g_cullInstancesShader = g_gpuCullingShaderCommon + R"(
+	bool IsVisible( Instance instance, IndirectDraw draw )
+	{
+		if ( draw.cull == 0 )
+			return true;
+
+		vec3 center = ( instance.modelMatrix * vec4( draw.boundingSphere.xyz, 1.0 ) ).xyz;
+
+		// Non-uniform scales stretch the sphere along one axis; cover it with the largest
+		float scale = max( max( length( instance.modelMatrix[0].xyz ), length( instance.modelMatrix[1].xyz ) ),
+			length( instance.modelMatrix[2].xyz ) );
+
+		float radius = draw.boundingSphere.w * scale;
+
+		for ( int i = 0; i < 6; ++i )
+		{
+			vec4 plane = g_constants.frustumPlanes[i];
+
+			if ( dot( plane.xyz, center ) + plane.w < -radius )
+				return false;
+		}
+
+		return true;
+	}
+
+	void main()
+	{
+		uint instanceIndex = gl_GlobalInvocationID.x;
+
+		if ( instanceIndex >= g_constants.instanceCount )
+			return;
+
+		Instance instance = g_instancesIn[instanceIndex];
+		uint drawIndex = g_instanceDraws[instanceIndex];
+		IndirectDraw draw = g_draws[drawIndex];
+
+		if ( !IsVisible( instance, draw ) )
+			return;
+
+		// Survivors land in whatever order their threads get here, so RenderManager keeps anything that
+		// has to be drawn in order off this path
+		uint slot = atomicAdd( g_counts[drawIndex], 1 );
+		g_instancesOut[draw.firstInstance + slot] = instance;
+	}
+)";
+
+static const std::string g_buildIndirectDrawsShader = g_gpuCullingShaderCommon + R"(
+	void main()
+	{
+		uint drawIndex = gl_GlobalInvocationID.x;
+
+		if ( drawIndex >= g_constants.drawCount )
+			return;
+
+		uint instanceCount = g_counts[drawIndex];
+
+		if ( instanceCount == 0 )
+			return;
+
+		IndirectDraw draw = g_draws[drawIndex];
+
+		// Same as above: the commands within a group come out in no particular order
+		uint slot = atomicAdd( g_counts[g_constants.drawCount + draw.groupFirstDraw], 1 );
+		g_commands[draw.groupFirstDraw + slot] =
+			DrawCommand( draw.indexCount, instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance );
+	}
+)";
+
 // ----------------------------------------------------------------------------------------------------------------------------
 
 struct VulkanVertexInputDescription
@@ -128,6 +252,15 @@ public:
 
 // ----------------------------------------------------------------------------------------------------------------------------
 
+// Tracks an upload made through VulkanUploadQueue. It has finished once the queue's timeline semaphore
+// reaches value; 0 means there was nothing to wait for.
+struct VulkanUploadTicket
+{
+	uint64_t value = 0;
+};
+
+// ----------------------------------------------------------------------------------------------------------------------------
+
 struct VulkanBuffer : public VulkanObject
 {
 private:
@@ -137,6 +270,12 @@ public:
 	VkBuffer buffer;
 	VmaAllocation allocation;
 
+	// Only set for BUFFER_TYPE_DYNAMIC_DATA buffers, which stay mapped for their whole lifetime
+	void* mappedData = nullptr;
+
+	// The most recent SetData that went through the upload queue
+	VulkanUploadTicket uploadTicket = {};
+
 	VulkanBuffer() {}
 	VulkanBuffer( VulkanRenderContext* parent, BufferInfo_t bufferInfo, VmaMemoryUsage memoryUsage );
 
@@ -260,13 +399,24 @@ public:
 	VkPipelineStageFlags currentStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
 	VkImageLayout currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-	VkImage image;
-	VmaAllocation allocation;
-	VkImageView imageView;
+	// Null until the first SetData
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+	VkImageView imageView = VK_NULL_HANDLE;
 	VkFormat format;
 
 	ImageTextureInfo_t textureInfo;
 
+	// The most recent SetData
+	VulkanUploadTicket uploadTicket = {};
+
+	// Bumped whenever image and imageView are re-created, so that descriptors still pointing at the old
+	// view know to rewrite themselves
+	uint32_t version = 0;
+
+	// The version that was last written to the bindless texture array, if any
+	uint32_t bindlessVersion = UINT32_MAX;
+
 	VulkanImageTexture() {}
 	VulkanImageTexture( VulkanRenderContext* parent, ImageTextureInfo_t _textureInfo );
 
@@ -279,6 +429,165 @@ public:
 
 // ----------------------------------------------------------------------------------------------------------------------------
 
+//
+// Secondary command buffers for one RecordParallel index. Only one thread records from a pool at a
+// time, so they don't need any locking.
+//
+struct VulkanSecondaryCommandPool
+{
+	VkCommandPool commandPool;
+
+	// Allocated as needed, and re-used each time the frame comes back around
+	std::vector<VkCommandBuffer> commandBuffers;
+	size_t usedCount = 0;
+};
+
+//
+// Everything a single frame in flight owns. The CPU records into one of these while the GPU is still
+// working through the others, so nothing in here can be shared between frames.
+//
+struct VulkanFrameContext
+{
+	VulkanCommandContext commandContext;
+	VkSemaphore presentSemaphore;
+	VkSemaphore renderSemaphore;
+
+	// Flushed once commandContext.fence has signalled, the next time this frame comes around
+	VulkanDeletionQueue deletionQueue = {};
+
+	// Per-instance data, see SetInstanceData. Grows as needed, never shrinks.
+	std::shared_ptr<VulkanBuffer> instanceBuffer;
+	size_t instanceBufferCapacity = 0;
+
+	// Uniform buffer holding RenderFrameConstants, and the descriptor set that points at it
+	std::shared_ptr<VulkanBuffer> frameConstantsBuffer;
+	VkDescriptorSet frameConstantsSet;
+
+	// The light list from SetLightData, also in frameConstantsSet. Capacities are in bytes; these grow
+	// as needed and never shrink.
+	std::shared_ptr<VulkanBuffer> lightBuffer;
+	size_t lightCapacity = 0;
+	std::shared_ptr<VulkanBuffer> lightClusterBuffer;
+	size_t lightClusterCapacity = 0;
+	std::shared_ptr<VulkanBuffer> lightIndexBuffer;
+	size_t lightIndexCapacity = 0;
+
+	// One per RecordParallel index, reset along with the frame
+	std::vector<VulkanSecondaryCommandPool> secondaryPools;
+
+	//
+	// GPU-driven mode only; see CullIndirectDraws. Capacities are in bytes, and like the instance buffer,
+	// these grow as needed and never shrink.
+	//
+	std::shared_ptr<VulkanBuffer> indirectDrawBuffer; // RenderIndirectDraw per draw
+	size_t indirectDrawCapacity = 0;
+	std::shared_ptr<VulkanBuffer> instanceDrawBuffer; // Draw index per instance
+	size_t instanceDrawCapacity = 0;
+	std::shared_ptr<VulkanBuffer> drawCountBuffer; // Visible instances per draw, then commands per group
+	size_t drawCountCapacity = 0;
+	std::shared_ptr<VulkanBuffer> drawCommandBuffer; // VkDrawIndexedIndirectCommand per draw
+	size_t drawCommandCapacity = 0;
+	std::shared_ptr<VulkanBuffer> culledInstanceBuffer; // Visible instances, grouped by draw
+	size_t culledInstanceCapacity = 0;
+
+	VkDescriptorSet cullSet = VK_NULL_HANDLE;
+	uint32_t indirectDrawCount = 0;
+
+	// What each of cullSet's bindings points at, so that a binding is only written again when its buffer
+	// has been replaced
+	VkBuffer cullSetBuffers[6] = {};
+};
+
+// ----------------------------------------------------------------------------------------------------------------------------
+
+//
+// Uploads buffer and image data through one persistently mapped staging ring, rather than creating a
+// staging buffer and waiting on a submit for every upload.
+//
+// Uploads are recorded into a shared batch which gets submitted once per frame (see Submit), on the
+// device's dedicated transfer queue if it has one. Each batch signals the next value on a timeline
+// semaphore, which the frame waits on GPU-side, so the CPU never has to. A batch's staging space is
+// reused once that value has been reached.
+//
+class VulkanUploadQueue : public VulkanObject
+{
+public:
+	// Records the copy out of the staging ring. Called with the queue locked, so keep it short.
+	using RecordFunc = std::function<void( VkCommandBuffer cmd, VkBuffer stagingBuffer, VkDeviceSize stagingOffset )>;
+
+private:
+	struct Batch
+	{
+		VkCommandPool commandPool;
+		VkCommandBuffer commandBuffer;
+		uint32_t uploadCount = 0;
+
+		// Timeline value that gets signalled once this batch has finished
+		uint64_t value = 0;
+
+		// Where the ring's head was when this batch was submitted
+		VkDeviceSize ringEnd = 0;
+
+		// Staging buffers for uploads that were too big for the ring
+		std::vector<VulkanBuffer> stagingBuffers;
+	};
+
+	std::mutex m_mutex;
+
+	VkQueue m_queue;
+	uint32_t m_queueFamily;
+	VkSemaphore m_timelineSemaphore;
+	uint64_t m_submittedValue = 0;
+
+	//
+	// The ring. Space between m_ringTail and m_ringHead (wrapping around) belongs to batches that
+	// haven't finished yet; m_ringHead == m_ringTail means the ring is empty.
+	//
+	VkBuffer m_ringBuffer;
+	VmaAllocation m_ringAllocation;
+	uint8_t* m_ringData;
+	VkDeviceSize m_ringSize;
+	VkDeviceSize m_ringHead = 0;
+	VkDeviceSize m_ringTail = 0;
+
+	bool m_hasOpenBatch = false;
+	Batch m_openBatch;
+	std::deque<Batch> m_submittedBatches;
+	std::vector<Batch> m_freeBatches;
+
+	bool TryAllocate( VkDeviceSize size, VkDeviceSize* outOffset );
+	void OpenBatch();
+	void SubmitOpenBatch();
+
+	// Hands back the staging space and command buffers of every batch that has finished
+	void RetireBatches( bool waitForOldest );
+
+	uint64_t GetCompletedValue() const;
+	void WaitForValue( uint64_t value ) const;
+
+public:
+	VulkanUploadQueue( VulkanRenderContext* parent, VkQueue queue, uint32_t queueFamily, VkDeviceSize ringSize );
+
+	// Copies size bytes of data into the staging ring, then calls record to copy it out again. Only blocks
+	// if the ring is full of uploads the GPU hasn't got to yet.
+	VulkanUploadTicket Upload( const void* data, VkDeviceSize size, RecordFunc record );
+
+	// Submits everything recorded since the last call. Returns the timeline value to wait on before using
+	// anything uploaded so far.
+	uint64_t Submit();
+
+	bool IsComplete( VulkanUploadTicket ticket ) const;
+
+	// Blocks until the upload has finished, submitting it first if it hasn't been already
+	void Wait( VulkanUploadTicket ticket );
+
+	inline VkSemaphore GetTimelineSemaphore() const { return m_timelineSemaphore; }
+
+	void Delete() const override;
+};
+
+// ----------------------------------------------------------------------------------------------------------------------------
+
 class VulkanSwapchain : public VulkanObject
 {
 private:
@@ -316,6 +625,20 @@ public:
 	VkDescriptorSet descriptorSet;
 	VkDescriptorSetLayout descriptorSetLayout;
 
+	// What descriptorSetLayout was made from. Pipelines are shared between descriptors whose layouts match.
+	std::vector<VkDescriptorType> bindingTypes;
+
+	// What was last written to each binding, so that UpdateDescriptor can skip writes that wouldn't
+	// change anything
+	struct BoundImage
+	{
+		Handle texture = HANDLE_INVALID;
+		uint32_t textureVersion = 0;
+		VkSampler sampler = VK_NULL_HANDLE;
+	};
+
+	std::vector<BoundImage> boundImages;
+
 	SamplerType samplerType;
 
 	VulkanDescriptor() {}
@@ -374,12 +697,28 @@ private:
 	VkPhysicalDeviceProperties m_deviceProperties;
 	VkQueue m_graphicsQueue;
 	uint32_t m_graphicsQueueFamily;
+
+	// Dedicated transfer queue if the device has one, otherwise the graphics queue again
+	VkQueue m_transferQueue;
+	uint32_t m_transferQueueFamily;
 	VkSurfaceKHR m_surface;
-	VkSemaphore m_presentSemaphore, m_renderSemaphore;
 	VkDescriptorPool m_descriptorPool;
 
 	std::unique_ptr<Window> m_window;
-	VulkanCommandContext m_mainContext;
+
+	// One per frame in flight, see render.frames_in_flight. m_frameIndex is the frame currently being
+	// recorded, or the one most recently submitted if we're between frames.
+	std::vector<VulkanFrameContext> m_frames;
+	uint32_t m_frameIndex = 0;
+
+	inline VulkanFrameContext& GetCurrentFrame() { return m_frames[m_frameIndex]; }
+
+	// Where commands should be recorded: the calling thread's secondary command buffer inside
+	// RecordParallel, or the current frame's primary command buffer everywhere else
+	VkCommandBuffer GetCommandBuffer();
+
+	// Blocks until the GPU has finished every frame in flight
+	void WaitForFrames();
 
 	std::shared_mutex m_uploadContextMutex;
 	std::unordered_map<std::thread::id, std::shared_ptr<VulkanCommandContext>> m_uploadContexts;
@@ -389,6 +728,25 @@ private:
 
 	std::shared_ptr<VulkanCommandContext> GetUploadContext( std::thread::id thread );
 
+	std::unique_ptr<VulkanUploadQueue> m_uploadQueue;
+
+	//
+	// Anything the upload queue writes to gets read on the graphics queue, so it needs sharing between
+	// both queue families if they're different
+	//
+	uint32_t m_uploadQueueFamilies[2];
+
+	template <typename T>
+	inline void SetUploadSharingMode( T& createInfo )
+	{
+		if ( m_transferQueueFamily == m_graphicsQueueFamily )
+			return;
+
+		createInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		createInfo.queueFamilyIndexCount = 2;
+		createInfo.pQueueFamilyIndices = m_uploadQueueFamilies;
+	}
+
 	// Create a Vulkan context, set up devices
 	vkb::Instance CreateInstanceAndSurface();
 	void FinalizeAndCreateDevice( vkb::PhysicalDevice physicalDevice );
@@ -400,9 +758,15 @@ private:
 	void CreateSwapchain();
 	void CreateCommands();
 	void CreateSyncStructures();
+	void CreateUploadQueue();
 	void CreateDescriptors();
 	void CreateSamplers();
 	void CreateRenderTargets();
+	void CreateFrameConstants();
+	void WriteFrameConstantsSet( VulkanFrameContext& frame );
+	void CreateBindlessTextures();
+	void CreatePipelineCache();
+	void CreateGpuCulling();
 
 	//
 	// ImGui initialization
@@ -432,9 +796,86 @@ private:
 	// Do we currently have a dynamic render pass instance active?
 	bool m_isRenderPassActive = false;
 
-	// Current pipeline. Used when binding descriptors
+	// What the active render pass is drawing to, so that RecordParallel can break it up and pick it
+	// up again
+	struct RenderPassTarget
+	{
+		VkImageView colorView;
+		VkImageView depthView;
+		VkFormat colorFormat;
+		VkFormat depthFormat;
+		Size2D size;
+	} m_renderPassTarget;
+
+	// Ends the active render pass and starts it again on the same target, keeping what's been drawn so
+	// far. flags decides whether the new pass is recorded inline or from secondary command buffers.
+	// recordBetween, if set, records anything that can't go inside a render pass (compute, for example)
+	// into the gap.
+	void RestartRenderPass( VkRenderingFlags flags, std::function<void( VkCommandBuffer cmd )> recordBetween = nullptr );
+
+	// Current pipeline, outside of RecordParallel. Used when binding descriptors
 	std::shared_ptr<VulkanPipeline> m_pipeline;
 
+	// The calling thread's current pipeline; see GetCommandBuffer
+	std::shared_ptr<VulkanPipeline>& GetBoundPipeline();
+
+	// Layout for each frame's frameConstantsSet. The current frame's set is bound at FRAME_CONSTANTS_SET
+	// whenever a pipeline is bound.
+	VkDescriptorSetLayout m_frameConstantsSetLayout;
+
+	// Fills in any set indices below FRAME_CONSTANTS_SET that a pipeline doesn't use
+	VkDescriptorSetLayout m_emptySetLayout;
+
+	//
+	// Bindless textures (render.bindless)
+	//
+	// Every image texture gets written into m_bindlessSet, at the slot index of its handle, the first
+	// time something asks for its index. The set is bound at BINDLESS_TEXTURES_SET along with every
+	// pipeline. It's update-after-bind, so new textures can be added while frames are in flight.
+	//
+	bool m_isBindless = false;
+	uint32_t m_bindlessTextureCapacity = 0;
+	VkDescriptorSetLayout m_bindlessSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool m_bindlessPool = VK_NULL_HANDLE;
+	VkDescriptorSet m_bindlessSet = VK_NULL_HANDLE;
+
+	//
+	// GPU-driven rendering (render.gpu_driven)
+	//
+	// CullIndirectDraws runs two compute passes over each frame's cullSet (see g_gpuCullingShaderCommon),
+	// and DrawIndirect draws the commands they leave behind with vkCmdDrawIndexedIndirectCount.
+	//
+	bool m_isGpuDriven = false;
+	VkDescriptorSetLayout m_cullSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout m_cullPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline m_cullInstancesPipeline = VK_NULL_HANDLE;
+	VkPipeline m_buildIndirectDrawsPipeline = VK_NULL_HANDLE;
+
+	// Whether the primary command buffer's instance binding is the culled instance buffer, which
+	// DrawIndirect reads, rather than the one SetInstanceData filled, which Draw reads
+	bool m_isCulledInstanceBufferBound = false;
+
+	// Makes sure one of the current frame's buffers can hold size bytes, replacing it if it can't
+	void ReserveFrameBuffer( std::shared_ptr<VulkanBuffer>& buffer, size_t& capacity, size_t size, BufferInfo_t bufferInfo,
+	    VmaMemoryUsage memoryUsage );
+
+	//
+	// Pipelines
+	//
+	// Every pipeline is created through m_pipelineCache, which is loaded from disk at startup and saved
+	// again at shutdown, so that the driver only has to compile each pipeline once.
+	//
+	// Pipelines are also shared: m_pipelineLookup maps GetPipelineKey to the first pipeline made from
+	// that info, and anything asking for the same thing again gets that instead. The whole key is
+	// kept and compared, so two different pipelines can't end up sharing one through a hash collision.
+	//
+	VkPipelineCache m_pipelineCache;
+	std::mutex m_pipelineMutex;
+	std::unordered_map<std::string, Handle> m_pipelineLookup;
+
+	std::string GetPipelineKey( const PipelineInfo_t& pipelineInfo );
+	void SavePipelineCache();
+
 	// Checks to see whether the current window size is valid for rendering.
 	inline bool CanRender();
 
@@ -481,11 +922,11 @@ private:
 	void CreateFullScreenTri();
 
 	/// <summary>
-	/// Everything in here will be deleted once the current frame ends.
-	/// If we're not currently rendering a frame, then everything will be
-	/// deleted when the next frame ends instead.
+	/// Everything in here will be deleted once the GPU has finished with the
+	/// current frame. If we're not currently rendering a frame, then it waits
+	/// on the frame that was most recently submitted instead.
 	/// </summary>
-	VulkanDeletionQueue m_frameDeletionQueue = {};
+	inline VulkanDeletionQueue& GetFrameDeletionQueue() { return m_frames[m_frameIndex].deletionQueue; }
 
 protected:
 	// ----------------------------------------
@@ -526,6 +967,7 @@ public:
 	friend VulkanBuffer;
 	friend VulkanSampler;
 	friend VulkanCommandContext;
+	friend VulkanUploadQueue;
 	friend VulkanImageTexture;
 	friend VulkanRenderTexture;
 	friend VulkanDescriptor;
@@ -564,7 +1006,28 @@ public:
 	RenderStatus BindConstants( RenderPushConstants p ) override;
 
 	/// <inheritdoc />
-	RenderStatus Draw( uint32_t vertexCount, uint32_t indexCount, uint32_t instanceCount ) override;
+	RenderStatus SetFrameConstants( const RenderFrameConstants& constants ) override;
+
+	/// <inheritdoc />
+	RenderStatus SetLightData( const std::vector<RenderLight>& lights, const std::vector<RenderLightCluster>& clusters,
+	    const std::vector<uint32_t>& lightIndices ) override;
+
+	/// <inheritdoc />
+	RenderStatus SetInstanceData( const std::vector<RenderInstanceData>& instances ) override;
+
+	/// <inheritdoc />
+	RenderStatus Draw( uint32_t vertexCount, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset,
+	    uint32_t instanceCount, uint32_t firstInstance ) override;
+
+	/// <inheritdoc />
+	RenderStatus RecordParallel( uint32_t count, std::function<void( uint32_t index )> func ) override;
+
+	/// <inheritdoc />
+	RenderStatus CullIndirectDraws( const std::vector<RenderIndirectDraw>& draws, const std::vector<uint32_t>& instanceDraws,
+	    const Frustum& frustum ) override;
+
+	/// <inheritdoc />
+	RenderStatus DrawIndirect( uint32_t firstDraw, uint32_t drawCount ) override;
 
 	/// <inheritdoc />
 	RenderStatus BindRenderTarget( RenderTexture rt ) override;
@@ -593,4 +1056,17 @@ public:
 
 	/// <inheritdoc />
 	RenderStatus GetImGuiTextureID( ImageTexture* texture, void** outTextureId ) override;
+
+	// ----------------------------------------
+
+	/// <inheritdoc />
+	bool IsBindless() override { return m_isBindless; }
+
+	/// <inheritdoc />
+	RenderStatus GetBindlessTextureIndex( ImageTexture* texture, uint32_t* outIndex ) override;
+
+	// ----------------------------------------
+
+	/// <inheritdoc />
+	bool IsGpuDriven() override { return m_isGpuDriven; }
 };
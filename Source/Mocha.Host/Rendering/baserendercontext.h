@@ -2,8 +2,10 @@
 #include <Entities/baseentity.h>
 #include <Misc/cvarmanager.h>
 #include <Misc/defs.h>
+#include <Rendering/frustum.h>
 #include <Util/util.h>
 #include <cstdint>
+#include <functional>
 #include <string>
 
 // ----------------------------------------------------------------------------------------------------
@@ -50,7 +52,9 @@ enum BufferType
 {
 	BUFFER_TYPE_STAGING,
 	BUFFER_TYPE_VERTEX_INDEX_DATA,
-	BUFFER_TYPE_UNIFORM_DATA
+	BUFFER_TYPE_UNIFORM_DATA,
+	BUFFER_TYPE_DYNAMIC_DATA, // Rewritten by the CPU every frame; stays mapped and is written to directly
+	BUFFER_TYPE_GPU_DATA      // Only ever written by the GPU
 };
 
 enum DescriptorBindingType
@@ -73,13 +77,16 @@ enum BufferUsageFlags
 	BUFFER_USAGE_FLAG_INDEX_BUFFER = 1 << 2,
 	BUFFER_USAGE_FLAG_UNIFORM_BUFFER = 1 << 3,
 	BUFFER_USAGE_FLAG_TRANSFER_SRC = 1 << 4,
-	BUFFER_USAGE_FLAG_TRANSFER_DST = 1 << 5
+	BUFFER_USAGE_FLAG_TRANSFER_DST = 1 << 5,
+	BUFFER_USAGE_FLAG_STORAGE_BUFFER = 1 << 6,
+	BUFFER_USAGE_FLAG_INDIRECT_BUFFER = 1 << 7
 };
 
 enum ShaderType
 {
 	SHADER_TYPE_VERTEX,
-	SHADER_TYPE_FRAGMENT
+	SHADER_TYPE_FRAGMENT,
+	SHADER_TYPE_COMPUTE
 };
 
 DEFINE_FLAG_OPERATORS( BufferUsageFlags );
@@ -140,6 +147,9 @@ struct BufferInfo_t
 struct BufferUploadInfo_t
 {
 	UtilArray data = {};
+
+	// Where in the buffer to write data, in bytes
+	uint32_t offset = 0;
 };
 
 struct DescriptorBindingInfo_t
@@ -184,18 +194,106 @@ struct PipelineInfo_t
 	bool renderToSwapchain = false;
 };
 
+// Per-draw constants. What these mean is up to the shader; anything that's the same for the whole
+// frame belongs in RenderFrameConstants, and per-object transforms come from RenderInstanceData.
 struct RenderPushConstants
 {
 	glm::vec4 data = glm::vec4{ 1.0f };
+};
 
-	glm::mat4 modelMatrix = glm::mat4{ 1.0f };
-
-	glm::mat4 renderMatrix = glm::mat4{ 1.0f };
+// Constants that are the same for every draw in a frame. These live in a uniform buffer that's
+// bound at FRAME_CONSTANTS_SET (binding 0) for every pipeline, so the layout must match std140.
+struct RenderFrameConstants
+{
+	glm::mat4 viewProjMatrix = glm::mat4{ 1.0f };
 
 	glm::vec3 cameraPos = glm::vec3{ 1.0f };
 	float time = 0.0f;
 
-	glm::vec4 vLightInfoWS[4] = {};
+	glm::vec4 data = glm::vec4{ 1.0f };
+
+	//
+	// Clustered lighting; see LightManager
+	//
+	glm::mat4 viewMatrix = glm::mat4{ 1.0f };
+
+	// xy: clusters per pixel. zw: scale and bias that turn log( view depth ) into a depth slice
+	glm::vec4 clusterScaleBias = {};
+
+	// xyz: clusters along each axis. w: light count
+	glm::uvec4 clusterGrid = {};
+};
+
+// Descriptor sets below this belong to pipelines (see PipelineInfo_t::descriptors)
+constexpr uint32_t FRAME_CONSTANTS_SET = 1;
+
+// The frame constants set also holds the light list, as storage buffers at these bindings (see SetLightData)
+constexpr uint32_t LIGHTS_BINDING = 1;
+constexpr uint32_t LIGHT_CLUSTERS_BINDING = 2;
+constexpr uint32_t LIGHT_INDICES_BINDING = 3;
+
+// A point light, as shaders see it. The layout must match std430.
+struct RenderLight
+{
+	// World space position, and the distance at which the light fades out completely
+	glm::vec4 positionRadius = {};
+
+	// Linear colour, and intensity
+	glm::vec4 colorIntensity = {};
+};
+
+// The lights touching one cluster: light indices [offset, offset + count)
+struct RenderLightCluster
+{
+	uint32_t offset = 0;
+	uint32_t count = 0;
+};
+
+// In bindless mode (render.bindless), every texture lives in one array bound here, as
+// "layout( set = 2, binding = 0 ) uniform sampler2D g_textures[]". Shaders with a bindless variant
+// (compiled with BINDLESS defined) index the array with the material's texture indices from
+// RenderInstanceData, and their materials don't get descriptors of their own. Any other shader keeps
+// sampling its material's descriptor at set 0.
+constexpr uint32_t BINDLESS_TEXTURES_SET = 2;
+
+// How many textures a material can pass to bindless shaders
+constexpr uint32_t MAX_INSTANCE_TEXTURES = 8;
+
+// Per-instance data, read by the vertex shader from its own vertex binding.
+// The model matrix takes up four consecutive locations, starting at INSTANCE_ATTRIBUTE_LOCATION, so
+// shaders can't use more vertex attributes than that. The texture indices follow it, as two uvec4s.
+struct RenderInstanceData
+{
+	glm::mat4 modelMatrix = glm::mat4{ 1.0f };
+
+	// Bindless mode only: indices into the bindless texture array, in the same order as the
+	// material's textures
+	glm::uvec4 textureIndices[MAX_INSTANCE_TEXTURES / 4] = {};
+};
+
+constexpr uint32_t INSTANCE_ATTRIBUTE_LOCATION = 8;
+
+// One draw for the GPU-driven path (see CullIndirectDraws): a mesh, and the run of instances that might
+// draw it. Read by a compute shader, so the layout must match std430.
+struct RenderIndirectDraw
+{
+	uint32_t indexCount = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+
+	// Instances [firstInstance, firstInstance + however many pass culling) are drawn
+	uint32_t firstInstance = 0;
+
+	// The mesh's object-space bounding sphere: xyz is the centre, w the radius
+	glm::vec4 boundingSphere = {};
+
+	// The first draw in this draw's group; see DrawIndirect
+	uint32_t groupFirstDraw = 0;
+
+	// 0 if this draw's instances should never be culled (when render.culling is off, for example)
+	uint32_t cull = 1;
+
+	uint32_t padding[2] = {};
 };
 
 struct GPUInfo
@@ -436,7 +534,9 @@ public:
 	virtual RenderStatus BindDescriptor( Descriptor d ) = 0;
 
 	/// <summary>
-	/// Updates a descriptor
+	/// Points one of a descriptor's bindings at a texture. Does nothing if it already points at that
+	/// texture, so this is cheap to call every frame. Can be called outside of BeginRendering, but must
+	/// not be called on a descriptor that's already bound this frame.
 	/// </summary>
 	/// <returns><b>RENDER_STATUS_OK</b> if successful, otherwise an error code</returns>
 	virtual RenderStatus UpdateDescriptor( Descriptor d, DescriptorUpdateInfo_t updateInfo ) = 0;
@@ -460,10 +560,65 @@ public:
 	virtual RenderStatus BindConstants( RenderPushConstants p ) = 0;
 
 	/// <summary>
-	/// Draws the contents of the vertex and/or index buffer
+	/// Uploads the constants for this frame. These are bound along with every pipeline, so this only
+	/// needs calling once, before anything is drawn.
+	/// </summary>
+	/// <returns><b>RENDER_STATUS_OK</b> if successful, otherwise an error code</returns>
+	virtual RenderStatus SetFrameConstants( const RenderFrameConstants& constants ) = 0;
+
+	/// <summary>
+	/// Uploads this frame's lights, and which of them touch each cluster, for every pipeline to read
+	/// alongside the frame constants. Like SetFrameConstants, call this before anything is bound.
+	/// </summary>
+	/// <returns><b>RENDER_STATUS_OK</b> if successful, otherwise an error code</returns>
+	virtual RenderStatus SetLightData( const std::vector<RenderLight>& lights, const std::vector<RenderLightCluster>& clusters,
+	    const std::vector<uint32_t>& lightIndices ) = 0;
+
+	/// <summary>
+	/// Uploads per-instance data for the rest of this frame, replacing anything set previously.
+	/// Draw calls read instances [firstInstance, firstInstance + instanceCount) from this.
 	/// </summary>
 	/// <returns><b>RENDER_STATUS_OK</b> if successful, otherwise an error code</returns>
-	virtual RenderStatus Draw( uint32_t vertexCount, uint32_t indexCount, uint32_t instanceCount ) = 0;
+	virtual RenderStatus SetInstanceData( const std::vector<RenderInstanceData>& instances ) = 0;
+
+	/// <summary>
+	/// Draws indexCount indices from the bound index buffer, starting at firstIndex. vertexOffset is
+	/// added to every index before it's used to read the bound vertex buffer, so that several meshes can
+	/// share the same buffers.
+	/// </summary>
+	/// <returns><b>RENDER_STATUS_OK</b> if successful, otherwise an error code</returns>
+	virtual RenderStatus Draw( uint32_t vertexCount, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset,
+	    uint32_t instanceCount, uint32_t firstInstance ) = 0;
+
+	/// <summary>
+	/// Records draws into the current render target from several threads at once. func is called once
+	/// for each index in [0, count), across the job system, and everything it records goes into a
+	/// command list of its own. Those are then played back in index order, so the result is the same
+	/// as calling func for each index in turn.
+	/// Inside func, only the Bind* functions and Draw may be called, and nothing is bound to begin with.
+	/// </summary>
+	/// <returns><b>RENDER_STATUS_OK</b> if successful, otherwise an error code</returns>
+	virtual RenderStatus RecordParallel( uint32_t count, std::function<void( uint32_t index )> func ) = 0;
+
+	/// <summary>
+	/// GPU-driven mode only. Frustum-culls the first instanceDraws.size() instances from SetInstanceData
+	/// on the GPU, then builds indirect draw commands for whatever survives. instanceDraws[i] is the
+	/// index in draws that instance i belongs to. Draws are grouped by their groupFirstDraw; each group
+	/// must be contiguous, and is drawn with one DrawIndirect. Call this once, after SetInstanceData and
+	/// before DrawIndirect. Surviving instances, and the draws within a group, don't keep their order;
+	/// anything that needs to should be drawn with Draw afterwards, which still reads every instance.
+	/// </summary>
+	/// <returns><b>RENDER_STATUS_OK</b> if successful, otherwise an error code</returns>
+	virtual RenderStatus CullIndirectDraws( const std::vector<RenderIndirectDraw>& draws,
+	    const std::vector<uint32_t>& instanceDraws, const Frustum& frustum ) = 0;
+
+	/// <summary>
+	/// GPU-driven mode only. Draws the group of draws [firstDraw, firstDraw + drawCount) from the last
+	/// CullIndirectDraws in a single call, skipping any that had nothing visible. Every draw in the group
+	/// must use the currently bound pipeline, descriptor, vertex buffer and index buffer.
+	/// </summary>
+	/// <returns><b>RENDER_STATUS_OK</b> if successful, otherwise an error code</returns>
+	virtual RenderStatus DrawIndirect( uint32_t firstDraw, uint32_t drawCount ) = 0;
 
 	/// <summary>
 	/// Call this to set the render target to render to.
@@ -508,6 +663,33 @@ public:
 	/// <returns><b>RENDER_STATUS_OK</b> if successful, otherwise an error code</returns>
 	virtual RenderStatus GetImGuiTextureID( ImageTexture* texture, void** outTextureId ) = 0;
 
+	// ----------------------------------------
+	// Bindless
+	// ----------------------------------------
+
+	/// <summary>
+	/// Was this context started in bindless mode? If so, materials whose shaders have a bindless
+	/// variant don't use descriptors; they find their textures through GetBindlessTextureIndex instead.
+	/// </summary>
+	virtual bool IsBindless() = 0;
+
+	/// <summary>
+	/// This will return where a texture lives in the bindless texture array, making sure that the
+	/// array is pointing at its current data. Only valid in bindless mode.
+	/// </summary>
+	/// <returns><b>RENDER_STATUS_OK</b> if successful, otherwise an error code</returns>
+	virtual RenderStatus GetBindlessTextureIndex( ImageTexture* texture, uint32_t* outIndex ) = 0;
+
+	// ----------------------------------------
+	// GPU-driven rendering
+	// ----------------------------------------
+
+	/// <summary>
+	/// Was this context started in GPU-driven mode? If so, CullIndirectDraws and DrawIndirect can be
+	/// used in place of Draw.
+	/// </summary>
+	virtual bool IsGpuDriven() = 0;
+
 	// ----------------------------------------
 	// Windowing
 	// ----------------------------------------
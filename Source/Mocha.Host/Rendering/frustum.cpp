@@ -0,0 +1,98 @@
+#include "frustum.h"
+
+#include <emmintrin.h>
+
+Frustum Frustum::FromMatrix( const glm::mat4& viewProjMatrix )
+{
+	// Gribb / Hartmann: each plane is the last row of the matrix plus or minus one of the others.
+	// glm is column-major, so row i is ( m[0][i], m[1][i], m[2][i], m[3][i] ).
+	auto row = [&]( int i ) {
+		return glm::vec4( viewProjMatrix[0][i], viewProjMatrix[1][i], viewProjMatrix[2][i], viewProjMatrix[3][i] );
+	};
+
+	Frustum frustum = {};
+	frustum.planes[0] = row( 3 ) + row( 0 ); // Left
+	frustum.planes[1] = row( 3 ) - row( 0 ); // Right
+	frustum.planes[2] = row( 3 ) + row( 1 ); // Bottom
+	frustum.planes[3] = row( 3 ) - row( 1 ); // Top
+	frustum.planes[4] = row( 3 ) + row( 2 ); // Near
+	frustum.planes[5] = row( 3 ) - row( 2 ); // Far
+
+	// Normalize so that plane distances are in world units, and can be compared against radii
+	for ( glm::vec4& plane : frustum.planes )
+		plane /= glm::length( glm::vec3( plane ) );
+
+	return frustum;
+}
+
+void BoundingSphereBatch::Clear()
+{
+	m_centerX.clear();
+	m_centerY.clear();
+	m_centerZ.clear();
+	m_radius.clear();
+}
+
+void BoundingSphereBatch::Add( const glm::vec3& center, float radius )
+{
+	m_centerX.push_back( center.x );
+	m_centerY.push_back( center.y );
+	m_centerZ.push_back( center.z );
+	m_radius.push_back( radius );
+}
+
+void BoundingSphereBatch::Cull( const Frustum& frustum, std::vector<uint8_t>& outVisible ) const
+{
+	const size_t count = GetCount();
+	outVisible.resize( count );
+
+	const float* centerX = m_centerX.data();
+	const float* centerY = m_centerY.data();
+	const float* centerZ = m_centerZ.data();
+	const float* radius = m_radius.data();
+
+	//
+	// Four spheres at a time. A sphere is outside if it's entirely behind any one plane.
+	//
+	size_t i = 0;
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		const __m128 x = _mm_loadu_ps( centerX + i );
+		const __m128 y = _mm_loadu_ps( centerY + i );
+		const __m128 z = _mm_loadu_ps( centerZ + i );
+		const __m128 negativeRadius = _mm_sub_ps( _mm_setzero_ps(), _mm_loadu_ps( radius + i ) );
+
+		__m128 inside = _mm_castsi128_ps( _mm_set1_epi32( -1 ) );
+
+		for ( const glm::vec4& plane : frustum.planes )
+		{
+			__m128 distance = _mm_add_ps( _mm_mul_ps( x, _mm_set1_ps( plane.x ) ), _mm_mul_ps( y, _mm_set1_ps( plane.y ) ) );
+			distance = _mm_add_ps( distance, _mm_add_ps( _mm_mul_ps( z, _mm_set1_ps( plane.z ) ), _mm_set1_ps( plane.w ) ) );
+
+			inside = _mm_and_ps( inside, _mm_cmpge_ps( distance, negativeRadius ) );
+		}
+
+		const int mask = _mm_movemask_ps( inside );
+
+		outVisible[i + 0] = ( mask >> 0 ) & 1;
+		outVisible[i + 1] = ( mask >> 1 ) & 1;
+		outVisible[i + 2] = ( mask >> 2 ) & 1;
+		outVisible[i + 3] = ( mask >> 3 ) & 1;
+	}
+
+	//
+	// Leftovers
+	//
+	for ( ; i < count; ++i )
+	{
+		bool isInside = true;
+
+		for ( const glm::vec4& plane : frustum.planes )
+		{
+			float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+			isInside &= distance >= -radius[i];
+		}
+
+		outVisible[i] = isInside ? 1 : 0;
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+//
+// View frustum, as six planes facing inwards. A point p is on the inside of plane i if
+// dot( planes[i].xyz, p ) + planes[i].w >= 0.
+//
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	// Extracts the planes from a view projection matrix.
+	static Frustum FromMatrix( const glm::mat4& viewProjMatrix );
+};
+
+//
+// World-space bounding spheres, packed one component per array so that they can be tested against a
+// frustum four at a time.
+//
+class BoundingSphereBatch
+{
+private:
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_radius;
+
+public:
+	void Clear();
+	void Add( const glm::vec3& center, float radius );
+
+	inline size_t GetCount() const { return m_radius.size(); }
+
+	// Sets outVisible[i] to 1 for every sphere that's at least partly inside the frustum, and 0 for
+	// the rest.
+	void Cull( const Frustum& frustum, std::vector<uint8_t>& outVisible ) const;
+};
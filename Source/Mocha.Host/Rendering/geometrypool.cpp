@@ -0,0 +1,175 @@
+#include "geometrypool.h"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+RangeAllocator::RangeAllocator( uint32_t size )
+    : m_size( size )
+{
+	m_freeRanges[0] = size;
+}
+
+bool RangeAllocator::Allocate( uint32_t size, uint32_t alignment, uint32_t* outOffset )
+{
+	for ( auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it )
+	{
+		const uint64_t rangeStart = it->first;
+		const uint64_t rangeEnd = rangeStart + it->second;
+
+		const uint64_t start = ( ( rangeStart + alignment - 1 ) / alignment ) * alignment;
+		const uint64_t end = start + size;
+
+		if ( end > rangeEnd )
+			continue;
+
+		// Whatever's left either side of the allocation stays free
+		m_freeRanges.erase( it );
+
+		if ( start > rangeStart )
+			m_freeRanges[static_cast<uint32_t>( rangeStart )] = static_cast<uint32_t>( start - rangeStart );
+
+		if ( end < rangeEnd )
+			m_freeRanges[static_cast<uint32_t>( end )] = static_cast<uint32_t>( rangeEnd - end );
+
+		*outOffset = static_cast<uint32_t>( start );
+		return true;
+	}
+
+	return false;
+}
+
+void RangeAllocator::Free( uint32_t offset, uint32_t size )
+{
+	auto next = m_freeRanges.lower_bound( offset );
+
+	// Merge with the free range after this one...
+	if ( next != m_freeRanges.end() && offset + size == next->first )
+	{
+		size += next->second;
+		next = m_freeRanges.erase( next );
+	}
+
+	// ...and the one before
+	if ( next != m_freeRanges.begin() )
+	{
+		auto prev = std::prev( next );
+
+		if ( prev->first + prev->second == offset )
+		{
+			prev->second += size;
+			return;
+		}
+	}
+
+	m_freeRanges.emplace_hint( next, offset, size );
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+template <typename TBuffer>
+uint32_t GeometryPool::AllocateRange( std::vector<Page<TBuffer>>& pages, uint32_t size, uint32_t alignment,
+    uint32_t pageSize, const char* name, BufferUsageFlags usage, uint32_t* outOffset )
+{
+	for ( uint32_t i = 0; i < pages.size(); ++i )
+	{
+		if ( pages[i].allocator.Allocate( size, alignment, outOffset ) )
+			return i;
+	}
+
+	// Nothing has room; start a new page. Anything too big for a normal page gets one to itself
+	Page<TBuffer> page = {};
+	page.allocator = RangeAllocator( std::max( size, pageSize ) );
+
+	BufferInfo_t bufferInfo = {};
+	bufferInfo.name = fmt::format( "{} {}", name, pages.size() );
+	bufferInfo.size = page.allocator.GetSize();
+	bufferInfo.type = BUFFER_TYPE_VERTEX_INDEX_DATA;
+	bufferInfo.usage = usage | BUFFER_USAGE_FLAG_TRANSFER_DST;
+	page.buffer = TBuffer( bufferInfo );
+
+	// Always fits, since the page is empty and at least this big
+	page.allocator.Allocate( size, alignment, outOffset );
+
+	pages.push_back( page );
+	return static_cast<uint32_t>( pages.size() - 1 );
+}
+
+void GeometryPool::Release( const GeometryAllocation& allocation )
+{
+	if ( allocation.vertexByteSize > 0 )
+		m_vertexPages[allocation.vertexPage].allocator.Free( allocation.vertexByteOffset, allocation.vertexByteSize );
+
+	if ( allocation.indexByteSize > 0 )
+		m_indexPages[allocation.indexPage].allocator.Free( allocation.indexByteOffset, allocation.indexByteSize );
+}
+
+std::shared_ptr<GeometryAllocation> GeometryPool::Upload( UtilArray vertices, UtilArray indices )
+{
+	// Freed ranges wait out the frames in flight before they can be handed out again
+	auto retire = [this]( GeometryAllocation* allocation ) {
+		{
+			std::lock_guard lock( m_mutex );
+			m_retired.push_back( { *allocation, m_frame } );
+		}
+
+		delete allocation;
+	};
+
+	std::shared_ptr<GeometryAllocation> allocation( new GeometryAllocation(), retire );
+
+	// Vertices need to start on a whole vertex, so that vertexOffset can point at them
+	const uint32_t stride = static_cast<uint32_t>( vertices.size / vertices.count );
+
+	{
+		std::lock_guard lock( m_mutex );
+
+		allocation->id = m_nextId++;
+
+		allocation->vertexByteSize = static_cast<uint32_t>( vertices.size );
+		allocation->vertexPage = AllocateRange( m_vertexPages, allocation->vertexByteSize, stride, VERTEX_PAGE_SIZE,
+		    "Geometry pool vertex buffer", BUFFER_USAGE_FLAG_VERTEX_BUFFER, &allocation->vertexByteOffset );
+
+		allocation->vertexBuffer = m_vertexPages[allocation->vertexPage].buffer;
+		allocation->vertexOffset = static_cast<int32_t>( allocation->vertexByteOffset / stride );
+
+		if ( indices.size > 0 )
+		{
+			allocation->indexByteSize = static_cast<uint32_t>( indices.size );
+			allocation->indexPage = AllocateRange( m_indexPages, allocation->indexByteSize, sizeof( uint32_t ),
+			    INDEX_PAGE_SIZE, "Geometry pool index buffer", BUFFER_USAGE_FLAG_INDEX_BUFFER,
+			    &allocation->indexByteOffset );
+
+			allocation->indexBuffer = m_indexPages[allocation->indexPage].buffer;
+			allocation->firstIndex = allocation->indexByteOffset / sizeof( uint32_t );
+		}
+	}
+
+	// Nobody else can touch these ranges, so there's no need to hold the lock while copying
+	BufferUploadInfo_t vertexUploadInfo = {};
+	vertexUploadInfo.data = vertices;
+	vertexUploadInfo.offset = allocation->vertexByteOffset;
+	allocation->vertexBuffer.Upload( vertexUploadInfo );
+
+	if ( indices.size > 0 )
+	{
+		BufferUploadInfo_t indexUploadInfo = {};
+		indexUploadInfo.data = indices;
+		indexUploadInfo.offset = allocation->indexByteOffset;
+		allocation->indexBuffer.Upload( indexUploadInfo );
+	}
+
+	return allocation;
+}
+
+void GeometryPool::NextFrame()
+{
+	std::lock_guard lock( m_mutex );
+
+	m_frame++;
+
+	while ( !m_retired.empty() && m_retired.front().frame + FRAMES_BEFORE_REUSE <= m_frame )
+	{
+		Release( m_retired.front().allocation );
+		m_retired.pop_front();
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <Rendering/baserendercontext.h>
+#include <Util/utilarray.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+//
+// Hands out ranges of a fixed-size space, first fit. Free ranges are kept sorted by offset and merged
+// with their neighbours when they come back, so that the space doesn't break up into unusable slivers.
+//
+class RangeAllocator
+{
+private:
+	uint32_t m_size = 0;
+
+	// Offset -> size
+	std::map<uint32_t, uint32_t> m_freeRanges;
+
+public:
+	RangeAllocator() {}
+	RangeAllocator( uint32_t size );
+
+	// Finds size bytes starting at a multiple of alignment, which doesn't have to be a power of two.
+	// Returns false if there isn't a free range big enough.
+	bool Allocate( uint32_t size, uint32_t alignment, uint32_t* outOffset );
+
+	// Gives back a range from Allocate.
+	void Free( uint32_t offset, uint32_t size );
+
+	inline uint32_t GetSize() const { return m_size; }
+};
+
+// A mesh's share of the geometry pool.
+struct GeometryAllocation
+{
+	// The shared buffers this mesh lives in
+	VertexBuffer vertexBuffer;
+	IndexBuffer indexBuffer;
+
+	// Where the mesh starts within them, in vertices and indices; pass these to Draw
+	int32_t vertexOffset = 0;
+	uint32_t firstIndex = 0;
+
+	// Unique for every allocation, so that draws of the same geometry can be grouped together
+	uint32_t id = 0;
+
+	// Which page and byte range each part came from, so that they can be given back
+	uint32_t vertexPage = 0;
+	uint32_t vertexByteOffset = 0;
+	uint32_t vertexByteSize = 0;
+
+	uint32_t indexPage = 0;
+	uint32_t indexByteOffset = 0;
+	uint32_t indexByteSize = 0;
+};
+
+//
+// Keeps mesh geometry in a few large vertex and index buffers that everything shares, rather than
+// a pair of buffers per mesh. Consecutive draws can then use the same buffer bindings, and there are
+// far fewer allocations for the render context to look after.
+//
+class GeometryPool
+{
+private:
+	// Every page is this big, unless a single mesh needs more than that
+	static constexpr uint32_t VERTEX_PAGE_SIZE = 64 * 1024 * 1024;
+	static constexpr uint32_t INDEX_PAGE_SIZE = 32 * 1024 * 1024;
+
+	// Frames still on the GPU might be drawing from a range after it's freed, so it isn't handed out
+	// again until this many frames later; more than render.frames_in_flight can ever be
+	static constexpr uint64_t FRAMES_BEFORE_REUSE = 8;
+
+	template <typename TBuffer>
+	struct Page
+	{
+		TBuffer buffer;
+		RangeAllocator allocator;
+	};
+
+	struct RetiredAllocation
+	{
+		GeometryAllocation allocation;
+		uint64_t frame;
+	};
+
+	std::vector<Page<VertexBuffer>> m_vertexPages;
+	std::vector<Page<IndexBuffer>> m_indexPages;
+
+	// Freed, but possibly still in use by the GPU. Oldest first
+	std::deque<RetiredAllocation> m_retired;
+
+	uint64_t m_frame = 0;
+	uint32_t m_nextId = 0;
+
+	std::mutex m_mutex;
+
+	// Finds a range in the first page with room, adding a page if none have any. Returns the page index.
+	// The caller must hold m_mutex.
+	template <typename TBuffer>
+	uint32_t AllocateRange( std::vector<Page<TBuffer>>& pages, uint32_t size, uint32_t alignment, uint32_t pageSize,
+	    const char* name, BufferUsageFlags usage, uint32_t* outOffset );
+
+	// The caller must hold m_mutex.
+	void Release( const GeometryAllocation& allocation );
+
+public:
+	// Copies a mesh's vertices and (optional) indices into the pool. The ranges are given back once the
+	// last reference to the allocation goes away.
+	std::shared_ptr<GeometryAllocation> Upload( UtilArray vertices, UtilArray indices );
+
+	// Call once a frame. Hands freed ranges back out once nothing can be using them any more.
+	void NextFrame();
+};
@@ -0,0 +1,203 @@
+#include "lightmanager.h"
+
+#include <Entities/entitymanager.h>
+#include <Entities/lightentity.h>
+#include <Misc/globalvars.h>
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+
+// Tiles are tested four at a time, and a slice never shares a group with the next one
+static_assert( LightManager::CLUSTERS_PER_SLICE % 4 == 0, "Each slice needs a multiple of 4 clusters" );
+
+void LightManager::BuildClusterBounds( const ProjectionInfo& projection )
+{
+	m_projection = projection;
+	m_hasClusterBounds = true;
+
+	const float logDepthRange = std::log( projection.zFar / projection.zNear );
+	m_sliceScale = CLUSTERS_Z / logDepthRange;
+	m_sliceBias = -( CLUSTERS_Z * std::log( projection.zNear ) ) / logDepthRange;
+
+	m_sliceDepths.resize( CLUSTERS_Z + 1 );
+
+	for ( uint32_t z = 0; z <= CLUSTERS_Z; ++z )
+		m_sliceDepths[z] = projection.zNear * std::pow( projection.zFar / projection.zNear, ( float )z / CLUSTERS_Z );
+
+	m_clusterMinX.resize( CLUSTER_COUNT );
+	m_clusterMaxX.resize( CLUSTER_COUNT );
+	m_clusterMinY.resize( CLUSTER_COUNT );
+	m_clusterMaxY.resize( CLUSTER_COUNT );
+
+	//
+	// A tile covers a fixed range of NDC, which at view space depth d is ndc * d / scale. The sides of
+	// the cluster slope outwards, so the box has to cover the tile at both the near and far depth
+	//
+	for ( uint32_t z = 0; z < CLUSTERS_Z; ++z )
+	{
+		const float nearDepth = m_sliceDepths[z];
+		const float farDepth = m_sliceDepths[z + 1];
+
+		for ( uint32_t y = 0; y < CLUSTERS_Y; ++y )
+		{
+			const float ndcMinY = -1.0f + 2.0f * y / CLUSTERS_Y;
+			const float ndcMaxY = -1.0f + 2.0f * ( y + 1 ) / CLUSTERS_Y;
+
+			for ( uint32_t x = 0; x < CLUSTERS_X; ++x )
+			{
+				const float ndcMinX = -1.0f + 2.0f * x / CLUSTERS_X;
+				const float ndcMaxX = -1.0f + 2.0f * ( x + 1 ) / CLUSTERS_X;
+
+				const uint32_t cluster = x + y * CLUSTERS_X + z * CLUSTERS_PER_SLICE;
+
+				m_clusterMinX[cluster] = std::min( ndcMinX * nearDepth, ndcMinX * farDepth ) / projection.xScale;
+				m_clusterMaxX[cluster] = std::max( ndcMaxX * nearDepth, ndcMaxX * farDepth ) / projection.xScale;
+				m_clusterMinY[cluster] = std::min( ndcMinY * nearDepth, ndcMinY * farDepth ) / projection.yScale;
+				m_clusterMaxY[cluster] = std::max( ndcMaxY * nearDepth, ndcMaxY * farDepth ) / projection.yScale;
+			}
+		}
+	}
+}
+
+uint32_t LightManager::GetSlice( float depth ) const
+{
+	if ( depth <= m_projection.zNear )
+		return 0;
+
+	const float slice = std::log( depth ) * m_sliceScale + m_sliceBias;
+	return std::min( static_cast<uint32_t>( slice ), CLUSTERS_Z - 1 );
+}
+
+void LightManager::AssignLight( uint32_t lightIndex, const glm::vec3& viewPosition, float radius )
+{
+	// The camera looks down -z in view space
+	const float depth = -viewPosition.z;
+
+	if ( depth + radius < m_projection.zNear || depth - radius > m_projection.zFar )
+		return;
+
+	const uint32_t firstSlice = GetSlice( depth - radius );
+	const uint32_t lastSlice = GetSlice( depth + radius );
+
+	const float radiusSquared = radius * radius;
+
+	const __m128 centerX = _mm_set1_ps( viewPosition.x );
+	const __m128 centerY = _mm_set1_ps( viewPosition.y );
+	const __m128 zero = _mm_setzero_ps();
+
+	for ( uint32_t z = firstSlice; z <= lastSlice; ++z )
+	{
+		// Every cluster in a slice covers the same depths, so this part of the distance is shared
+		const float minZ = -m_sliceDepths[z + 1];
+		const float maxZ = -m_sliceDepths[z];
+		const float distanceZ = std::max( { minZ - viewPosition.z, viewPosition.z - maxZ, 0.0f } );
+		const float distanceZSquared = distanceZ * distanceZ;
+
+		if ( distanceZSquared > radiusSquared )
+			continue;
+
+		const __m128 remaining = _mm_set1_ps( radiusSquared - distanceZSquared );
+		const uint32_t sliceStart = z * CLUSTERS_PER_SLICE;
+
+		//
+		// Four clusters at a time. The light touches a cluster if the nearest point in the cluster's box
+		// is within its radius
+		//
+		for ( uint32_t i = sliceStart; i < sliceStart + CLUSTERS_PER_SLICE; i += 4 )
+		{
+			const __m128 minX = _mm_loadu_ps( m_clusterMinX.data() + i );
+			const __m128 maxX = _mm_loadu_ps( m_clusterMaxX.data() + i );
+			const __m128 minY = _mm_loadu_ps( m_clusterMinY.data() + i );
+			const __m128 maxY = _mm_loadu_ps( m_clusterMaxY.data() + i );
+
+			const __m128 distanceX = _mm_max_ps( _mm_max_ps( _mm_sub_ps( minX, centerX ), _mm_sub_ps( centerX, maxX ) ), zero );
+			const __m128 distanceY = _mm_max_ps( _mm_max_ps( _mm_sub_ps( minY, centerY ), _mm_sub_ps( centerY, maxY ) ), zero );
+
+			const __m128 distanceSquared =
+			    _mm_add_ps( _mm_mul_ps( distanceX, distanceX ), _mm_mul_ps( distanceY, distanceY ) );
+
+			int mask = _mm_movemask_ps( _mm_cmple_ps( distanceSquared, remaining ) );
+
+			for ( uint32_t j = 0; mask != 0; ++j, mask >>= 1 )
+			{
+				if ( mask & 1 )
+					m_hits.push_back( { i + j, lightIndex } );
+			}
+		}
+	}
+}
+
+void LightManager::Update(
+    const glm::mat4& viewMatrix, const glm::mat4& projMatrix, float zNear, float zFar, Size2D renderSize )
+{
+	m_viewMatrix = viewMatrix;
+	m_renderSize = renderSize;
+
+	m_lights.clear();
+	m_lightIndices.clear();
+	m_hits.clear();
+	m_clusters.assign( CLUSTER_COUNT, {} );
+
+	// Nothing sensible to slice up; draw everything unlit rather than divide by zero
+	if ( zNear <= 0.0f || zFar <= zNear )
+		return;
+
+	ProjectionInfo projection = { projMatrix[0][0], projMatrix[1][1], zNear, zFar };
+
+	if ( !m_hasClusterBounds || !( projection == m_projection ) )
+		BuildClusterBounds( projection );
+
+	Globals::m_entityManager->ForEachSpecific<LightEntity>( [&]( LightEntity* entity ) {
+		const float radius = entity->GetRadius();
+		const float intensity = entity->GetIntensity();
+
+		if ( radius <= 0.0f || intensity <= 0.0f )
+			return;
+
+		const glm::vec3 position = entity->GetTransform().position.ToGLM();
+		const uint32_t lightIndex = static_cast<uint32_t>( m_lights.size() );
+
+		RenderLight light = {};
+		light.positionRadius = glm::vec4( position, radius );
+		light.colorIntensity = glm::vec4( entity->GetColor().ToGLM(), intensity );
+		m_lights.push_back( light );
+
+		AssignLight( lightIndex, glm::vec3( viewMatrix * glm::vec4( position, 1.0f ) ), radius );
+	} );
+
+	//
+	// Turn the hits into one list per cluster, packed together: count them up, work out where each
+	// cluster's list starts, then fill them in. Lights stay in the order they were gathered
+	//
+	for ( const ClusterHit& hit : m_hits )
+		m_clusters[hit.cluster].count++;
+
+	uint32_t offset = 0;
+
+	for ( RenderLightCluster& cluster : m_clusters )
+	{
+		cluster.offset = offset;
+		offset += cluster.count;
+		cluster.count = 0;
+	}
+
+	m_lightIndices.resize( m_hits.size() );
+
+	for ( const ClusterHit& hit : m_hits )
+	{
+		RenderLightCluster& cluster = m_clusters[hit.cluster];
+		m_lightIndices[cluster.offset + cluster.count++] = hit.light;
+	}
+}
+
+void LightManager::FillFrameConstants( RenderFrameConstants& constants ) const
+{
+	constants.viewMatrix = m_viewMatrix;
+
+	if ( m_renderSize.x == 0 || m_renderSize.y == 0 )
+		return;
+
+	constants.clusterScaleBias = glm::vec4( ( float )CLUSTERS_X / m_renderSize.x, ( float )CLUSTERS_Y / m_renderSize.y,
+	    m_sliceScale, m_sliceBias );
+	constants.clusterGrid = glm::uvec4( CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, static_cast<uint32_t>( m_lights.size() ) );
+}
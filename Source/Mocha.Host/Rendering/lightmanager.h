@@ -0,0 +1,97 @@
+#pragma once
+#include <Misc/mathtypes.h>
+#include <Rendering/baserendercontext.h>
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+//
+// Gathers every LightEntity once a frame and works out which lights touch which parts of the view, so
+// that each pixel only has to consider the handful of lights near it rather than all of them.
+//
+// The view is split into a grid of clusters: CLUSTERS_X * CLUSTERS_Y screen tiles, each cut into
+// CLUSTERS_Z depth slices. Slices are spaced logarithmically between the near and far planes, so that
+// clusters stay roughly cube-shaped. Every light's range is tested against the view space bounds of
+// each cluster it could reach, and each cluster ends up with a list of the lights touching it.
+//
+// Clusters are numbered x + y * CLUSTERS_X + z * CLUSTERS_X * CLUSTERS_Y, with y = 0 at the top of the
+// screen and z = 0 nearest the camera.
+//
+class LightManager
+{
+public:
+	static constexpr uint32_t CLUSTERS_X = 16;
+	static constexpr uint32_t CLUSTERS_Y = 9;
+	static constexpr uint32_t CLUSTERS_Z = 24;
+
+	static constexpr uint32_t CLUSTERS_PER_SLICE = CLUSTERS_X * CLUSTERS_Y;
+	static constexpr uint32_t CLUSTER_COUNT = CLUSTERS_PER_SLICE * CLUSTERS_Z;
+
+private:
+	// Cluster bounds only depend on the projection, so they're kept until it changes
+	struct ProjectionInfo
+	{
+		float xScale = 0.0f;
+		float yScale = 0.0f;
+		float zNear = 0.0f;
+		float zFar = 0.0f;
+
+		bool operator==( const ProjectionInfo& other ) const
+		{
+			return xScale == other.xScale && yScale == other.yScale && zNear == other.zNear && zFar == other.zFar;
+		}
+	};
+
+	// A light touching a cluster, before the lists are put together
+	struct ClusterHit
+	{
+		uint32_t cluster;
+		uint32_t light;
+	};
+
+	ProjectionInfo m_projection = {};
+	bool m_hasClusterBounds = false;
+
+	// View space bounds of every cluster, one component per array so that four can be tested at once
+	std::vector<float> m_clusterMinX;
+	std::vector<float> m_clusterMaxX;
+	std::vector<float> m_clusterMinY;
+	std::vector<float> m_clusterMaxY;
+
+	// View space depth (distance in front of the camera) at which each slice starts; CLUSTERS_Z + 1 entries
+	std::vector<float> m_sliceDepths;
+
+	// Turns log( view depth ) into a slice: slice = log( depth ) * m_sliceScale + m_sliceBias
+	float m_sliceScale = 0.0f;
+	float m_sliceBias = 0.0f;
+
+	glm::mat4 m_viewMatrix = glm::mat4{ 1.0f };
+	Size2D m_renderSize = {};
+
+	std::vector<RenderLight> m_lights;
+	std::vector<RenderLightCluster> m_clusters;
+	std::vector<uint32_t> m_lightIndices;
+
+	// Scratch space for Update
+	std::vector<ClusterHit> m_hits;
+
+	void BuildClusterBounds( const ProjectionInfo& projection );
+
+	// Which slice a view space depth falls in, clamped to the grid
+	uint32_t GetSlice( float depth ) const;
+
+	// Finds the clusters a light reaches and appends them to m_hits
+	void AssignLight( uint32_t lightIndex, const glm::vec3& viewPosition, float radius );
+
+public:
+	// Gathers this frame's lights and bins them into clusters for this camera.
+	void Update( const glm::mat4& viewMatrix, const glm::mat4& projMatrix, float zNear, float zFar, Size2D renderSize );
+
+	// Fills in the clustered lighting part of the frame constants, to match the last Update.
+	void FillFrameConstants( RenderFrameConstants& constants ) const;
+
+	// Results of the last Update, ready for SetLightData
+	inline const std::vector<RenderLight>& GetLights() const { return m_lights; }
+	inline const std::vector<RenderLightCluster>& GetClusters() const { return m_clusters; }
+	inline const std::vector<uint32_t>& GetLightIndices() const { return m_lightIndices; }
+};
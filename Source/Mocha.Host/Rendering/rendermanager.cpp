@@ -9,6 +9,8 @@
 #include <Managed/hostmanager.h>
 #include <Misc/cvarmanager.h>
 #include <Misc/defs.h>
+#include <Misc/globalvars.h>
+#include <Misc/jobmanager.h>
 #include <Misc/projectmanager.h>
 #include <Physics/physicsmanager.h>
 #include <Root/clientroot.h>
@@ -33,6 +35,7 @@
 //
 //
 #include <Rendering/Platform/Null/nullrendercontext.h>
+#include <Rendering/Platform/Recording/recordingrendercontext.h>
 #include <Rendering/Platform/Vulkan/vulkanrendercontext.h>
 
 //
@@ -46,7 +49,15 @@
 FloatCVar maxFramerate(
     "render.max_framerate", 144.0f, CVarFlags::Archive, "The maximum framerate at which the game should run." );
 
-void RenderManager::RenderMesh( RenderPushConstants constants, Mesh* mesh )
+BoolCVar renderCulling( "render.culling", true, CVarFlags::None, "Skip drawing meshes that are outside the view frustum" );
+
+BoolCVar renderParallelRecording( "render.parallel_recording", true, CVarFlags::Archive,
+    "Record draw calls on several threads at once when there are enough of them" );
+
+// Handing a range to another thread isn't free; below this many batches it's quicker to record them here
+static constexpr size_t MIN_BATCHES_PER_RECORDING_RANGE = 64;
+
+bool RenderManager::PrepareMaterial( Mesh* mesh )
 {
 	bool materialWasDirty = false;
 
@@ -67,33 +78,290 @@ void RenderManager::RenderMesh( RenderPushConstants constants, Mesh* mesh )
 	{
 		spdlog::error( "Material pipeline was INVALID. Was material dirty? {}", materialWasDirty );
 		__debugbreak();
+		return false;
+	}
+
+	return true;
+}
+
+bool RenderManager::CanInstance( const DrawBatch& batch, const RenderItem& item )
+{
+	// Different layers must be drawn separately, so that they stay in order
+	if ( ( batch.sortKey >> 60 ) != ( item.sortKey >> 60 ) )
+		return false;
+
+	if ( batch.mesh == item.mesh )
+		return true;
+
+	const Material* a = batch.mesh->material;
+	const Material* b = item.mesh->material;
+
+	// One instanced draw can only cover one piece of geometry, drawn with one pipeline
+	if ( batch.mesh->geometry != item.mesh->geometry || a->m_pipeline.m_handle != b->m_pipeline.m_handle )
+		return false;
+
+	// Bindless materials share a pipeline whenever their shaders match, and each instance carries its
+	// own texture indices, so their textures don't matter here
+	if ( a->IsBindless() && b->IsBindless() )
+		return true;
+
+	return a->m_descriptor.m_handle == b->m_descriptor.m_handle;
+}
+
+void RenderManager::SubmitRenderQueue( const Frustum& frustum )
+{
+	m_renderQueue.Sort();
+
+	//
+	// Catch up on any textures that have changed since each material's bindings were written. This has
+	// to happen before anything is bound, since a descriptor set can't be written once a command buffer
+	// is using it. It also has to happen before the instance data is filled in, in bindless mode.
+	//
+	m_frameMaterials.clear();
+
+	for ( size_t i = 0; i < m_renderQueue.GetCount(); ++i )
+		m_frameMaterials.push_back( m_renderQueue.GetSorted( i ).mesh->material );
+
+	std::sort( m_frameMaterials.begin(), m_frameMaterials.end() );
+	m_frameMaterials.erase( std::unique( m_frameMaterials.begin(), m_frameMaterials.end() ), m_frameMaterials.end() );
+
+	for ( Material* material : m_frameMaterials )
+		material->UpdateTextureBindings();
+
+	//
+	// Sorting puts identical mesh + material pairs next to each other. Merge each run into a single
+	// batch, with its instances laid out one after another in the instance buffer.
+	//
+	m_drawBatches.clear();
+	m_instanceData.clear();
+	m_instanceData.reserve( m_renderQueue.GetCount() );
+
+	for ( size_t i = 0; i < m_renderQueue.GetCount(); ++i )
+	{
+		const RenderItem& item = m_renderQueue.GetSorted( i );
+
+		if ( m_drawBatches.empty() || !CanInstance( m_drawBatches.back(), item ) )
+			m_drawBatches.push_back( { item.sortKey, item.mesh, static_cast<uint32_t>( m_instanceData.size() ), 0 } );
+
+		RenderInstanceData instance = {};
+		instance.modelMatrix = item.modelMatrix;
+		std::copy( std::begin( item.mesh->material->m_textureIndices ), std::end( item.mesh->material->m_textureIndices ),
+		    instance.textureIndices );
+		m_instanceData.push_back( instance );
+
+		m_drawBatches.back().instanceCount++;
+	}
+
+	m_renderContext->SetInstanceData( m_instanceData );
+
+	if ( m_renderContext->IsGpuDriven() )
+	{
+		//
+		// The GPU packs instances and draws in whatever order its threads finish, which only works for
+		// layers that are depth tested. UI is blended, so it's drawn from here in sorted order instead.
+		// Layers sort in order, so everything from the first ordered batch on goes this way.
+		//
+		auto firstOrderedBatch = std::find_if( m_drawBatches.begin(), m_drawBatches.end(),
+		    []( const DrawBatch& batch ) { return IsOrderedLayer( static_cast<RenderLayer>( batch.sortKey >> 60 ) ); } );
+		size_t indirectBatchCount = static_cast<size_t>( firstOrderedBatch - m_drawBatches.begin() );
+
+		RecordIndirectBatches( frustum, indirectBatchCount );
+		RecordBatches( indirectBatchCount, m_drawBatches.size(), m_renderStats );
+		return;
+	}
+
+	//
+	// Split the batches into contiguous ranges and record each on its own thread. The ranges are executed
+	// in order, so the draws still happen in sorted order.
+	//
+	size_t rangeCount = std::clamp<size_t>( m_drawBatches.size() / MIN_BATCHES_PER_RECORDING_RANGE, 1,
+	    static_cast<size_t>( Globals::m_jobManager->GetThreadCount() ) );
+
+	if ( !renderParallelRecording || rangeCount == 1 )
+	{
+		RecordBatches( 0, m_drawBatches.size(), m_renderStats );
+		return;
+	}
+
+	m_rangeStats.assign( rangeCount, {} );
+
+	m_renderContext->RecordParallel( static_cast<uint32_t>( rangeCount ), [&]( uint32_t range ) {
+		size_t start = m_drawBatches.size() * range / rangeCount;
+		size_t end = m_drawBatches.size() * ( range + 1 ) / rangeCount;
+
+		RecordBatches( start, end, m_rangeStats[range] );
+	} );
+
+	for ( const RenderStats& stats : m_rangeStats )
+	{
+		m_renderStats.drawCalls += stats.drawCalls;
+		m_renderStats.instances += stats.instances;
+		m_renderStats.pipelineBinds += stats.pipelineBinds;
+		m_renderStats.descriptorBinds += stats.descriptorBinds;
+		m_renderStats.vertexBufferBinds += stats.vertexBufferBinds;
+		m_renderStats.indexBufferBinds += stats.indexBufferBinds;
+		m_renderStats.skippedBinds += stats.skippedBinds;
+	}
+}
+
+void RenderManager::BindMeshState( const Mesh* mesh, BoundState& bound, RenderStats& stats )
+{
+	const Material* material = mesh->material;
+
+	if ( material->m_pipeline.m_handle != bound.pipeline )
+	{
+		m_renderContext->BindPipeline( material->m_pipeline );
+		bound.pipeline = material->m_pipeline.m_handle;
+		stats.pipelineBinds++;
+
+		// Descriptor sets are bound against the pipeline layout, so they need binding again
+		bound.descriptor = HANDLE_INVALID;
+	}
+	else
+	{
+		stats.skippedBinds++;
+	}
+
+	if ( material->m_descriptor.m_handle != bound.descriptor )
+	{
+		m_renderContext->BindDescriptor( material->m_descriptor );
+		bound.descriptor = material->m_descriptor.m_handle;
+		stats.descriptorBinds++;
+	}
+	else
+	{
+		stats.skippedBinds++;
+	}
+
+	// Most meshes share a handful of geometry pool buffers, so these rarely change
+	const GeometryAllocation& geometry = *mesh->geometry;
+
+	if ( geometry.vertexBuffer.m_handle != bound.vertexBuffer )
+	{
+		m_renderContext->BindVertexBuffer( geometry.vertexBuffer );
+		bound.vertexBuffer = geometry.vertexBuffer.m_handle;
+		stats.vertexBufferBinds++;
+	}
+	else
+	{
+		stats.skippedBinds++;
 	}
 
-	m_renderContext->BindPipeline( mesh->material->m_pipeline );
-	m_renderContext->BindDescriptor( mesh->material->m_descriptor );
+	if ( geometry.indexBuffer.m_handle != bound.indexBuffer )
+	{
+		m_renderContext->BindIndexBuffer( geometry.indexBuffer );
+		bound.indexBuffer = geometry.indexBuffer.m_handle;
+		stats.indexBufferBinds++;
+	}
+	else
+	{
+		stats.skippedBinds++;
+	}
+}
+
+void RenderManager::RecordBatches( size_t start, size_t end, RenderStats& stats )
+{
+	BoundState bound = {};
 
-	for ( int i = 0; i < mesh->material->m_textures.size(); ++i )
+	for ( size_t i = start; i < end; ++i )
 	{
-		DescriptorUpdateInfo_t updateInfo = {};
-		updateInfo.binding = i;
-		updateInfo.samplerType = SAMPLER_TYPE_ANISOTROPIC;
-		updateInfo.src = &mesh->material->m_textures[i].m_image;
+		const DrawBatch& batch = m_drawBatches[i];
+		const Mesh* mesh = batch.mesh;
+		const GeometryAllocation& geometry = *mesh->geometry;
+
+		BindMeshState( mesh, bound, stats );
+
+		m_renderContext->Draw( mesh->vertices.count, mesh->indices.count, geometry.firstIndex, geometry.vertexOffset,
+		    batch.instanceCount, batch.firstInstance );
+		stats.drawCalls++;
+		stats.instances += batch.instanceCount;
+	}
+}
+
+void RenderManager::RecordIndirectBatches( const Frustum& frustum, size_t batchCount )
+{
+	if ( batchCount == 0 )
+		return;
+
+	// Batches can only share a DrawIndirect if nothing needs binding between them, and they're in the
+	// same layer; the GPU is free to reorder the draws within a group
+	auto canGroup = []( const DrawBatch& a, const DrawBatch& b ) {
+		const Material* materialA = a.mesh->material;
+		const Material* materialB = b.mesh->material;
+
+		return ( a.sortKey >> 60 ) == ( b.sortKey >> 60 ) &&
+		       materialA->m_pipeline.m_handle == materialB->m_pipeline.m_handle &&
+		       materialA->m_descriptor.m_handle == materialB->m_descriptor.m_handle &&
+		       a.mesh->geometry->vertexBuffer.m_handle == b.mesh->geometry->vertexBuffer.m_handle &&
+		       a.mesh->geometry->indexBuffer.m_handle == b.mesh->geometry->indexBuffer.m_handle;
+	};
+
+	//
+	// One indirect draw per batch, pointing at the batch's instances. Instances are laid out in batch
+	// order, so these batches' instances are the first ones in the instance buffer
+	//
+	const DrawBatch& lastBatch = m_drawBatches[batchCount - 1];
+
+	m_indirectDraws.resize( batchCount );
+	m_instanceDraws.resize( lastBatch.firstInstance + lastBatch.instanceCount );
+
+	uint32_t groupFirstDraw = 0;
 
-		m_renderContext->UpdateDescriptor( mesh->material->m_descriptor, updateInfo );
+	for ( uint32_t i = 0; i < batchCount; ++i )
+	{
+		const DrawBatch& batch = m_drawBatches[i];
+		const Mesh* mesh = batch.mesh;
+
+		if ( i > 0 && !canGroup( m_drawBatches[groupFirstDraw], batch ) )
+			groupFirstDraw = i;
+
+		RenderIndirectDraw& draw = m_indirectDraws[i];
+		draw.indexCount = mesh->indices.count;
+		draw.firstIndex = mesh->geometry->firstIndex;
+		draw.vertexOffset = mesh->geometry->vertexOffset;
+		draw.firstInstance = batch.firstInstance;
+		draw.boundingSphere = glm::vec4( mesh->bounds.center, mesh->bounds.radius );
+		draw.groupFirstDraw = groupFirstDraw;
+		draw.cull = renderCulling;
+
+		std::fill_n( m_instanceDraws.begin() + batch.firstInstance, batch.instanceCount, i );
+		m_renderStats.instances += batch.instanceCount;
 	}
 
-	m_renderContext->BindConstants( constants );
-	m_renderContext->BindVertexBuffer( mesh->vertexBuffer );
-	m_renderContext->BindIndexBuffer( mesh->indexBuffer );
+	m_renderContext->CullIndirectDraws( m_indirectDraws, m_instanceDraws, frustum );
+
+	//
+	// Then one call for each group
+	//
+	BoundState bound = {};
+
+	for ( uint32_t first = 0; first < batchCount; )
+	{
+		uint32_t last = first + 1;
+
+		while ( last < batchCount && m_indirectDraws[last].groupFirstDraw == first )
+			last++;
+
+		BindMeshState( m_drawBatches[first].mesh, bound, m_renderStats );
 
-	m_renderContext->Draw( mesh->vertices.count, mesh->indices.count, 1 );
+		m_renderContext->DrawIndirect( first, last - first );
+		m_renderStats.drawCalls++;
+
+		first = last;
+	}
 }
 
 void RenderManager::Startup()
 {
 	Globals::m_renderManager = this;
 
-	if ( Globals::m_executingRealm == REALM_CLIENT )
+	if ( EngineProperties::Recording )
+	{
+		// No GPU needed - record everything in memory, on either realm
+		m_renderContext = std::make_unique<RecordingRenderContext>();
+		m_isRecording = true;
+	}
+	else if ( Globals::m_executingRealm == REALM_CLIENT )
 	{
 		// Client uses Vulkan for rendering
 		m_renderContext = std::make_unique<VulkanRenderContext>();
@@ -114,43 +382,30 @@ void RenderManager::Shutdown()
 	m_renderContext->Shutdown();
 }
 
-void RenderManager::RenderEntity( ModelEntity* entity )
+void RenderManager::QueueEntity( ModelEntity* entity )
 {
-	// Create and bind constants
-	RenderPushConstants constants = {};
-	constants.modelMatrix = entity->m_transform.GetModelMatrix();
-	constants.renderMatrix = CalculateViewProjMatrix() * constants.modelMatrix;
-	constants.cameraPos = Globals::m_cameraPos.ToGLM();
-	constants.time = Globals::m_curTime;
-	constants.data.x = ( int )Globals::m_debugView;
+	RenderLayer layer = RENDER_LAYER_WORLD;
 
-	std::vector<Vector3> lightPositions = {};
-	lightPositions.push_back( { 0, 4, 2 } );
-	lightPositions.push_back( { 4, 4, 2 } );
-	lightPositions.push_back( { 0, -4, 2 } );
-	lightPositions.push_back( { -4, 4, 2 } );
+	if ( entity->HasFlag( EntityFlags::ENTITY_UI ) )
+		layer = RENDER_LAYER_UI;
+	else if ( entity->HasFlag( EntityFlags::ENTITY_VIEWMODEL ) )
+		layer = RENDER_LAYER_VIEWMODEL;
 
-	std::vector<glm::vec4> packedLightInfo = {};
-	for ( int i = 0; i < 4; ++i )
-	{
-		packedLightInfo.push_back( { lightPositions[i].x, lightPositions[i].y, lightPositions[i].z, 50.0f } );
-	}
-
-	constants.vLightInfoWS[0] = packedLightInfo[0];
-	constants.vLightInfoWS[1] = packedLightInfo[1];
-	constants.vLightInfoWS[2] = packedLightInfo[2];
-	constants.vLightInfoWS[3] = packedLightInfo[3];
+	glm::mat4 modelMatrix = entity->GetTransform().GetModelMatrix();
 
 	for ( auto& mesh : entity->GetModel()->m_meshes )
 	{
-		RenderMesh( constants, &mesh );
+		if ( !PrepareMaterial( &mesh ) )
+			continue;
+
+		m_renderQueue.Add( layer, &mesh, modelMatrix );
 	}
 }
 
 void RenderManager::DrawOverlaysAndEditor()
 {
-	// Server is headless - no overlays or editor
-	if ( Globals::m_executingRealm == REALM_SERVER )
+	// Server is headless - no overlays or editor. Neither is there a window to put them in when recording
+	if ( Globals::m_executingRealm == REALM_SERVER || m_isRecording )
 		return;
 
 	m_renderContext->BeginImGui();
@@ -165,8 +420,10 @@ void RenderManager::DrawOverlaysAndEditor()
 
 void RenderManager::DrawGame()
 {
-	// Server is headless - don't render
-	if ( Globals::m_executingRealm == REALM_SERVER )
+	m_geometryPool.NextFrame();
+
+	// Server is headless - don't render, unless it's recording to profile the shared code
+	if ( Globals::m_executingRealm == REALM_SERVER && !m_isRecording )
 		return;
 
 	RenderStatus res = m_renderContext->BeginRendering();
@@ -174,29 +431,52 @@ void RenderManager::DrawGame()
 	if ( res == RENDER_STATUS_WINDOW_SIZE_INVALID )
 		return;
 
-	auto viewProjMatrix = CalculateViewProjMatrix();
-	auto viewmodelViewProjMatrix = CalculateViewmodelViewProjMatrix();
+	m_renderStats = {};
 
-	Globals::m_entityManager->ForEachSpecific<ModelEntity>( [&]( std::shared_ptr<ModelEntity> entity ) {
-		if ( !entity->HasFlag( EntityFlags::ENTITY_VIEWMODEL ) && !entity->HasFlag( EntityFlags::ENTITY_UI ) )
-			RenderEntity( entity.get() );
-	} );
+	//
+	// Everything that's the same for every object this frame. Worked out once, and uploaded once;
+	// every pipeline reads it from the same uniform buffer
+	//
+	glm::mat4 viewMatrix = CalculateViewMatrix();
+	glm::mat4 projMatrix = CalculateProjMatrix();
+
+	RenderFrameConstants frameConstants = {};
+	frameConstants.viewProjMatrix = projMatrix * viewMatrix;
+	frameConstants.cameraPos = Globals::m_cameraPos.ToGLM();
+	frameConstants.time = Globals::m_curTime;
+	frameConstants.data.x = ( int )Globals::m_debugView;
 
 	//
-	// Render viewmodels
+	// Work out which lights touch which clusters, so that pixels only light themselves with the
+	// lights nearby
 	//
-	Globals::m_entityManager->ForEachSpecific<ModelEntity>( [&]( std::shared_ptr<ModelEntity> entity ) {
-		if ( entity->HasFlag( EntityFlags::ENTITY_VIEWMODEL ) )
-			RenderEntity( entity.get() );
-	} );
+	m_lightManager.Update( viewMatrix, projMatrix, Globals::m_cameraZNear, Globals::m_cameraZFar, GetWindowExtent() );
+	m_lightManager.FillFrameConstants( frameConstants );
+	m_renderStats.lights = static_cast<int>( m_lightManager.GetLights().size() );
+
+	m_renderContext->SetFrameConstants( frameConstants );
+	m_renderContext->SetLightData(
+	    m_lightManager.GetLights(), m_lightManager.GetClusters(), m_lightManager.GetLightIndices() );
 
 	//
-	// Render UI last
+	// Collect everything (world, viewmodels, UI) in one pass; the queue's sort puts the layers in
+	// the right order
 	//
-	Globals::m_entityManager->ForEachSpecific<ModelEntity>( [&]( std::shared_ptr<ModelEntity> entity ) {
-		if ( entity->HasFlag( EntityFlags::ENTITY_UI ) )
-			RenderEntity( entity.get() );
-	} );
+	m_renderQueue.Clear();
+	Globals::m_entityManager->ForEachSpecific<ModelEntity>( [&]( ModelEntity* entity ) { QueueEntity( entity ); } );
+
+	//
+	// Throw away anything the camera can't see before we bind or draw anything. In GPU-driven mode
+	// this happens on the GPU instead, once everything's been handed over
+	//
+	Frustum frustum = Frustum::FromMatrix( frameConstants.viewProjMatrix );
+
+	if ( renderCulling && !m_renderContext->IsGpuDriven() )
+		m_renderStats.culledMeshes = static_cast<int>( m_renderQueue.Cull( frustum ) );
+
+	m_renderStats.visibleMeshes = static_cast<int>( m_renderQueue.GetCount() );
+
+	SubmitRenderQueue( frustum );
 
 	m_renderContext->EndRendering();
 }
@@ -218,20 +498,19 @@ glm::mat4 RenderManager::CalculateViewmodelViewProjMatrix()
 	return projMatrix * viewMatrix;
 }
 
-glm::mat4 RenderManager::CalculateViewProjMatrix()
+glm::mat4 RenderManager::CalculateViewMatrix()
 {
-	glm::mat4 viewMatrix, projMatrix;
-
-	auto extent = GetWindowExtent();
-	float aspect = ( float )extent.x / ( float )extent.y;
-
 	glm::vec3 up = glm::vec3( 0, 0, -1 );
 	glm::vec3 direction = glm::normalize( glm::rotate( Globals::m_cameraRot.ToGLM(), glm::vec3( 1, 0, 0 ) ) );
 	glm::vec3 position = Globals::m_cameraPos.ToGLM();
 
-	viewMatrix = glm::lookAt( position, position + direction, up );
-	projMatrix =
-	    glm::perspective( glm::radians( Globals::m_cameraFov ), aspect, Globals::m_cameraZNear, Globals::m_cameraZFar );
+	return glm::lookAt( position, position + direction, up );
+}
 
-	return projMatrix * viewMatrix;
+glm::mat4 RenderManager::CalculateProjMatrix()
+{
+	auto extent = GetWindowExtent();
+	float aspect = ( float )extent.x / ( float )extent.y;
+
+	return glm::perspective( glm::radians( Globals::m_cameraFov ), aspect, Globals::m_cameraZNear, Globals::m_cameraZFar );
 }
@@ -3,28 +3,124 @@
 #include <Misc/defs.h>
 #include <Misc/subsystem.h>
 #include <Rendering/baserendercontext.h>
+#include <Rendering/geometrypool.h>
+#include <Rendering/lightmanager.h>
+#include <Rendering/renderqueue.h>
 #include <Rendering/window.h>
 #include <functional>
 #include <glm/glm.hpp>
 #include <imgui.h>
 #include <vector>
 
+class Material;
 class ModelEntity;
 
+// Per-frame counters, reset at the start of every DrawGame
+struct RenderStats
+{
+	int drawCalls;
+
+	// Objects drawn; each draw call can cover several of these through instancing
+	int instances;
+
+	// Meshes that survived frustum culling, and meshes that didn't. In GPU-driven mode culling happens
+	// on the GPU, so every queued mesh counts as visible
+	int visibleMeshes;
+	int culledMeshes;
+
+	// State changes that were actually sent to the render context
+	int pipelineBinds;
+	int descriptorBinds;
+	int vertexBufferBinds;
+	int indexBufferBinds;
+
+	// State changes that were skipped because the same state was already bound
+	int skippedBinds;
+
+	// Lights gathered for clustered lighting
+	int lights;
+};
+
 class RenderManager : ISubSystem
 {
 private:
+	// A run of render queue items that share a mesh and material, drawn with one instanced call. Bindless
+	// materials only need to share a pipeline and geometry, since textures come from the instances.
+	struct DrawBatch
+	{
+		uint64_t sortKey;
+		Mesh* mesh;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+	};
+
+	// What's currently bound while recording. Everything starts off unknown, so the first mesh binds
+	// everything.
+	struct BoundState
+	{
+		Handle pipeline = HANDLE_INVALID;
+		Handle descriptor = HANDLE_INVALID;
+		Handle vertexBuffer = HANDLE_INVALID;
+		Handle indexBuffer = HANDLE_INVALID;
+	};
+
 	std::unique_ptr<BaseRenderContext> m_renderContext;
 
-	glm::mat4x4 CalculateViewProjMatrix();
+	// Using a RecordingRenderContext (render.recording)? There's no window or GPU, but DrawGame still runs
+	bool m_isRecording = false;
+
+	GeometryPool m_geometryPool;
+	LightManager m_lightManager;
+	RenderQueue m_renderQueue;
+	RenderStats m_renderStats = {};
+
+	// Rebuilt from the render queue every frame; kept around to avoid reallocating
+	std::vector<DrawBatch> m_drawBatches;
+	std::vector<RenderInstanceData> m_instanceData;
+
+	// Every material in the render queue this frame, once each
+	std::vector<Material*> m_frameMaterials;
+
+	// Counters for each range of batches recorded in parallel, added to m_renderStats afterwards
+	std::vector<RenderStats> m_rangeStats;
+
+	// GPU-driven mode only: one indirect draw per batch, and which batch each instance belongs to
+	std::vector<RenderIndirectDraw> m_indirectDraws;
+	std::vector<uint32_t> m_instanceDraws;
+
+	glm::mat4x4 CalculateViewMatrix();
+	glm::mat4x4 CalculateProjMatrix();
 	glm::mat4x4 CalculateViewmodelViewProjMatrix();
 
-	void RenderEntity( ModelEntity* entity );
+	// Makes sure a mesh's material has its resources created. Returns false if the mesh can't be drawn.
+	bool PrepareMaterial( Mesh* mesh );
+
+	// Can this item be drawn as another instance of this batch?
+	static bool CanInstance( const DrawBatch& batch, const RenderItem& item );
+
+	// Adds every mesh in an entity's model to the render queue.
+	void QueueEntity( ModelEntity* entity );
 
-	// Render a mesh. This will handle all the pipelines, descriptors, buffers, etc. for you - just call
-	// this once and it'll do all the work.
-	// Note that this will render to whatever render target is currently bound (see BindRenderTarget).
-	void RenderMesh( RenderPushConstants constants, Mesh* mesh );
+	// Sorts and draws everything in the render queue, instancing repeated mesh + material pairs and
+	// skipping any binds that match what's already bound. Large queues are recorded across several
+	// threads, or in GPU-driven mode culled against the frustum and drawn indirectly. Note that this
+	// will render to whatever render target is currently bound (see BindRenderTarget).
+	void SubmitRenderQueue( const Frustum& frustum );
+
+	// Binds whatever a mesh needs that isn't already bound.
+	void BindMeshState( const Mesh* mesh, BoundState& bound, RenderStats& stats );
+
+	// Records draws for m_drawBatches[start, end). Nothing is assumed to be bound beforehand, so this
+	// is safe to call for any range on any thread.
+	void RecordBatches( size_t start, size_t end, RenderStats& stats );
+
+	// GPU-driven mode: culls the instances of m_drawBatches[0, batchCount) on the GPU, then draws each
+	// run of batches that share all their state with a single DrawIndirect.
+	void RecordIndirectBatches( const Frustum& frustum, size_t batchCount );
+
+	// Whether a layer's draws have to happen in the order they were sorted, which GPU-driven mode
+	// doesn't keep to.
+	static bool IsOrderedLayer( RenderLayer layer ) { return layer == RENDER_LAYER_UI; }
 
 public:
 	void Startup();
@@ -40,6 +136,11 @@ public:
 		return info.gpuName;
 	}
 
+	const RenderStats& GetRenderStats() const { return m_renderStats; }
+
+	// Where every mesh's vertices and indices go
+	GeometryPool& GetGeometryPool() { return m_geometryPool; }
+
 	Size2D GetWindowExtent()
 	{
 		Size2D size{};
@@ -0,0 +1,96 @@
+#include "renderqueue.h"
+
+#include <Rendering/Assets/mesh.h>
+#include <algorithm>
+
+static constexpr uint64_t SORT_KEY_HANDLE_MASK = 0xFFFFF;
+
+uint64_t RenderQueue::MakeSortKey( RenderLayer layer, Mesh* mesh )
+{
+	uint64_t pipeline = mesh->material->m_pipeline.m_handle & SORT_KEY_HANDLE_MASK;
+	uint64_t descriptor = mesh->material->m_descriptor.m_handle & SORT_KEY_HANDLE_MASK;
+	uint64_t geometry = mesh->geometry->id & SORT_KEY_HANDLE_MASK;
+
+	return ( static_cast<uint64_t>( layer ) << 60 ) | ( pipeline << 40 ) | ( descriptor << 20 ) | geometry;
+}
+
+void RenderQueue::Clear()
+{
+	m_items.clear();
+	m_sortEntries.clear();
+}
+
+void RenderQueue::Add( RenderLayer layer, Mesh* mesh, const glm::mat4& modelMatrix )
+{
+	m_items.push_back( { MakeSortKey( layer, mesh ), layer, mesh, modelMatrix } );
+}
+
+size_t RenderQueue::Cull( const Frustum& frustum )
+{
+	m_cullSpheres.Clear();
+	m_cullItemIndices.clear();
+
+	//
+	// Move every bounding sphere into world space
+	//
+	for ( uint32_t i = 0; i < m_items.size(); ++i )
+	{
+		const RenderItem& item = m_items[i];
+
+		if ( item.layer == RENDER_LAYER_UI )
+			continue;
+
+		const MeshBounds& bounds = item.mesh->bounds;
+		const glm::mat4& modelMatrix = item.modelMatrix;
+
+		glm::vec3 center = glm::vec3( modelMatrix * glm::vec4( bounds.center, 1.0f ) );
+
+		// Non-uniform scales stretch the sphere along one axis; cover it with the largest
+		float scale = std::max( { glm::length( glm::vec3( modelMatrix[0] ) ), glm::length( glm::vec3( modelMatrix[1] ) ),
+		    glm::length( glm::vec3( modelMatrix[2] ) ) } );
+
+		m_cullSpheres.Add( center, bounds.radius * scale );
+		m_cullItemIndices.push_back( i );
+	}
+
+	m_cullSpheres.Cull( frustum, m_cullVisibility );
+
+	//
+	// Drop anything that isn't visible, keeping everything else in the order it was added
+	//
+	size_t culledCount = 0;
+
+	for ( size_t i = 0; i < m_cullItemIndices.size(); ++i )
+	{
+		if ( m_cullVisibility[i] == 0 )
+		{
+			m_items[m_cullItemIndices[i]].mesh = nullptr;
+			culledCount++;
+		}
+	}
+
+	if ( culledCount > 0 )
+	{
+		auto isCulled = []( const RenderItem& item ) { return item.mesh == nullptr; };
+		m_items.erase( std::remove_if( m_items.begin(), m_items.end(), isCulled ), m_items.end() );
+	}
+
+	return culledCount;
+}
+
+void RenderQueue::Sort()
+{
+	// Sort small key/index pairs rather than moving whole items around. Ties are broken by index,
+	// which keeps submission order for identical state.
+	m_sortEntries.resize( m_items.size() );
+
+	for ( uint32_t i = 0; i < m_items.size(); ++i )
+		m_sortEntries[i] = { m_items[i].sortKey, i };
+
+	std::sort( m_sortEntries.begin(), m_sortEntries.end(), []( const SortEntry& a, const SortEntry& b ) {
+		if ( a.sortKey != b.sortKey )
+			return a.sortKey < b.sortKey;
+
+		return a.itemIndex < b.itemIndex;
+	} );
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <Misc/defs.h>
+#include <Rendering/frustum.h>
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+struct Mesh;
+
+// Layers are drawn in this order, regardless of what's in them
+enum RenderLayer : uint8_t
+{
+	RENDER_LAYER_WORLD = 0,
+	RENDER_LAYER_VIEWMODEL = 1,
+	RENDER_LAYER_UI = 2
+};
+
+struct RenderItem
+{
+	uint64_t sortKey;
+	RenderLayer layer;
+	Mesh* mesh;
+	glm::mat4 modelMatrix;
+};
+
+//
+// Collects every mesh that needs drawing this frame, so that they can be sorted and drawn with as
+// few state changes as possible.
+//
+// Sort keys are packed as follows (most significant first):
+//   [63..60] layer
+//   [59..40] pipeline
+//   [39..20] descriptor
+//   [19..0]  geometry
+// Handles only contribute their slot index, and geometry its allocation id, which is enough to group
+// identical state together.
+// Items with identical keys are kept in the order they were added.
+//
+class RenderQueue
+{
+private:
+	struct SortEntry
+	{
+		uint64_t sortKey;
+		uint32_t itemIndex;
+	};
+
+	std::vector<RenderItem> m_items;
+	std::vector<SortEntry> m_sortEntries;
+
+	// Scratch space for Cull
+	BoundingSphereBatch m_cullSpheres;
+	std::vector<uint32_t> m_cullItemIndices;
+	std::vector<uint8_t> m_cullVisibility;
+
+	static uint64_t MakeSortKey( RenderLayer layer, Mesh* mesh );
+
+public:
+	void Clear();
+
+	// The mesh's material must already have its resources created; the key is built from them.
+	void Add( RenderLayer layer, Mesh* mesh, const glm::mat4& modelMatrix );
+
+	// Removes every item whose mesh bounds are entirely outside the frustum. UI items are never
+	// culled, since they aren't drawn in world space. Returns how many items were removed.
+	size_t Cull( const Frustum& frustum );
+
+	void Sort();
+
+	inline size_t GetCount() const { return m_items.size(); }
+
+	// Returns the item at this position in sorted order. Only valid after Sort.
+	inline const RenderItem& GetSorted( size_t index ) const { return m_items[m_sortEntries[index].itemIndex]; }
+};
@@ -1,5 +1,12 @@
 #include "shadercompiler.h"
 
+#include <Misc/globalvars.h>
+#include <Misc/jobmanager.h>
+#include <cstring>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <thread>
+
 void ShaderCompiler::InitResources( TBuiltInResource& Resources )
 {
 	Resources.maxLights = 32;
@@ -113,6 +120,8 @@ EShLanguage ShaderCompiler::FindLanguage( const ShaderType shader_type )
 		return EShLangVertex;
 	case SHADER_TYPE_FRAGMENT:
 		return EShLangFragment;
+	case SHADER_TYPE_COMPUTE:
+		return EShLangCompute;
 	}
 
 	__debugbreak(); // Invalid / unsupported shader type
@@ -133,35 +142,187 @@ std::string ShaderCompiler::GetPreamble( EShLanguage language )
 	case EShLangFragment:
 		preamble += "#define FRAGMENT\n";
 		break;
+	case EShLangCompute:
+		preamble += "#define COMPUTE\n";
+		break;
 	}
 
 	return preamble;
 }
 
+uint64_t ShaderCompiler::HashShader( EShLanguage stage, const std::string& preamble, const char* pshader )
+{
+	// FNV-1a over everything that can change the output
+	uint64_t hash = 14695981039346656037ull;
+
+	auto hashBytes = [&]( const void* data, size_t size ) {
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>( data );
+
+		for ( size_t i = 0; i < size; ++i )
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	};
+
+	auto hashString = [&]( const char* string ) { hashBytes( string, strlen( string ) + 1 ); };
+
+	hashBytes( &CACHE_VERSION, sizeof( CACHE_VERSION ) );
+	hashString( glslang::GetGlslVersionString() );
+	hashBytes( &stage, sizeof( stage ) );
+	hashString( preamble.c_str() );
+	hashString( pshader );
+
+	return hash;
+}
+
+std::filesystem::path ShaderCompiler::GetCachePath( uint64_t hash ) const
+{
+	return m_cacheDirectory / fmt::format( "{:016x}.spv", hash );
+}
+
+bool ShaderCompiler::LoadSpirv( uint64_t hash, std::vector<uint32_t>& spirv )
+{
+	std::ifstream file( GetCachePath( hash ), std::ios::binary );
+
+	if ( !file.good() )
+		return false;
+
+	CacheFileHeader header = {};
+	file.read( reinterpret_cast<char*>( &header ), sizeof( header ) );
+
+	if ( !file.good() || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.hash != hash ||
+	     header.wordCount == 0 )
+	{
+		return false;
+	}
+
+	spirv.resize( header.wordCount );
+	file.read( reinterpret_cast<char*>( spirv.data() ), header.wordCount * sizeof( uint32_t ) );
+
+	if ( !file.good() || spirv[0] != 0x07230203 ) // SPIR-V magic number
+	{
+		spdlog::warn( "Ignoring broken shader cache file {}", GetCachePath( hash ).string() );
+		spirv.clear();
+		return false;
+	}
+
+	return true;
+}
+
+void ShaderCompiler::SaveSpirv( uint64_t hash, const std::vector<uint32_t>& spirv )
+{
+	std::error_code error;
+	std::filesystem::create_directories( m_cacheDirectory, error );
+
+	if ( error )
+	{
+		spdlog::warn( "Couldn't create shader cache directory {}: {}", m_cacheDirectory.string(), error.message() );
+		return;
+	}
+
+	// Write to a temporary file first so that a crash part-way through can't leave a broken file
+	// behind. Several threads can compile the same shader at once, so the temporary name is made
+	// unique per thread.
+	std::filesystem::path path = GetCachePath( hash );
+	std::filesystem::path tempPath = path;
+	tempPath += fmt::format( ".{}.tmp", std::hash<std::thread::id>{}( std::this_thread::get_id() ) );
+
+	{
+		std::ofstream file( tempPath, std::ios::binary | std::ios::trunc );
+
+		if ( !file.good() )
+			return;
+
+		CacheFileHeader header = { CACHE_MAGIC, CACHE_VERSION, hash, static_cast<uint64_t>( spirv.size() ) };
+		file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+		file.write( reinterpret_cast<const char*>( spirv.data() ), spirv.size() * sizeof( uint32_t ) );
+
+		if ( !file.good() )
+		{
+			spdlog::warn( "Couldn't write shader cache file {}", tempPath.string() );
+			return;
+		}
+	}
+
+	std::filesystem::rename( tempPath, path, error );
+
+	if ( error )
+		std::filesystem::remove( tempPath, error );
+}
+
 bool ShaderCompiler::Compile( const ShaderType shader_type, const char* pshader, std::vector<uint32_t>& spirv )
 {
 	EShLanguage stage = FindLanguage( shader_type );
+
+	//
+	// Set preamble so that each shader knows what it is and what it is being compiled for
+	//
+	std::string preamble = GetPreamble( stage );
+	const uint64_t hash = HashShader( stage, preamble, pshader );
+
+	// Already compiled this run?
+	{
+		std::lock_guard lock( m_cacheMutex );
+		auto it = m_cache.find( hash );
+
+		if ( it != m_cache.end() )
+		{
+			spirv = it->second;
+			return true;
+		}
+	}
+
+	// Compiled on a previous run? The lock isn't held while loading or compiling so that other
+	// threads can work on other shaders in the meantime.
+	if ( !LoadSpirv( hash, spirv ) )
+	{
+		if ( !CompileUncached( stage, preamble, pshader, spirv ) )
+			return false;
+
+		SaveSpirv( hash, spirv );
+	}
+
+	std::lock_guard lock( m_cacheMutex );
+	m_cache[hash] = spirv;
+	return true;
+}
+
+bool ShaderCompiler::CompileBatch( std::vector<ShaderCompileRequest>& requests )
+{
+	Globals::m_jobManager->ParallelFor( requests.size(), 1, [&]( size_t start, size_t end ) {
+		for ( size_t i = start; i < end; ++i )
+		{
+			ShaderCompileRequest& request = requests[i];
+			request.succeeded = Compile( request.type, request.source.c_str(), request.spirv );
+		}
+	} );
+
+	bool succeeded = true;
+
+	for ( const ShaderCompileRequest& request : requests )
+		succeeded &= request.succeeded;
+
+	return succeeded;
+}
+
+bool ShaderCompiler::CompileUncached(
+    EShLanguage stage, const std::string& preamble, const char* pshader, std::vector<uint32_t>& spirv )
+{
 	glslang::TShader shader( stage );
 	glslang::TProgram program;
 
-	TBuiltInResource builtInResources = {};
-	InitResources( builtInResources );
 	EShMessages messages = ( EShMessages )( EShMsgSpvRules | EShMsgVulkanRules );
 
 	const char* shaderStrings[1];
 	shaderStrings[0] = pshader;
 	shader.setStrings( shaderStrings, 1 );
-
-	//
-	// Set preamble so that each shader knows what it is and what it is being compiled for
-	//
-	std::string preamble = GetPreamble( stage );
 	shader.setPreamble( preamble.c_str() );
 
 	// Set spirv 1.4
 	shader.setEnvTarget( glslang::EShTargetSpv, glslang::EShTargetSpv_1_4 );
 
-	if ( !shader.parse( &builtInResources, 460, false, messages ) )
+	if ( !shader.parse( &m_builtInResources, 460, false, messages ) )
 	{
 		spdlog::error( shader.getInfoLog() );
 		spdlog::error( shader.getInfoDebugLog() );
@@ -179,4 +340,4 @@ bool ShaderCompiler::Compile( const ShaderType shader_type, const char* pshader,
 
 	glslang::GlslangToSpv( *program.getIntermediate( stage ), spirv );
 	return true;
-}
\ No newline at end of file
+}
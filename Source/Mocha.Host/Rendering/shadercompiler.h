@@ -3,23 +3,77 @@
 #include <Rendering/rendering.h>
 #include <glslang/SPIRV/GlslangToSpv.h>
 #include <glslang/Public/ShaderLang.h>
+#include <filesystem>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <volk.h>
 
+struct ShaderCompileRequest
+{
+	ShaderType type;
+	std::string source;
+
+	// Filled in by CompileBatch
+	std::vector<uint32_t> spirv;
+	bool succeeded = false;
+};
+
 //
 // This compiles from GLSL to SPIR-V.
 // It's not Vulkan-specific, so doesn't belong in
 // Platform/Vulkan/.
 //
+// Compiled SPIR-V is cached in memory and on disk, keyed by
+// a hash of everything that affects the output (source,
+// stage, preamble and compiler version), so unchanged
+// shaders are only ever compiled once.
+//
 class ShaderCompiler
 {
 private:
-	inline ShaderCompiler() { glslang::InitializeProcess(); }
+	// Bump this whenever the file layout or compile options change
+	static constexpr uint32_t CACHE_VERSION = 1;
+	static constexpr uint32_t CACHE_MAGIC = 0x5644534d; // "MSDV"
+
+	struct CacheFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t hash;
+		uint64_t wordCount;
+	};
+
+	// Same for every compile, so only built once
+	TBuiltInResource m_builtInResources = {};
+
+	std::filesystem::path m_cacheDirectory = ".cache/shaders";
+
+	std::mutex m_cacheMutex;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> m_cache;
+
+	inline ShaderCompiler()
+	{
+		glslang::InitializeProcess();
+		InitResources( m_builtInResources );
+	}
+
 	inline ~ShaderCompiler() { glslang::FinalizeProcess(); }
 
 	void InitResources( TBuiltInResource& Resources );
 	EShLanguage FindLanguage( const ShaderType shader_type );
 	static std::string GetPreamble( EShLanguage language );
 
+	static uint64_t HashShader( EShLanguage stage, const std::string& preamble, const char* pshader );
+	std::filesystem::path GetCachePath( uint64_t hash ) const;
+
+	bool LoadSpirv( uint64_t hash, std::vector<uint32_t>& spirv );
+	void SaveSpirv( uint64_t hash, const std::vector<uint32_t>& spirv );
+
+	bool CompileUncached( EShLanguage stage, const std::string& preamble, const char* pshader, std::vector<uint32_t>& spirv );
+
 public:
 	static ShaderCompiler& Instance()
 	{
@@ -27,5 +81,11 @@ public:
 		return *instance;
 	}
 
+	// Safe to call from any thread.
 	bool Compile( const ShaderType shader_type, const char* pshader, std::vector<uint32_t>& spirv );
+
+	// Compiles every request across the job system, returning once they have all finished. Returns
+	// true if every request succeeded; check each request's succeeded flag to find the ones that
+	// didn't.
+	bool CompileBatch( std::vector<ShaderCompileRequest>& requests );
 };
\ No newline at end of file
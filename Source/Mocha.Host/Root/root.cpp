@@ -6,6 +6,7 @@
 #include <Misc/editormanager.h>
 #include <Misc/globalvars.h>
 #include <Misc/inputmanager.h>
+#include <Misc/jobmanager.h>
 #include <Misc/logmanager.h>
 #include <Misc/projectmanager.h>
 #include <Physics/physicsmanager.h>
@@ -23,6 +24,9 @@ void Root::Startup()
 	Globals::m_cvarManager = new CVarManager();
 	Globals::m_cvarManager->Startup();
 
+	Globals::m_jobManager = new JobManager();
+	Globals::m_jobManager->Startup();
+
 	Globals::m_projectManager = new ProjectManager();
 	Globals::m_projectManager->Startup();
 
@@ -58,6 +62,7 @@ void Root::Shutdown()
 	Globals::m_physicsManager->Shutdown();
 	Globals::m_entityManager->Shutdown();
 	Globals::m_projectManager->Shutdown();
+	Globals::m_jobManager->Shutdown();
 	Globals::m_cvarManager->Shutdown();
 	Globals::m_logManager->Shutdown();
 }
@@ -96,6 +101,17 @@ uint32_t Root::CreateModelEntity()
 	return entityDictionary->AddEntity<ModelEntity>( modelEntity );
 }
 
+uint32_t Root::CreateLightEntity()
+{
+	auto* entityDictionary = Globals::m_entityManager;
+
+	LightEntity lightEntity = {};
+	lightEntity.AddFlag( ENTITY_MANAGED );
+	lightEntity.m_type = "LightEntity";
+
+	return entityDictionary->AddEntity<LightEntity>( lightEntity );
+}
+
 double HiresTimeInSeconds()
 {
 	return std::chrono::duration_cast<std::chrono::duration<double>>(
@@ -142,8 +158,7 @@ void Root::Run()
 		while ( accumulator >= logicDelta )
 		{
 			// Assign previous transforms to all entities
-			Globals::m_entityManager->ForEach(
-			    [&]( std::shared_ptr<BaseEntity> entity ) { entity->m_transformLastFrame = entity->m_transformCurrentFrame; } );
+			Globals::m_entityManager->GetTransforms().StoreLastTick();
 
 			Globals::m_tickDeltaTime = ( float )logicDelta;
 
@@ -166,8 +181,7 @@ void Root::Run()
 			}
 
 			// Assign current transforms to all entities
-			Globals::m_entityManager->ForEach(
-			    [&]( std::shared_ptr<BaseEntity> entity ) { entity->m_transformCurrentFrame = entity->m_transform; } );
+			Globals::m_entityManager->GetTransforms().StoreCurrentTick();
 
 			Globals::m_curTime += logicDelta;
 			accumulator -= logicDelta;
@@ -176,21 +190,17 @@ void Root::Run()
 
 		Globals::m_frameDeltaTime = ( float )loopDeltaTime;
 
+		// Run anything that other threads have asked the main thread to do
+		Globals::m_jobManager->RunMainThreadJobs();
+
 		// TODO: Server / client
 		// #ifndef DEDICATED_SERVER
 		// Render
 		{
 			const double alpha = accumulator / logicDelta;
 
-			// Assign interpolated transforms to all entities
-			Globals::m_entityManager->ForEach( [&]( std::shared_ptr<BaseEntity> entity ) {
-				// If this entity was spawned in just now, don't interpolate
-				if ( entity->m_spawnTime == Globals::m_curTick )
-					return;
-
-				entity->m_transform =
-				    Transform::Lerp( entity->m_transformLastFrame, entity->m_transformCurrentFrame, ( float )alpha );
-			} );
+			// Assign interpolated transforms to all entities (except ones that were spawned in just now)
+			Globals::m_entityManager->GetTransforms().Interpolate( ( float )alpha, Globals::m_curTick );
 
 			Globals::m_renderManager->DrawOverlaysAndEditor();
 
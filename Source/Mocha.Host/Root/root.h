@@ -61,6 +61,7 @@ public:
 
 	GENERATE_BINDINGS uint32_t CreateBaseEntity();
 	GENERATE_BINDINGS uint32_t CreateModelEntity();
+	GENERATE_BINDINGS uint32_t CreateLightEntity();
 
 	GENERATE_BINDINGS inline void SetCameraPosition( Vector3 position ) { Globals::m_cameraPos = position; }
 	GENERATE_BINDINGS inline Vector3 GetCameraPosition() { return Globals::m_cameraPos; }
@@ -0,0 +1,112 @@
+﻿using System.Diagnostics.CodeAnalysis;
+using System.Security.Cryptography;
+using System.Text;
+using Veldrid;
+using Veldrid.SPIRV;
+
+namespace MochaTool.AssetCompiler;
+
+/// <summary>
+/// On-disk cache of compiled SPIR-V, one file per shader stage. Entries are keyed by a hash of
+/// everything that affects the output, so a shader whose common block and stage source haven't
+/// changed is never handed to the GLSL compiler again, even on a forced recompile.
+/// </summary>
+static class ShaderCache
+{
+	// Bump this whenever the compile options or the entry layout change.
+	private const uint CacheVersion = 1;
+
+	// "MSDV" - same magic as the engine's own shader cache.
+	private const uint CacheMagic = 0x5644534d;
+
+	private static readonly string CacheDirectory = Path.Combine( ".cache", "shaders", "assets" );
+
+	/// <summary>
+	/// Builds a cache key from the fully preambled stage source. The compiler version is part of the
+	/// key so that a shaderc update doesn't hand out stale bytecode.
+	/// </summary>
+	public static string GetKey( string shaderSource, ShaderStages shaderStage )
+	{
+		var compilerVersion = typeof( SpirvCompilation ).Assembly.GetName().Version;
+		var keySource = $"{CacheVersion}\n{compilerVersion}\n{shaderStage}\n{shaderSource}";
+
+		// Full SHA-256 rather than a short hash: the key is the file name, and there is nothing else to
+		// catch a collision with.
+		return Convert.ToHexString( SHA256.HashData( Encoding.UTF8.GetBytes( keySource ) ) );
+	}
+
+	/// <summary>
+	/// Loads a cached stage. Missing, truncated or out-of-date entries are treated as a miss.
+	/// </summary>
+	public static bool TryLoad( string key, [NotNullWhen( true )] out int[]? spirv )
+	{
+		spirv = null;
+
+		var path = GetPath( key );
+		if ( !File.Exists( path ) )
+			return false;
+
+		try
+		{
+			using var stream = File.OpenRead( path );
+			using var reader = new BinaryReader( stream );
+
+			if ( reader.ReadUInt32() != CacheMagic || reader.ReadUInt32() != CacheVersion )
+				return false;
+
+			var wordCount = reader.ReadInt32();
+			if ( wordCount <= 0 || stream.Length - stream.Position != wordCount * sizeof( int ) )
+				return false;
+
+			var data = new int[wordCount];
+			for ( int i = 0; i < wordCount; i++ )
+				data[i] = reader.ReadInt32();
+
+			spirv = data;
+			return true;
+		}
+		catch ( IOException )
+		{
+			return false;
+		}
+	}
+
+	/// <summary>
+	/// Stores a compiled stage. Entries are written to a temporary file and moved into place, so
+	/// another compiler process never reads a half-written entry.
+	/// </summary>
+	public static void Save( string key, int[] spirv )
+	{
+		var path = GetPath( key );
+		var tempPath = $"{path}.{Guid.NewGuid():N}.tmp";
+
+		try
+		{
+			Directory.CreateDirectory( CacheDirectory );
+
+			using ( var stream = File.Create( tempPath ) )
+			using ( var writer = new BinaryWriter( stream ) )
+			{
+				writer.Write( CacheMagic );
+				writer.Write( CacheVersion );
+				writer.Write( spirv.Length );
+
+				foreach ( var word in spirv )
+					writer.Write( word );
+			}
+
+			File.Move( tempPath, path, true );
+		}
+		catch ( Exception ex ) when ( ex is IOException || ex is UnauthorizedAccessException )
+		{
+			// The cache is only an optimization - the compiled shader is still valid without it.
+			Log.Warning( $"Couldn't write shader cache entry '{path}': {ex.Message}" );
+			File.Delete( tempPath );
+		}
+	}
+
+	private static string GetPath( string key )
+	{
+		return Path.Combine( CacheDirectory, $"{key}.spv" );
+	}
+}
@@ -17,10 +17,12 @@ public partial class ShaderCompiler : BaseCompiler
 	public override bool SupportsMochaFile => true;
 
 	/// <summary>
-	/// Compiles a shader from GLSL into SPIR-V using Veldrid's libshaderc bindings.
+	/// Compiles a shader from GLSL into SPIR-V using Veldrid's libshaderc bindings, or loads it from
+	/// <see cref="ShaderCache"/> if this exact source has been compiled before.
 	/// </summary>
+	/// <param name="bindless">Compile the shader's bindless variant, with <c>BINDLESS</c> defined.</param>
 	/// <returns>Vulkan-compatible SPIR-V bytecode.</returns>
-	private int[] CompileShader( string? commonSource, string shaderSource, ShaderStages shaderStage, string debugName = "temp" )
+	private int[] CompileShader( string? commonSource, string shaderSource, ShaderStages shaderStage, bool bindless, string debugName = "temp" )
 	{
 		//
 		// Prepend a preamble with GLSL version & macro definitions
@@ -28,11 +30,21 @@ public partial class ShaderCompiler : BaseCompiler
 		var preamble = new StringBuilder();
 		preamble.AppendLine( $"#version 460" );
 
+		if ( bindless )
+		{
+			preamble.AppendLine( "#define BINDLESS" );
+			debugName += "_bindless";
+		}
+
 		preamble.AppendLine( commonSource );
 
 		preamble.AppendLine();
 		shaderSource = preamble.ToString() + shaderSource;
 
+		var cacheKey = ShaderCache.GetKey( shaderSource, shaderStage );
+		if ( ShaderCache.TryLoad( cacheKey, out var cachedData ) )
+			return cachedData;
+
 		//
 		// Perform the compilation
 		//
@@ -44,6 +56,8 @@ public partial class ShaderCompiler : BaseCompiler
 		var dataInts = new int[dataBytes.Length / 4];
 		Buffer.BlockCopy( dataBytes, 0, dataInts, 0, dataBytes.Length );
 
+		ShaderCache.Save( cacheKey, dataInts );
+
 		return dataInts;
 	}
 
@@ -59,22 +73,56 @@ public partial class ShaderCompiler : BaseCompiler
 		// Debug name is used for error messages and internally by the SPIR-V compiler.
 		var debugName = Path.GetFileNameWithoutExtension( input.SourcePath ) ?? "temp";
 
+		// Stages don't depend on each other, so compile them side by side.
+		Task<int[]>? CompileStage( string? stageSource, ShaderStages shaderStage, bool bindless = false )
+		{
+			if ( stageSource == null )
+				return null;
+
+			return Task.Run( () => CompileShader( shaderFile.Common, stageSource, shaderStage, bindless, debugName ) );
+		}
+
+		var vertexTask = CompileStage( shaderFile.Vertex, ShaderStages.Vertex );
+		var fragmentTask = CompileStage( shaderFile.Fragment, ShaderStages.Fragment );
+		var computeTask = CompileStage( shaderFile.Compute, ShaderStages.Compute );
+
+		// Shaders that check for BINDLESS get a second variant, used in bindless mode (render.bindless).
+		// Materials whose shaders don't have one keep using descriptors.
+		var hasBindlessVariant = new[] { shaderFile.Common, shaderFile.Vertex, shaderFile.Fragment }
+			.Any( x => x?.Contains( "BINDLESS" ) ?? false );
+
+		Task<int[]>? bindlessVertexTask = null;
+		Task<int[]>? bindlessFragmentTask = null;
+
+		if ( hasBindlessVariant )
+		{
+			bindlessVertexTask = CompileStage( shaderFile.Vertex, ShaderStages.Vertex, true );
+			bindlessFragmentTask = CompileStage( shaderFile.Fragment, ShaderStages.Fragment, true );
+		}
+
 		var shaderFormat = new ShaderInfo();
 
-		if ( shaderFile.Vertex != null )
-			shaderFormat.VertexShaderData = CompileShader( shaderFile.Common, shaderFile.Vertex, ShaderStages.Vertex, debugName );
+		// GetResult rethrows the compiler's own exception rather than wrapping it in an AggregateException.
+		if ( vertexTask != null )
+			shaderFormat.VertexShaderData = vertexTask.GetAwaiter().GetResult();
+
+		if ( fragmentTask != null )
+			shaderFormat.FragmentShaderData = fragmentTask.GetAwaiter().GetResult();
+
+		if ( computeTask != null )
+			shaderFormat.ComputeShaderData = computeTask.GetAwaiter().GetResult();
 
-		if ( shaderFile.Fragment != null )
-			shaderFormat.FragmentShaderData = CompileShader( shaderFile.Common, shaderFile.Fragment, ShaderStages.Fragment, debugName );
+		if ( bindlessVertexTask != null )
+			shaderFormat.BindlessVertexShaderData = bindlessVertexTask.GetAwaiter().GetResult();
 
-		if ( shaderFile.Compute != null )
-			shaderFormat.ComputeShaderData = CompileShader( shaderFile.Common, shaderFile.Compute, ShaderStages.Compute, debugName );
+		if ( bindlessFragmentTask != null )
+			shaderFormat.BindlessFragmentShaderData = bindlessFragmentTask.GetAwaiter().GetResult();
 
 		// Wrapper for file.
 		var mochaFile = new MochaFile<ShaderInfo>
 		{
 			MajorVersion = 4,
-			MinorVersion = 0,
+			MinorVersion = 1,
 			Data = shaderFormat,
 			AssetHash = input.DataHash
 		};